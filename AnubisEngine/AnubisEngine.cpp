@@ -1,10 +1,13 @@
 ﻿#include "AnubisEngine.h"
 
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <numeric>
 #include <ostream>
 
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-
+// GLM_FORCE_DEPTH_ZERO_TO_ONE comes from the project configurations, every TU has to agree on it
 #include <glm/gtc/matrix_transform.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -13,7 +16,7 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
-void AnubisEngine::run()
+int AnubisEngine::run()
 {
     Logger::init();
 #ifdef _DEBUG
@@ -21,15 +24,47 @@ void AnubisEngine::run()
 #else
     Logger::printToConsole("RELEASE BUILD:", level::info);
 #endif
+    // before anything else, start up is profiled too
+    startProfiling();
 
-    initWindow();
+    if (!options.headless)
+    {
+        initWindow();
+    }
     initVulkan();
-    mainLoop();
+    int exitCode = EXIT_SUCCESS;
+    if (options.benchmarkMemoryPlacement)
+    {
+        runMemoryPlacementBenchmark();
+    }
+    else if (options.benchmarkInstancing)
+    {
+        runInstancingBenchmark();
+    }
+    else if (options.benchmarkRecording)
+    {
+        runRecordingBenchmark();
+    }
+    else if (options.benchmarkDescriptors)
+    {
+        runDescriptorBenchmark();
+    }
+    else if (options.benchmark)
+    {
+        // regressions against --bench-baseline fail the run, CI can gate on it
+        exitCode = runFrameBenchmark() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else
+    {
+        mainLoop();
+    }
     cleanup();
+    return exitCode;
 }
 
 void AnubisEngine::initVulkan()
 {
+    ANUBIS_PROFILE_FUNCTION();
     //compile the test shader
     // shader.slang
     // spirv
@@ -42,32 +77,66 @@ void AnubisEngine::initVulkan()
     
     createInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!options.headless)
+    {
+        createSurface();
+    }
     pickPhysicalDevice();
-    initSurfaceCapabilities();
+    if (!options.headless)
+    {
+        initSurfaceCapabilities();
+    }
     createLogicalDevice();
-    createSwapChain(nullptr);
+    createMemoryAllocator();
+    createPipelineCache();
+    if (options.headless)
+    {
+        createHeadlessTargets();
+    }
+    else
+    {
+        createSwapChain(nullptr);
+    }
     createSwapChainImageViews();
     createDescriptorSetLayout();
+    createBindlessDescriptors();
     createGraphicsPipeline();
     createCommandPool();
-    createMsaaResources();
-    createDepthResources();
+    createStagingRing();
+    createTransientAttachments();
+    logTransientAttachmentSavings();
     createTextureImage();
     createTextureImageView();
     createTextureImageSampler();
+    createMaterials();
     loadModel();
-    createVertexBuffer();
-    createIndexBuffer();
+    createGeometryPool();
+    createScene();
     createUniformBuffers();
+    createGpuCulling();
     createDescriptorPool();
-    createDescriptorSets();
     createCommandBuffers();
+    createFrameCommandPools();
     createSyncObjects();
+    createGpuProfiler();
+
+    // everything uploaded at start up has to land before the first frame
+    stagingRing.finish();
+    stagingRing.logStatistics();
+    memoryAllocator.updateBudget();
+    memoryAllocator.logStatistics();
+    // run again (or with --cold-pipeline-cache) for the other side
+    pipelineCache.logStatistics();
+
+    if (options.defragment)
+    {
+        memoryDefragmenter.requestDefragmentation();
+    }
 }
 
 void AnubisEngine::createInstance()
 {
+    ANUBIS_PROFILE_FUNCTION();
     // create the application information
     constexpr vk::ApplicationInfo appInfo
     {
@@ -98,6 +167,7 @@ void AnubisEngine::createInstance()
 
 void AnubisEngine::setupDebugMessenger()
 {
+    ANUBIS_PROFILE_FUNCTION();
     if (!enableValidationLayers) return;
     Logger::printToConsole("***** Setting up Debug Messenger *****");
     vk::DebugUtilsMessengerCreateInfoEXT createInfo
@@ -134,13 +204,20 @@ vk::Bool32 AnubisEngine::debugCallback(vk::DebugUtilsMessageSeverityFlagBitsEXT
         logLevel = level::err;
         break;
     }
-    Logger::printToConsole("validation layer: type " + to_string(messageType) + " msg: " + string(pCallbackData->pMessage), logLevel);
+    // the level is only known at run time, straight to the logger instead of a level's macro
+    Logger::get()->log(logLevel, "validation layer: type {} msg: {}", to_string(messageType), pCallbackData->pMessage);
     return vk::False;
 }
 
 void AnubisEngine::pickPhysicalDevice()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Picking Physical Device *****");
+    // nothing is presented headless, software implementations don't have to offer it
+    if (options.headless)
+    {
+        std::erase_if(requiredDeviceExtensions, [](const char* extension) { return strcmp(extension, vk::KHRSwapchainExtensionName) == 0; });
+    }
     Logger::printToConsole("Using Required Device Extensions:");
     for (const auto& extension : requiredDeviceExtensions)
     {
@@ -156,8 +233,7 @@ void AnubisEngine::pickPhysicalDevice()
         // vulkan 1.3 must be supported
         bool supportsVulkan1_3 = device.getProperties().apiVersion >=
             VK_API_VERSION_1_3;
-        Logger::printToConsole(deviceName + " supports Vulkan 1.3: " + std::to_string(
-            supportsVulkan1_3), level::info);
+        ANUBIS_LOG_INFO("{} supports Vulkan 1.3: {}", deviceName, supportsVulkan1_3);
 
         // ensure that the queue families support graphics
         auto queueFamilies = device.getQueueFamilyProperties();
@@ -167,8 +243,7 @@ void AnubisEngine::pickPhysicalDevice()
                 return !!(qfp.queueFlags &
                     vk::QueueFlagBits::eGraphics);
             });
-        Logger::printToConsole(deviceName + " supports graphics: " + std::to_string(
-            supportsGraphics), level::info);
+        ANUBIS_LOG_INFO("{} supports graphics: {}", deviceName, supportsGraphics);
 
         // ensure that the device supports all required extensions
         auto availableDeviceExtensions = device.
@@ -182,27 +257,30 @@ void AnubisEngine::pickPhysicalDevice()
                     return strcmp(availableDeviceExtension.extensionName, requiredDeviceExtension) == 0;
                 });
             });
-        Logger::printToConsole(deviceName + " supports all required extensions: " + std::to_string(supportsAllRequiredExtensions), level::info);
+        ANUBIS_LOG_INFO("{} supports all required extensions: {}", deviceName, supportsAllRequiredExtensions);
 
         // ensure that all required features are availabel
-        auto features = device.template getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+        auto features = device.template getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features,
+                                                     vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
         bool supportsRequiredFeatures = features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering && 
                                         features.template get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState &&
-                                        features.template get<vk::PhysicalDeviceFeatures2>().features.samplerAnisotropy;
+                                        features.template get<vk::PhysicalDeviceFeatures2>().features.samplerAnisotropy &&
+                                        // textures and materials are bindless
+                                        BindlessDescriptors::isSupported(features.template get<vk::PhysicalDeviceVulkan12Features>());
         
-        Logger::printToConsole(deviceName + " supports all required features: " + std::to_string(supportsRequiredFeatures), level::info);
+        ANUBIS_LOG_INFO("{} supports all required features: {}", deviceName, supportsRequiredFeatures);
 
         bool deviceIsSuitable = supportsVulkan1_3 && supportsGraphics && supportsAllRequiredExtensions && supportsRequiredFeatures;
 
         if (deviceIsSuitable)
         {
-            Logger::printToConsole("Found suitable device: " + deviceName, level::info);
+            ANUBIS_LOG_INFO("Found suitable device: {}", deviceName);
             physicalDevice = device;
             msaaSamples = helpers::getMaxUsableSampleCount(physicalDevice);
         }
         else
         {
-            Logger::printToConsole("Device not suitable: " + deviceName, level::warn);
+            ANUBIS_LOG_WARN("Device not suitable: {}", deviceName);
         }
         return deviceIsSuitable;
     }
@@ -272,65 +350,197 @@ uint32_t AnubisEngine::findPresentQueueIndex(vk::PhysicalDevice device, uint32_t
     return presentIndex;
 }
 
+// a family that can copy but not draw - on discrete GPUs that's the DMA engine, which runs beside graphics.
+// falls back to the graphics family when there is none (or it is turned off)
+uint32_t AnubisEngine::findTransferQueueIndex(vk::PhysicalDevice device)
+{
+    if (options.singleQueue)
+    {
+        return graphicsQueueIndex;
+    }
+
+    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = device.getQueueFamilyProperties();
+    uint32_t bestIndex = graphicsQueueIndex;
+    for (size_t i = 0; i < queueFamilyProperties.size(); i++)
+    {
+        const vk::QueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if (!(flags & vk::QueueFlagBits::eTransfer) || (flags & vk::QueueFlagBits::eGraphics))
+        {
+            continue;
+        }
+        // transfer only beats an async compute family that can also copy
+        if (bestIndex == graphicsQueueIndex || !(flags & vk::QueueFlagBits::eCompute))
+        {
+            bestIndex = static_cast<uint32_t>(i);
+        }
+    }
+    return bestIndex;
+}
+
 void AnubisEngine::createLogicalDevice()
 {
+    ANUBIS_PROFILE_FUNCTION();
     // create the logical device
     Logger::printToConsole("***** Creating Logical Device/Queues *****");
 
     // get the qraphics queue index
     graphicsQueueIndex = findQueueIndex(physicalDevice, vk::QueueFlagBits::eGraphics);
-    Logger::printToConsole("Graphics Queue Index: " + std::to_string(graphicsQueueIndex), level::info);
+    ANUBIS_LOG_INFO("Graphics Queue Index: {}", graphicsQueueIndex);
 
-    presentQueueIndex = findPresentQueueIndex(physicalDevice, graphicsQueueIndex);
-    Logger::printToConsole("Present Queue Index: " + std::to_string(presentQueueIndex), level::info);
-    Logger::printToConsole("Graphics Queue Index (After findPresentQueueIndex): " + std::to_string(graphicsQueueIndex), level::info);
+    presentQueueIndex = options.headless ? graphicsQueueIndex : findPresentQueueIndex(physicalDevice, graphicsQueueIndex);
+    ANUBIS_LOG_INFO("Present Queue Index: {}", presentQueueIndex);
+    ANUBIS_LOG_INFO("Graphics Queue Index (After findPresentQueueIndex): {}", graphicsQueueIndex);
 
-    // setup the device queue info struct for the graphics queue
-    vk::DeviceQueueCreateInfo deviceQueueCreateInfo
+    transferQueueIndex = findTransferQueueIndex(physicalDevice);
+    ANUBIS_LOG_INFO("Transfer Queue Index: {} ({})", transferQueueIndex, transferQueueIndex != graphicsQueueIndex ? "dedicated" : "graphics");
+
+    // setup the device queue info struct for the graphics queue (and the transfer queue if it's its own family)
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos
     {
-        .queueFamilyIndex = graphicsQueueIndex,
-        .queueCount = 1,
-        .pQueuePriorities = &graphicsQueuePriority
+        {
+            .queueFamilyIndex = graphicsQueueIndex,
+            .queueCount = 1,
+            .pQueuePriorities = &graphicsQueuePriority
+        }
     };
+    if (transferQueueIndex != graphicsQueueIndex)
+    {
+        deviceQueueCreateInfos.push_back(
+        {
+            .queueFamilyIndex = transferQueueIndex,
+            .queueCount = 1,
+            .pQueuePriorities = &graphicsQueuePriority
+        });
+    }
+
+    // --gpu-driven: many draws out of one buffer + a draw count the GPU writes
+    if (options.gpuDriven)
+    {
+        const auto supportedFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        // the cull shader writes the instance slot into firstInstance
+        const vk::PhysicalDeviceFeatures& features = supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features;
+        gpuDrivenSupported = features.multiDrawIndirect && features.drawIndirectFirstInstance
+            && supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+        if (!gpuDrivenSupported)
+        {
+            Logger::printToConsole("No multiDrawIndirect/drawIndirectFirstInstance/drawIndirectCount, --gpu-driven falls back to instanced draws", level::warn);
+        }
+    }
+    gpuDriven = gpuDrivenSupported;
+    ANUBIS_LOG_INFO("GPU Driven Rendering: {}", gpuDriven);
 
     // to be used later
     vk::PhysicalDeviceFeatures deviceFeatures;
     deviceFeatures.samplerAnisotropy = vk::True;
     deviceFeatures.sampleRateShading = vk::True;
+    deviceFeatures.multiDrawIndirect = gpuDrivenSupported;
+    deviceFeatures.drawIndirectFirstInstance = gpuDrivenSupported;
+
+    // descriptor indexing for the bindless set
+    vk::PhysicalDeviceVulkan12Features vulkan12Features = BindlessDescriptors::getRequiredFeatures();
+    vulkan12Features.drawIndirectCount = gpuDrivenSupported;
+    // timeline semaphores signal when uploads have landed
+    vulkan12Features.timelineSemaphore = true;
 
     // IMPORTANT: structure chaining!! 'automatically' links the pNext pointer for all the defined types
     // only need to pass the first to the DeviceCreateInfo struct
-    vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features,
+    vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features,
                        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT> featureChain
     {
         {.features = deviceFeatures},
+        vulkan12Features,
         {.synchronization2 = true, .dynamicRendering = true},
         {.extendedDynamicState = true}
     };
 
+    // optional extensions on top of the required ones
+    std::vector<const char*> enabledDeviceExtensions = requiredDeviceExtensions;
+    const auto availableDeviceExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+    memoryBudgetEnabled = std::ranges::any_of(availableDeviceExtensions, [](auto const& extension)
+    {
+        return strcmp(extension.extensionName, vk::EXTMemoryBudgetExtensionName) == 0;
+    });
+    if (memoryBudgetEnabled)
+    {
+        enabledDeviceExtensions.push_back(vk::EXTMemoryBudgetExtensionName);
+    }
+    ANUBIS_LOG_INFO("Memory Budget Extension: {}", memoryBudgetEnabled);
+    // the per draw set without a pool, set 2 falls back to the frame pools without it
+    pushDescriptorsEnabled = options.pushDescriptors && std::ranges::any_of(availableDeviceExtensions, [](auto const& extension)
+    {
+        return strcmp(extension.extensionName, vk::KHRPushDescriptorExtensionName) == 0;
+    });
+    if (pushDescriptorsEnabled)
+    {
+        enabledDeviceExtensions.push_back(vk::KHRPushDescriptorExtensionName);
+    }
+    ANUBIS_LOG_INFO("Push Descriptor Extension: {}", pushDescriptorsEnabled);
+
     // setup the DeviceCreateInfo struct
     // IMPORTANT: this gets executed with all features in the featureChain
     vk::DeviceCreateInfo deviceCreateInfo
     {
         .pNext = &featureChain.get<vk::PhysicalDeviceFeatures2>(),
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &deviceQueueCreateInfo,
-        .enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size()),
-        .ppEnabledExtensionNames = requiredDeviceExtensions.data(),
+        .queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+        .pQueueCreateInfos = deviceQueueCreateInfos.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size()),
+        .ppEnabledExtensionNames = enabledDeviceExtensions.data(),
     };
 
     logicalDevice = vk::raii::Device(physicalDevice, deviceCreateInfo);
     graphicsQueue = vk::raii::Queue(logicalDevice, graphicsQueueIndex, 0);
     presentQueue = vk::raii::Queue(logicalDevice, presentQueueIndex, 0);
+    transferQueue = vk::raii::Queue(logicalDevice, transferQueueIndex, 0);
     Logger::printToConsole("*************************");
 }
 
+void AnubisEngine::createMemoryAllocator()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    memoryAllocator.init(physicalDevice, logicalDevice, memoryBudgetEnabled);
+    memoryAllocator.addPressureCallback([this](const MemoryPressureEvent& event) { onMemoryPressure(event); });
+    transientAttachments.init(logicalDevice, memoryAllocator);
+    memoryDefragmenter.init(logicalDevice, memoryAllocator);
+}
+
+void AnubisEngine::createPipelineCache()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    pipelineCache.init(logicalDevice, physicalDevice, options.pipelineCachePath, options.coldPipelineCache);
+}
+
+void AnubisEngine::onMemoryPressure(const MemoryPressureEvent& event)
+{
+    static constexpr const char* pressureNames[] = {"none", "moderate", "critical"};
+    if (event.current == MemoryPressure::eCritical)
+    {
+        ANUBIS_LOG_WARN("Memory pressure on heap {}: {} -> {} ({} / {} MiB)", event.heapIndex, pressureNames[static_cast<int>(event.previous)],
+            pressureNames[static_cast<int>(event.current)], event.usage / (1024 * 1024), event.budget / (1024 * 1024));
+    }
+    else
+    {
+        ANUBIS_LOG_INFO("Memory pressure on heap {}: {} -> {} ({} / {} MiB)", event.heapIndex, pressureNames[static_cast<int>(event.previous)],
+            pressureNames[static_cast<int>(event.current)], event.usage / (1024 * 1024), event.budget / (1024 * 1024));
+    }
+
+    // the only thing the engine can give back on its own is the slack in sparse blocks.
+    //  asset systems register their own callbacks to drop caches/stream out
+    if (event.current > event.previous)
+    {
+        memoryDefragmenter.requestDefragmentation();
+    }
+}
+
 std::pair<const uint32_t, const char**> AnubisEngine::getRequiredExtensions()
 {
     uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> validationExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> validationExtensions;
+    // headless needs no surface extensions (and glfw isn't initialized)
+    if (!options.headless)
+    {
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        validationExtensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers)
     {
@@ -359,7 +569,7 @@ std::pair<const uint32_t, const char**> AnubisEngine::checkGLFWExtensions()
                                      return strcmp(glfwExtension, extensionProperty.extensionName) == 0;
                                  }))
         {
-            Logger::printToConsole("GLFW extension not supported by vulkan: " + std::string(glfwExtensions.second[i]), level::err);
+            ANUBIS_LOG_ERROR("GLFW extension not supported by vulkan: {}", glfwExtensions.second[i]);
             throw std::runtime_error("GLFW extension not supported by vulkan: " + std::string(glfwExtensions.second[i]));
         }
     }
@@ -385,30 +595,307 @@ void AnubisEngine::checkVulkanLayers()
 
 void AnubisEngine::mainLoop()
 {
-    while (!glfwWindowShouldClose(mainWindow))
+    auto start = std::chrono::high_resolution_clock::now();
+    while (!windowShouldClose() && (options.frameLimit == 0 || frameNumber < options.frameLimit))
     {
-        glfwPollEvents();
+        pollEvents();
         drawFrame();
     }
 
     logicalDevice.waitIdle();
+
+    if (options.headless)
+    {
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        ANUBIS_LOG_INFO("Headless: {} frames, {:.3f} ms/frame", frameNumber, elapsed / static_cast<double>(std::max<uint64_t>(frameNumber, 1)));
+        if (!readbackBuffers.empty() && frameNumber > 0)
+        {
+            // the last submitted frame
+            writeReadback(options.readbackPath, (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT);
+        }
+    }
+}
+
+void AnubisEngine::pollEvents()
+{
+    if (!options.headless)
+    {
+        glfwPollEvents();
+    }
+}
+
+bool AnubisEngine::windowShouldClose() const
+{
+    return !options.headless && glfwWindowShouldClose(mainWindow);
+}
+
+void AnubisEngine::runMemoryPlacementBenchmark()
+{
+    Logger::printToConsole("***** Memory Placement Benchmark *****");
+    struct PlacementRun
+    {
+        std::string name;
+        MemoryPlacement placement;
+        double frameMs = 0.0;
+    };
+
+    std::vector<PlacementRun> runs = {
+        {"device local (staged)", MemoryPlacements::GpuOnly},
+        {"host visible", MemoryPlacements::Upload}
+    };
+    // resizable BAR / UMA: device local memory the CPU can write straight into
+    constexpr vk::MemoryPropertyFlags reBarFlags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible |
+        vk::MemoryPropertyFlagBits::eHostCoherent;
+    if (memoryAllocator.hasMemoryType(reBarFlags))
+    {
+        runs.push_back({"device local + host visible (ReBAR)", {.required = reBarFlags}});
+    }
+    else
+    {
+        Logger::printToConsole("No DEVICE_LOCAL|HOST_VISIBLE memory type, skipping ReBAR placement", level::info);
+    }
+
+    drawsPerFrame = options.benchmarkDrawsPerFrame;
+    for (auto& run : runs)
+    {
+        // rebuild the geometry in this placement
+        logicalDevice.waitIdle();
+        geometryPlacement = run.placement;
+        geometryPool.clear();
+        createGeometryPool();
+        // the mesh table changes with the pool
+        uploadGpuScene();
+
+        for (uint32_t i = 0; i < options.benchmarkWarmupFrames && !windowShouldClose(); i++)
+        {
+            pollEvents();
+            drawFrame();
+        }
+        logicalDevice.waitIdle();
+
+        uint32_t frames = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (; frames < options.benchmarkFrames && !windowShouldClose(); frames++)
+        {
+            pollEvents();
+            drawFrame();
+        }
+        logicalDevice.waitIdle();
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        run.frameMs = elapsed / std::max(frames, 1u);
+    }
+
+    uint64_t indicesPerScene = 0;
+    for (const RenderObject& object : renderObjects)
+    {
+        indicesPerScene += geometryPool.getMesh(object.meshId).indexCount;
+    }
+    const double indicesPerFrame = static_cast<double>(indicesPerScene) * drawsPerFrame;
+    // object draws, instanced ones are fewer draw calls (drawCallCount)
+    drawsPerFrame *= static_cast<uint32_t>(renderObjects.size());
+    ANUBIS_LOG_INFO("{} frames, {} draws per frame, {} indices per scene", options.benchmarkFrames, drawsPerFrame, indicesPerScene);
+    for (const auto& run : runs)
+    {
+        ANUBIS_LOG_INFO("{}: {:.3f} ms/frame, {:.0f} draws/s, {:.2f} M indices/s", run.name, run.frameMs, 1000.0 * drawsPerFrame / run.frameMs,
+            indicesPerFrame / (run.frameMs * 1000.0));
+    }
+
+    // leave things the way a normal run would have them
+    drawsPerFrame = 1;
+    Logger::printToConsole("*************************");
+}
+
+void AnubisEngine::runInstancingBenchmark()
+{
+    Logger::printToConsole("***** Instancing Benchmark *****");
+    struct InstancingRun
+    {
+        uint32_t objectCount = 0;
+        const char* mode = "";
+        uint32_t drawCalls = 0;
+        double cpuMs = 0.0;
+        double frameMs = 0.0;
+    };
+
+    const uint32_t sceneObjectCount = options.sceneObjectCount;
+    const bool instancing = options.instancing;
+    // the draw paths compared, gpu driven only when it was set up (--gpu-driven)
+    struct DrawMode
+    {
+        const char* name;
+        bool instanced;
+        bool gpuDriven;
+    };
+    std::vector<DrawMode> modes = {{"per object", false, false}, {"instanced", true, false}};
+    if (gpuCulling.isInitialized())
+    {
+        modes.push_back({"gpu driven", true, true});
+    }
+    std::vector<InstancingRun> runs;
+    for (uint32_t objectCount = 1; objectCount <= InstancingBenchmarkMaxObjects; objectCount *= 10)
+    {
+        // a bigger grid of the same mesh, the frame ring was sized for the largest one
+        logicalDevice.waitIdle();
+        options.sceneObjectCount = objectCount;
+        createScene();
+        uploadGpuScene();
+
+        for (const DrawMode& mode : modes)
+        {
+            options.instancing = mode.instanced;
+            gpuDriven = mode.gpuDriven;
+            for (uint32_t i = 0; i < options.benchmarkWarmupFrames && !windowShouldClose(); i++)
+            {
+                pollEvents();
+                drawFrame();
+            }
+            logicalDevice.waitIdle();
+
+            InstancingRun run{.objectCount = objectCount, .mode = mode.name};
+            uint32_t frames = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (; frames < options.benchmarkFrames && !windowShouldClose(); frames++)
+            {
+                pollEvents();
+                drawFrame();
+                run.cpuMs += lastFrameCpuMs;
+            }
+            logicalDevice.waitIdle();
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            run.cpuMs /= std::max(frames, 1u);
+            run.frameMs = elapsed / std::max(frames, 1u);
+            run.drawCalls = drawCallCount;
+            runs.push_back(run);
+        }
+    }
+
+    // cpu = update + record + submit, where per object draws pay; frame includes waiting on the GPU
+    //  gpu driven draw calls are indirect ones, the culling pass decides how many draws they turn into
+    ANUBIS_LOG_INFO("{} frames per run", options.benchmarkFrames);
+    for (const auto& run : runs)
+    {
+        ANUBIS_LOG_INFO("{:>6} objects, {:<10}: {:>6} draw calls, cpu {:.3f} ms/frame, frame {:.3f} ms", run.objectCount,
+            run.mode, run.drawCalls, run.cpuMs, run.frameMs);
+    }
+
+    // leave things the way a normal run would have them
+    logicalDevice.waitIdle();
+    options.sceneObjectCount = sceneObjectCount;
+    options.instancing = instancing;
+    gpuDriven = gpuCulling.isInitialized();
+    createScene();
+    uploadGpuScene();
+    Logger::printToConsole("*************************");
+}
+
+void AnubisEngine::runRecordingBenchmark()
+{
+    Logger::printToConsole("***** Recording Benchmark *****");
+    // per object draws are the longest draw list. the camera stands still, so the cached run replays every frame
+    const bool instancing = options.instancing;
+    const bool wasGpuDriven = gpuDriven;
+    const uint32_t recordThreads = options.recordThreads;
+    const bool drawCache = options.drawCache;
+    options.instancing = false;
+    gpuDriven = false;
+
+    struct RecordingRun
+    {
+        uint32_t threads;
+        bool cached;
+    };
+    std::vector<RecordingRun> runs;
+    for (uint32_t threads = 1; threads < workerPool.getWorkerCount(); threads *= 2)
+    {
+        runs.push_back({threads, false});
+    }
+    runs.push_back({workerPool.getWorkerCount(), false});
+    runs.push_back({workerPool.getWorkerCount(), true});
+
+    double singleThreadMs = 0.0;
+    for (const RecordingRun& run : runs)
+    {
+        options.recordThreads = run.threads;
+        options.drawCache = run.cached;
+        invalidateRecordedDraws();
+        for (uint32_t i = 0; i < options.benchmarkWarmupFrames && !windowShouldClose(); i++)
+        {
+            pollEvents();
+            drawFrame();
+        }
+
+        double recordMs = 0.0;
+        uint32_t frames = 0;
+        uint32_t replayedFrames = 0;
+        for (; frames < options.benchmarkFrames && !windowShouldClose(); frames++)
+        {
+            pollEvents();
+            drawFrame();
+            recordMs += lastRecordMs;
+            replayedFrames += lastDrawsReplayed ? 1 : 0;
+        }
+        recordMs /= std::max(frames, 1u);
+        singleThreadMs = run.threads == 1 && !run.cached ? recordMs : singleThreadMs;
+        const uint32_t secondaries = getRecordChunkCount(drawCallCount);
+        ANUBIS_LOG_INFO("{:>2} thread(s){}: record {:.3f} ms/frame ({:.2f}x), {} draws, {} secondaries, {}/{} frames replayed", run.threads,
+            run.cached ? " cached" : "", recordMs, singleThreadMs / recordMs, drawCallCount, secondaries > 1 ? secondaries : 0,
+            replayedFrames, frames);
+    }
+    logicalDevice.waitIdle();
+
+    options.instancing = instancing;
+    options.recordThreads = recordThreads;
+    options.drawCache = drawCache;
+    gpuDriven = wasGpuDriven;
+    invalidateRecordedDraws();
+    Logger::printToConsole("*************************");
+}
+
+void AnubisEngine::runDescriptorBenchmark()
+{
+    // CPU only, the sets point into the frame ring but nothing is submitted
+    logicalDevice.waitIdle();
+    DescriptorTemplate::runBenchmark(logicalDevice, commandPool, frameRing.getBuffer(), frameRing.getAlignment(), pushDescriptorsEnabled);
 }
 
 void AnubisEngine::drawFrame()
 {
+    ANUBIS_PROFILE_FUNCTION();
     // all are asynchronous
     // 1) wait for the previous frame
-    while (vk::Result::eTimeout == logicalDevice.waitForFences(*inFlightFences[currentFrame], vk::True, UINT64_MAX));
+    {
+        ANUBIS_PROFILE_ZONE("fence wait");
+        while (vk::Result::eTimeout == logicalDevice.waitForFences(*inFlightFences[currentFrame], vk::True, UINT64_MAX));
+    }
+    // hand back staging space of uploads that have landed (doesn't block)
+    stagingRing.retire();
+    // the frame that last used this slot is done: its defragmentation copies too
+    if (frameNumber >= MAX_FRAMES_IN_FLIGHT)
+    {
+        memoryDefragmenter.completeMoves(frameNumber - MAX_FRAMES_IN_FLIGHT);
+    }
+    memoryAllocator.updateBudget();
+    collectGpuZones(currentFrame);
+    // every thread's zones so far, on the main thread once a frame
+    CpuProfiler::collect();
+    const auto cpuStart = ChromeTrace::Clock::now();
 
     // 2) acquire image from the swap chain
-    auto [result, imageIndex] = swapChain.acquireNextImage(
-        UINT64_MAX, presentCompleteSemaphores[semaphoreIndex], nullptr);
-
-    if (result == vk::Result::eErrorOutOfDateKHR ||
-        (result == vk::Result::eSuboptimalKHR && framebufferResized))
+    //  headless renders into the frame's own target, nothing to acquire
+    uint32_t imageIndex = currentFrame;
+    if (!options.headless)
     {
-        recreateSwapChain();
-        return;
+        ANUBIS_PROFILE_ZONE("acquire");
+        auto [acquireResult, acquiredIndex] = swapChain.acquireNextImage(
+            UINT64_MAX, presentCompleteSemaphores[semaphoreIndex], nullptr);
+
+        if (acquireResult == vk::Result::eErrorOutOfDateKHR ||
+            (acquireResult == vk::Result::eSuboptimalKHR && framebufferResized))
+        {
+            recreateSwapChain();
+            return;
+        }
+        imageIndex = acquiredIndex;
     }
 
     // if (result != vk::Result::eSuccess)
@@ -419,25 +906,42 @@ void AnubisEngine::drawFrame()
 
     // 2a) update currentFrame with the uniformBuffer
     updateUniformBuffer(currentFrame);
+    updateFrameDescriptors();
 
     // 3) record a command buffer which draws the scene onto the image
     logicalDevice.resetFences(*inFlightFences[currentFrame]);
     commandBuffers[currentFrame].reset();
+    const auto recordStart = ChromeTrace::Clock::now();
     recordCommandBuffer(imageIndex);
+    lastRecordMs = std::chrono::duration<double, std::milli>(ChromeTrace::Clock::now() - recordStart).count();
 
     // 4) submit the recorded command buffer
-    vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    const vk::SubmitInfo submitInfo
     {
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &(*presentCompleteSemaphores[semaphoreIndex]), // wait for present
-        .pWaitDstStageMask = &waitDestinationStageMask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &(*commandBuffers[currentFrame]), // the command buffer to submit
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &(*renderCompleteSemaphores[semaphoreIndex]) // signal complete
-    };
-    graphicsQueue.submit(submitInfo, *inFlightFences[currentFrame]);
+        ANUBIS_PROFILE_ZONE("submit");
+        vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        const vk::SubmitInfo submitInfo
+        {
+            .waitSemaphoreCount = options.headless ? 0u : 1u,
+            .pWaitSemaphores = &(*presentCompleteSemaphores[semaphoreIndex]), // wait for present
+            .pWaitDstStageMask = &waitDestinationStageMask,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &(*commandBuffers[currentFrame]), // the command buffer to submit
+            .signalSemaphoreCount = options.headless ? 0u : 1u,
+            .pSignalSemaphores = &(*renderCompleteSemaphores[semaphoreIndex]) // signal complete
+        };
+        graphicsQueue.submit(submitInfo, *inFlightFences[currentFrame]);
+    }
+    gpuProfiler.markSubmitted(currentFrame);
+    const uint64_t submittedFrame = frameNumber++;
+    const double cpuMs = std::chrono::duration<double, std::milli>(ChromeTrace::Clock::now() - cpuStart).count();
+
+    if (options.headless)
+    {
+        // nothing to present
+        recordFrameTiming(submittedFrame, cpuMs);
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
 
     // 5) present the swap chain image
     const vk::PresentInfoKHR presentInfo
@@ -450,8 +954,10 @@ void AnubisEngine::drawFrame()
         .pResults = nullptr // not used
     };
 
+    vk::Result result;
     try
     {
+        ANUBIS_PROFILE_ZONE("present");
         result = presentQueue.presentKHR(presentInfo);
         if (result == vk::Result::eErrorOutOfDateKHR ||
             (framebufferResized && result == vk::Result::eSuboptimalKHR))
@@ -464,6 +970,7 @@ void AnubisEngine::drawFrame()
     {
         result = vk::Result::eErrorOutOfDateKHR;
     }
+    recordFrameTiming(submittedFrame, cpuMs);
 
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized)
     {
@@ -480,17 +987,79 @@ void AnubisEngine::drawFrame()
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+uint32_t AnubisEngine::runFrameBenchmark()
+{
+    Logger::printToConsole("***** Frame Benchmark *****");
+    ANUBIS_LOG_INFO("Warmup Frames: {}", options.benchmarkWarmupFrames);
+    ANUBIS_LOG_INFO("Frames: {}", options.benchmarkFrames);
+    ANUBIS_LOG_INFO("Timestep: {} s", BenchmarkTimestep);
+
+    frameBenchmark.begin(frameNumber + options.benchmarkWarmupFrames, options.benchmarkFrames);
+    while (!windowShouldClose() && !frameBenchmark.isComplete())
+    {
+        pollEvents();
+        drawFrame();
+    }
+    logicalDevice.waitIdle();
+    // the frames still in flight when the loop ended
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        collectGpuZones(i);
+    }
+    Logger::printToConsole("*************************");
+
+    frameBenchmark.logSummary();
+    const BenchmarkInfo info
+    {
+        .deviceName = physicalDevice.getProperties().deviceName,
+        .width = swapChainExtent.width,
+        .height = swapChainExtent.height,
+        .objectCount = static_cast<uint32_t>(renderObjects.size()),
+        .warmupFrames = options.benchmarkWarmupFrames,
+        .timestep = BenchmarkTimestep,
+        .headless = options.headless,
+        .gpuTimestamps = gpuProfiler.isEnabled()
+    };
+    frameBenchmark.writeReport(options.benchmarkReportPath, info);
+
+    if (options.benchmarkBaselinePath.empty())
+    {
+        return 0;
+    }
+    return FrameBenchmark::compareReports(options.benchmarkBaselinePath, options.benchmarkReportPath, options.benchmarkThreshold);
+}
+
+void AnubisEngine::recordFrameTiming(uint64_t submittedFrame, double cpuMs)
+{
+    // present to present (submit to submit headless), includes any blocking in the present itself
+    const auto now = std::chrono::high_resolution_clock::now();
+    const double intervalMs = lastPresentTime == std::chrono::high_resolution_clock::time_point{}
+        ? 0.0 : std::chrono::duration<double, std::milli>(now - lastPresentTime).count();
+    lastPresentTime = now;
+    lastFrameCpuMs = cpuMs;
+    frameBenchmark.recordCpu(submittedFrame, cpuMs, intervalMs);
+}
+
 void AnubisEngine::updateUniformBuffer(uint32_t currentImage)
 {
+    ANUBIS_PROFILE_FUNCTION();
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
     auto time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    glm::vec3 eye(0.0f, 12.0f, 60.0f);
+    if (options.benchmark)
+    {
+        // fixed timestep + scripted camera: a slow orbit with a bob, the same views every run
+        time = static_cast<float>(frameNumber) * BenchmarkTimestep;
+        const float orbit = time * glm::radians(20.0f);
+        eye = glm::vec3(std::sin(orbit) * 60.0f, 12.0f + std::sin(time * 0.5f) * 6.0f, std::cos(orbit) * 60.0f);
+    }
 
     UniformBufferObject ubo{};
     // identity, rotation angle, and rotation axis
-    ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     // eye position, center position, up axis
-    ubo.view = glm::lookAt(glm::vec3(0.0f, 12.0f, 60.0f), glm::vec3(0.0f, 12.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ubo.view = glm::lookAt(eye, glm::vec3(0.0f, 12.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     // fov, aspect ratio, near clip, far clip
     ubo.proj = glm::perspective(glm::radians(35.0f), static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height), 0.01f, 75.0f);
 
@@ -498,52 +1067,92 @@ void AnubisEngine::updateUniformBuffer(uint32_t currentImage)
     // flip the sign on the scaling factor of the y-axis in the proj.
     // if not done, the image will appear upside down
     ubo.proj[1][1] *= -1;
+    ubo.sceneRotation = rotation;
 
     //write directly out!!
-    // still not he most efficent see 'push constants'
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
-}
+    // the camera + one array of every instance out of this frame's ring region, no allocation and no descriptor writes.
+    // the fence of this frame was just waited on so the region is free to be overwritten
+    frameRing.beginFrame(currentImage);
+    frameUniformOffset = static_cast<uint32_t>(frameRing.push(ubo).offset);
+
+    if (gpuDriven)
+    {
+        // the objects are already on the GPU, the culling pass only needs the frustum and this frame's rotation
+        CullData cullData{.sceneRotation = rotation, .objectCount = gpuCulling.getObjectCount()};
+        const std::array<glm::vec4, 6> planes = extractFrustumPlanes(ubo.proj * ubo.view);
+        std::ranges::copy(planes, cullData.frustumPlanes);
+        frameCullOffset = static_cast<uint32_t>(frameRing.push(cullData).offset);
+        return;
+    }
 
-void AnubisEngine::cleanUpBuffers()
-{
-    Logger::printToConsole("***** Cleaning Up Uniform Buffers Memory *****");
-    for (auto& buffer : uniformBuffersMemory)
+    // only what is in the frustum gets an instance and a draw
+    if (options.cpuCulling)
     {
-        buffer.clear();
-        buffer = nullptr;
+        frustumCuller.cull(cullBounds, extractFrustumPlanes(ubo.proj * ubo.view), visibleObjects, &workerPool);
     }
-    
-    Logger::printToConsole("***** Cleaning Up Uniform Buffers *****");
-    for (auto& buffer : uniformBuffers)
+    else
     {
-        buffer.clear();
-        buffer = nullptr;
+        visibleObjects.resize(renderObjects.size());
+        std::iota(visibleObjects.begin(), visibleObjects.end(), 0u);
     }
+
+    // the visible objects are still sorted by mesh, every run of one mesh is one instanced draw
+    instanceBatches.clear();
+    for (uint32_t i = 0; i < visibleObjects.size(); i++)
+    {
+        const uint32_t meshId = renderObjects[visibleObjects[i]].meshId;
+        if (instanceBatches.empty() || instanceBatches.back().meshId != meshId)
+        {
+            instanceBatches.push_back({.meshId = meshId, .firstInstance = i});
+        }
+        instanceBatches.back().instanceCount++;
+    }
+
+    // per object draws push their transform and material (recordDraws), only instanced draws read the array
+    const size_t instanceCount = options.instancing ? visibleObjects.size() : 0;
+    const FrameSlice instanceSlice = frameRing.allocate(sizeof(InstanceData) * instanceCount);
+    frameInstanceOffset = static_cast<uint32_t>(instanceSlice.offset);
+    auto* instances = static_cast<InstanceData*>(instanceSlice.mapped);
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        const RenderObject& object = renderObjects[visibleObjects[i]];
+        instances[i] = InstanceData{
+            .model = object.transform * rotation,
+            .materialIndex = object.materialIndex
+        };
+    }
+}
+
+void AnubisEngine::cleanUpBuffers()
+{
+    Logger::printToConsole("***** Cleaning Up Uniform Buffers *****");
+    frameRing.clear();
     
-    Logger::printToConsole("Cleaning up Index Buffer Memory");
-    indexBufferMemory.clear();
-    indexBuffer = nullptr;
-    
-    Logger::printToConsole("Cleaning up Index Buffer");
-    indexBuffer.clear();
-    indexBuffer = nullptr;
-    
-    Logger::printToConsole("Cleaning up Vertex Buffer Memory");
-    vertexBufferMemory.clear();
-    vertexBufferMemory = nullptr;
-    
-    Logger::printToConsole("Cleaning up Vertex Buffer");
-    vertexBuffer.clear();
-    vertexBuffer = nullptr;
+    Logger::printToConsole("Cleaning up Geometry Pool");
+    geometryPool.clear();
 }
 
 void AnubisEngine::cleanup()
 {
     Logger::printToConsole("***** Cleaning up *****");
 
-    Logger::printToConsole("Cleaning Up Render Target Image Memory");
-    msaaRenderTargetImageMemory.clear();
-    msaaRenderTargetImageMemory = nullptr;
+    memoryDefragmenter.logStatistics();
+    Logger::printToConsole("Clearing Memory Defragmenter");
+    memoryDefragmenter.clear();
+
+    // the device is idle by now, pick up the frames that were still in flight
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        collectGpuZones(i);
+    }
+    CpuProfiler::collect();
+    CpuProfiler::logStatistics();
+    gpuProfiler.logStatistics();
+    if (trace.isActive())
+    {
+        trace.write(options.tracePath);
+    }
+    CpuProfiler::setTrace(nullptr);
 
     Logger::printToConsole("Cleaning Up Render Target Image View");
     msaaRenderTargetImageView.clear();
@@ -565,10 +1174,6 @@ void AnubisEngine::cleanup()
     textureImage.clear();
     textureImage = nullptr;
 
-    Logger::printToConsole("Cleaning up Depth Image Memory");
-    depthImageMemory.clear();
-    depthImageMemory = nullptr;
-
     Logger::printToConsole("Cleaning Up Depth Image View");
     depthImageView.clear();
     depthImageView = nullptr;
@@ -576,19 +1181,43 @@ void AnubisEngine::cleanup()
     Logger::printToConsole("Cleaning up Depth Image");
     depthImage.clear();
     depthImage = nullptr;
+
+    Logger::printToConsole("Cleaning Up Transient Attachment Memory");
+    transientAttachments.clear();
     
-    Logger::printToConsole("Cleaning Up Descriptor Sets");
-    for (auto& descriptorSet : descriptorSets)
+    Logger::printToConsole("Cleaning Up Frame Descriptor Pools");
+    ANUBIS_LOG_INFO("Frame descriptor pool resets: {} in {} frames", frameDescriptorPools.getResetCount(), frameNumber);
+    frameDescriptors = {};
+    frameDescriptorPools.clear();
+    frameSetTemplate.clear();
+    drawSetTemplate.clear();
+
+    Logger::printToConsole("Cleaning Up Bindless Descriptors");
+    bindlessDescriptors.clear();
+    materialBuffer.clear();
+    materialBuffer = nullptr;
+    materialBufferMemory.clear();
+    materialBufferMemory = nullptr;
+
+    Logger::printToConsole("Cleaning Up GPU Culling");
+    gpuCulling.clear();
+
+    cleanUpBuffers();
+
+    if (options.headless)
     {
-        descriptorSet.clear();
-        descriptorSet = nullptr;
+        // owned by the allocator, unlike real swapchain images
+        Logger::printToConsole("Cleaning Up Headless Render Targets");
+        cleanupSwapChain(false);
+        swapChainImages.clear();
+        headlessImages.clear();
+        headlessImageMemory.clear();
+        readbackBuffers.clear();
+        readbackBufferMemory.clear();
     }
-    
-    Logger::printToConsole("Cleaning Up Descriptor Pool");
-    descriptorPool.clear();
-    descriptorPool = nullptr;
 
-    cleanUpBuffers();
+    Logger::printToConsole("Clearing GPU Profiler");
+    gpuProfiler.clear();
 
     // not having this here prevents the destruction of < VkDevice >
     Logger::printToConsole("Clearing Semaphores/Fences");
@@ -596,6 +1225,11 @@ void AnubisEngine::cleanup()
     renderCompleteSemaphores.clear();
     inFlightFences.clear();
 
+    Logger::printToConsole("Clearing Frame Command Pools.");
+    ANUBIS_LOG_INFO("Draw streams recorded: {} in {} frames", drawStreamRecordCount, frameNumber);
+    recordedDraws = {};
+    frameCommandPools.clear();
+
     // not having this here prevents the destruction of < VkDevice >
     Logger::printToConsole("Clearing Command Buffer.");
     commandBuffers.clear();
@@ -603,37 +1237,56 @@ void AnubisEngine::cleanup()
     // not having this here prevents the destruction of < VkDevice >
     Logger::printToConsole("Clearing Command Pool.");
     commandPool.clear();
+
+    Logger::printToConsole("Clearing Staging Ring.");
+    stagingRing.clear();
     
     // not having this here prevents the destruction of < VkDevice >
-    Logger::printToConsole("Clearing Graphics Pipeline.");
-    graphicsPipeline.clear();
-
-    Logger::printToConsole("Clearing Descriptor Set Layout.");
-    descriptorSetLayout.clear();
-    descriptorSetLayout = nullptr;
+    Logger::printToConsole("Clearing Graphics Pipelines.");
+    pipelineManager.logStatistics();
+    pipelineManager.clear();
+
+    Logger::printToConsole("Clearing Descriptor Set Layouts.");
+    frameSetLayout.clear();
+    frameSetLayout = nullptr;
+    drawSetLayout.clear();
+    drawSetLayout = nullptr;
     
     // not having this here prevents the destruction of < VkDevice >
     Logger::printToConsole("Clearing Pipeline Layout.");
     pipelineLayout.clear();
+
+    // written back for the next start up, every pipeline is gone by now
+    Logger::printToConsole("Saving Pipeline Cache.");
+    pipelineCache.clear();
+
+    // every allocation has been handed back by now
+    memoryAllocator.logStatistics();
+    Logger::printToConsole("Clearing Memory Allocator.");
+    memoryAllocator.clear();
     
     cleanupSwapChain(true);
 
-    // not having this here prevents the destruction of < VkSurfaceKHR >
-    Logger::printToConsole("Clearing mainWindowSurface.");
-    mainWindowSurface.clear();
-    mainWindowSurface = nullptr;
+    if (!options.headless)
+    {
+        // not having this here prevents the destruction of < VkSurfaceKHR >
+        Logger::printToConsole("Clearing mainWindowSurface.");
+        mainWindowSurface.clear();
+        mainWindowSurface = nullptr;
 
-    Logger::printToConsole("Destroying window.");
-    glfwDestroyWindow(mainWindow);
+        Logger::printToConsole("Destroying window.");
+        glfwDestroyWindow(mainWindow);
 
-    Logger::printToConsole("Terminating GLFW.");
-    glfwTerminate();
+        Logger::printToConsole("Terminating GLFW.");
+        glfwTerminate();
+    }
 
     Logger::printToConsole("*************************");
 }
 
 void AnubisEngine::createSyncObjects()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Sync Objects *****");
     presentCompleteSemaphores.clear();
     renderCompleteSemaphores.clear();
@@ -652,6 +1305,40 @@ void AnubisEngine::createSyncObjects()
     Logger::printToConsole("*************************");
 }
 
+void AnubisEngine::startProfiling()
+{
+    // the main thread registers first and gets ChromeTrace::MainThreadTrack
+    ANUBIS_PROFILE_THREAD("Main Thread");
+    CpuProfiler::setEnabled(options.profile);
+    if (!options.tracePath.empty())
+    {
+        trace.begin();
+        trace.setTrackName(ChromeTrace::GpuTrack, "GPU (graphics queue)");
+        CpuProfiler::setTrace(&trace);
+    }
+}
+
+void AnubisEngine::createGpuProfiler()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    if (options.benchmark || options.profile)
+    {
+        gpuProfiler.init(logicalDevice, physicalDevice, graphicsQueueIndex, MAX_FRAMES_IN_FLIGHT);
+    }
+    if (trace.isActive())
+    {
+        gpuProfiler.setTrace(&trace);
+    }
+}
+
+void AnubisEngine::collectGpuZones(uint32_t frameIndex)
+{
+    if (const std::optional<GpuFrameTime> gpuFrame = gpuProfiler.collect(frameIndex))
+    {
+        frameBenchmark.recordGpu(gpuFrame->frameNumber, gpuFrame->frameMs);
+    }
+}
+
 void AnubisEngine::initWindow()
 {
     // initialize the library
@@ -679,6 +1366,7 @@ void AnubisEngine::initWindow()
 
 void AnubisEngine::createSurface()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Surface *****");
     VkSurfaceKHR windowSurface;
     if (glfwCreateWindowSurface(*instance, mainWindow, nullptr, &windowSurface) != 0)
@@ -693,20 +1381,21 @@ void AnubisEngine::createSurface()
 
 void AnubisEngine::createSwapChain(const vk::raii::SwapchainKHR& previousSwapChain)
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Swap Chain *****");
     swapChainImageFormat = chooseSwapSurfaceFormat();
     swapChainExtent = chooseSwapExtent();
 
     // the + 1 here is to increase the performance of the swap chain on 'refresh'
     auto minImageCount = std::max(3u, surfaceCapabilities.minImageCount + 1);
-    Logger::printToConsole("Min Image Count: " + std::to_string(minImageCount), level::info);
+    ANUBIS_LOG_INFO("Min Image Count: {}", minImageCount);
 
     // check against max
     // 0 for surfaceCapabilities.maxImageCount means that there is no limit
     minImageCount = (surfaceCapabilities.maxImageCount > 0 && minImageCount > surfaceCapabilities.maxImageCount)
                         ? surfaceCapabilities.maxImageCount
                         : minImageCount;
-    Logger::printToConsole("Min Image Count (After maxImageCount check): " + std::to_string(minImageCount), level::info);
+    ANUBIS_LOG_INFO("Min Image Count (After maxImageCount check): {}", minImageCount);
 
     // determine imageSharingMode, queueFamilyIndexCount, and pQueueFamilyIndices
     uint32_t queueFamilyIndices[] = {graphicsQueueIndex, presentQueueIndex};
@@ -724,8 +1413,8 @@ void AnubisEngine::createSwapChain(const vk::raii::SwapchainKHR& previousSwapCha
         imageShareMode = vk::SharingMode::eExclusive;
         queueFamilyIndexCount = 0;
     }
-    Logger::printToConsole("Image Share Mode: " + vk::to_string(imageShareMode));
-    Logger::printToConsole("Queue Family Index Count: " + std::to_string(queueFamilyIndexCount));
+    ANUBIS_LOG_INFO("Image Share Mode: {}", vk::to_string(imageShareMode));
+    ANUBIS_LOG_INFO("Queue Family Index Count: {}", queueFamilyIndexCount);
 
     //create the info struct for the swap chain
     vk::SwapchainCreateInfoKHR swapChainCreateInfo
@@ -768,6 +1457,7 @@ void AnubisEngine::createSwapChain(const vk::raii::SwapchainKHR& previousSwapCha
 //  1) moving a window from standard range to high dynamic range monitor
 void AnubisEngine::recreateSwapChain()
 {
+    ANUBIS_PROFILE_FUNCTION();
     int width = 0, height = 0;
     glfwGetFramebufferSize(mainWindow, &width, &height);
     while (width == 0 || height == 0) {
@@ -786,6 +1476,8 @@ void AnubisEngine::recreateSwapChain()
 
     // properly free swap chain resources.
     cleanupSwapChain(false);
+    // the recorded draws set the old extent's viewport
+    invalidateRecordedDraws();
     commandBuffers.clear();
 
     // obvs: see func name
@@ -793,8 +1485,7 @@ void AnubisEngine::recreateSwapChain()
     
     // ImageViews are based on swapChain
     createSwapChainImageViews();
-    createMsaaResources();
-    createDepthResources();
+    createTransientAttachments();
     createCommandBuffers();
 
     Logger::printToConsole("*************************");
@@ -822,6 +1513,7 @@ void AnubisEngine::cleanupSwapChain(bool clearSwapChain)
 
 void AnubisEngine::createSwapChainImageViews()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Swap Chain Image Views *****");
     vk::ImageViewCreateInfo imageViewCreateInfo{
         .viewType = vk::ImageViewType::e2D,
@@ -836,43 +1528,156 @@ void AnubisEngine::createSwapChainImageViews()
     Logger::printToConsole("*************************");
 }
 
-void AnubisEngine::createMsaaResources()
+void AnubisEngine::createHeadlessTargets()
 {
-    Logger::printToConsole("***** Creating MSAA Resources *****");
-    vk::Format msaaFormat = swapChainImageFormat.format;
+    ANUBIS_PROFILE_FUNCTION();
+    Logger::printToConsole("***** Creating Headless Render Targets *****");
+    // same format a window would most likely get, so the pipeline and shaders are the ones measured with a swapchain
+    swapChainImageFormat = {.format = vk::Format::eB8G8R8A8Srgb, .colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear};
+    swapChainExtent = vk::Extent2D{WIDTH, HEIGHT};
+
+    headlessImages.clear();
+    headlessImageMemory.clear();
+    swapChainImages.clear();
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        // the msaa resolve lands here, transfer src for the readback
+        helpers::createImage(swapChainExtent.width, swapChainExtent.height, 1, vk::SampleCountFlagBits::e1, swapChainImageFormat.format,
+            vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+            MemoryPlacements::GpuOnly, headlessImages.emplace_back(nullptr), headlessImageMemory.emplace_back(nullptr),
+            logicalDevice, memoryAllocator, MemoryCategory::eRenderTarget);
+    }
+    for (const auto& image : headlessImages)
+    {
+        swapChainImages.push_back(*image);
+    }
 
-    helpers::createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, msaaFormat,
-        vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransientAttachment | vk::ImageUsageFlagBits::eColorAttachment
-        , vk::MemoryPropertyFlagBits::eDeviceLocal,
-        msaaRenderTargetImage, msaaRenderTargetImageMemory,
-        logicalDevice, physicalDevice
-        );
+    if (!options.readbackPath.empty())
+    {
+        const vk::DeviceSize frameBytes = static_cast<vk::DeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            helpers::createBuffer(frameBytes, vk::BufferUsageFlagBits::eTransferDst, MemoryPlacements::Readback,
+                readbackBuffers.emplace_back(nullptr), readbackBufferMemory.emplace_back(nullptr),
+                logicalDevice, memoryAllocator, AllocationStrategy::eFreeList, MemoryCategory::eStaging);
+        }
+        ANUBIS_LOG_INFO("Readback: {}", options.readbackPath);
+    }
 
-    msaaRenderTargetImageView = helpers::createImageView(msaaRenderTargetImage, msaaFormat, 1, vk::ImageAspectFlagBits::eColor, logicalDevice);
+    ANUBIS_LOG_INFO("Extent: {}x{}", swapChainExtent.width, swapChainExtent.height);
+    ANUBIS_LOG_INFO("Format: {}", vk::to_string(swapChainImageFormat.format));
     Logger::printToConsole("*************************");
 }
 
-void AnubisEngine::createDepthResources()
+void AnubisEngine::writeReadback(const std::string& path, uint32_t frameIndex)
 {
-    Logger::printToConsole("***** Creating Depth Resources *****");
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        ANUBIS_LOG_ERROR("failed to open readback file: {}", path);
+        throw std::runtime_error("failed to open readback file: " + path);
+    }
 
-    //get the depth format
-    vk::Format depthFormat = helpers::findDepthFormat(physicalDevice);
+    const auto* pixels = static_cast<const uint8_t*>(readbackBufferMemory[frameIndex].getMappedData());
+    const bool bgra = swapChainImageFormat.format == vk::Format::eB8G8R8A8Srgb || swapChainImageFormat.format == vk::Format::eB8G8R8A8Unorm;
+    file << "P6\n" << swapChainExtent.width << " " << swapChainExtent.height << "\n255\n";
+    std::vector<uint8_t> row(static_cast<size_t>(swapChainExtent.width) * 3);
+    for (uint32_t y = 0; y < swapChainExtent.height; y++)
+    {
+        const uint8_t* src = pixels + static_cast<size_t>(y) * swapChainExtent.width * 4;
+        for (uint32_t x = 0; x < swapChainExtent.width; x++)
+        {
+            row[x * 3 + 0] = src[x * 4 + (bgra ? 2 : 0)];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + (bgra ? 0 : 2)];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    ANUBIS_LOG_INFO("Wrote frame to {}", path);
+}
 
-    // create the depth image and image view
-    helpers::createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat,
-                         vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment
-                         ,
-                         vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthImageMemory,
-                         logicalDevice, physicalDevice);
+// the render targets that never leave the pass. created unbound, the transient pool places and binds them
+std::vector<TransientAttachmentDesc> AnubisEngine::getTransientAttachmentDescs() const
+{
+    // both are live for the whole (single) scene pass, so they can't alias each other.
+    // passes added later (post processing, shadows) get their own pass index and can share with these
+    return {
+        {.name = "msaa color", .format = swapChainImageFormat.format, .usage = vk::ImageUsageFlagBits::eColorAttachment, .firstPass = 0, .lastPass = 0},
+        {.name = "depth", .format = helpers::findDepthFormat(physicalDevice), .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment, .firstPass = 0, .lastPass = 0}
+    };
+}
 
-    depthImageView = helpers::createImageView(depthImage, depthFormat, 1, vk::ImageAspectFlagBits::eDepth, logicalDevice);
-    
+void AnubisEngine::createTransientAttachments()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    Logger::printToConsole("***** Creating Transient Attachments *****");
+    // the old images are replaced below, their memory goes first
+    transientAttachments.clear();
+
+    const std::vector<TransientAttachmentDesc> descs = getTransientAttachmentDescs();
+    createMsaaResources(descs[0]);
+    createDepthResources(descs[1]);
+    transientAttachments.allocate();
+
+    // views need the memory bound
+    msaaRenderTargetImageView = helpers::createImageView(msaaRenderTargetImage, descs[0].format, 1, vk::ImageAspectFlagBits::eColor, logicalDevice);
+    depthImageView = helpers::createImageView(depthImage, descs[1].format, 1, vk::ImageAspectFlagBits::eDepth, logicalDevice);
+
+    transientAttachments.logStatistics();
+    Logger::printToConsole("*************************");
+}
+
+void AnubisEngine::createMsaaResources(const TransientAttachmentDesc& desc)
+{
+    Logger::printToConsole("Creating MSAA Resources");
+    transientAttachments.add(msaaRenderTargetImage, swapChainExtent, msaaSamples, desc);
+}
+
+void AnubisEngine::createDepthResources(const TransientAttachmentDesc& desc)
+{
+    Logger::printToConsole("Creating Depth Resources");
+    transientAttachments.add(depthImage, swapChainExtent, msaaSamples, desc);
+}
+
+// what the transient attachments cost at every MSAA level the device supports, at the window size and common resolutions
+void AnubisEngine::logTransientAttachmentSavings()
+{
+    Logger::printToConsole("***** Transient Attachment Savings *****");
+    const std::vector<TransientAttachmentDesc> descs = getTransientAttachmentDescs();
+    const bool lazy = memoryAllocator.hasMemoryType(vk::MemoryPropertyFlagBits::eLazilyAllocated);
+    const std::array<vk::Extent2D, 5> extents = {
+        swapChainExtent, vk::Extent2D{1280, 720}, vk::Extent2D{1920, 1080}, vk::Extent2D{2560, 1440}, vk::Extent2D{3840, 2160}
+    };
+
+    for (const vk::Extent2D& extent : extents)
+    {
+        for (auto samples = vk::SampleCountFlagBits::e1; samples <= helpers::getMaxUsableSampleCount(physicalDevice);
+             samples = static_cast<vk::SampleCountFlagBits>(static_cast<uint32_t>(samples) << 1))
+        {
+            const TransientAttachmentPlan plan = TransientAttachmentPool::planFor(logicalDevice, extent, samples, descs);
+            const vk::DeviceSize saved = plan.requestedBytes - plan.aliasedBytes;
+            if (lazy)
+            {
+                ANUBIS_LOG_INFO("{}x{} {}: {} KiB requested, aliasing saves {} KiB, lazy allocation saves up to {} KiB", extent.width, extent.height,
+                    vk::to_string(samples), plan.requestedBytes / 1024, saved / 1024, plan.aliasedBytes / 1024);
+            }
+            else
+            {
+                ANUBIS_LOG_INFO("{}x{} {}: {} KiB requested, aliasing saves {} KiB", extent.width, extent.height, vk::to_string(samples),
+                    plan.requestedBytes / 1024, saved / 1024);
+            }
+        }
+    }
+    if (!lazy)
+    {
+        Logger::printToConsole("No LAZILY_ALLOCATED memory type on this device, nothing saved by lazy allocation", level::info);
+    }
     Logger::printToConsole("*************************");
 }
 
 void AnubisEngine::createTextureImage()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Texture Image *****");
 
     // load the image an upload it into a Vulkan image object
@@ -883,7 +1688,7 @@ void AnubisEngine::createTextureImage()
     vk::DeviceSize imageSize = texWidth * texHeight * 4; // 4 bytes per pixel
 
     mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-    Logger::printToConsole("Mip Levels: " + std::to_string(mipLevels), level::info);
+    ANUBIS_LOG_INFO("Mip Levels: {}", mipLevels);
     
     if (!pixels)
     {
@@ -891,38 +1696,44 @@ void AnubisEngine::createTextureImage()
         throw std::runtime_error("Failed to load texture image!");
     }
 
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    helpers::createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        stagingBuffer, stagingBufferMemory,
-        logicalDevice, physicalDevice);
-
-    // copy the image pixels to the buffer
-    void* data = stagingBufferMemory.mapMemory(0, imageSize);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    stagingBufferMemory.unmapMemory();
-
-    stbi_image_free(pixels);
+    ANUBIS_LOG_INFO("Image Size: {} bytes", imageSize);
 
     vk::Format textureFormat = vk::Format::eR8G8B8A8Srgb;
 
     helpers::createImage(texWidth, texHeight, mipLevels, vk::SampleCountFlagBits::e1, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
                          vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                         vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory,
-                         logicalDevice, physicalDevice);
-
-    // copy staging buffer to image
-    helpers::transitionImageLayoutTexture(textureImage, textureFormat, mipLevels, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, commandPool, logicalDevice, graphicsQueue);
-    helpers::copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), commandPool, logicalDevice, graphicsQueue);
-    // helpers::transitionImageLayoutTexture(textureImage, textureFormat, mipLevels, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, commandPool, logicalDevice, graphicsQueue);
-    // the above transition should happen when generating the mip maps
-    helpers::generateMipmaps(textureImage, textureFormat, mipLevels, texWidth,texHeight, commandPool, logicalDevice, physicalDevice, graphicsQueue);
+                         MemoryPlacements::GpuOnly, textureImage, textureImageMemory,
+                         logicalDevice, memoryAllocator, MemoryCategory::eTexture);
+
+    // transition, copy and mip generation recorded into one batch - one submission, no queue idle in between
+    UploadBatch batch(stagingRing);
+    batch.transitionImage(*textureImage, textureFormat, mipLevels, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    batch.uploadImage(pixels, *textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 4);
+    // the pixels are in the ring now
+    stbi_image_free(pixels);
+    // the transition to shader read only happens when generating the mip maps
+    batch.generateMipmaps(*textureImage, textureFormat, mipLevels, texWidth, texHeight, physicalDevice);
+    // waited on with the rest of the start up uploads
+    batch.submit();
+
+    // sampled between frames, the view and descriptor sets follow it when it moves
+    memoryDefragmenter.registerImage(textureImage, textureImageMemory, textureFormat,
+        {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight)}, mipLevels,
+        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        [this]()
+        {
+            // frames in flight still sample the old view, it goes away with the old image
+            memoryDefragmenter.retire(std::move(textureImageView));
+            createTextureImageView();
+            updateTextureDescriptors();
+        });
     Logger::printToConsole("*************************");
 }
 
 void AnubisEngine::createTextureImageView()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Texture Image View *****");
 
     textureImageView = helpers::createImageView(textureImage, vk::Format::eR8G8B8A8Srgb, mipLevels, vk::ImageAspectFlagBits::eColor, logicalDevice);
@@ -932,6 +1743,7 @@ void AnubisEngine::createTextureImageView()
 
 void AnubisEngine::createTextureImageSampler()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Texture Image Sampler *****");
     vk::PhysicalDeviceProperties deviceProperties = physicalDevice.getProperties();
     vk::SamplerCreateInfo samplerCreateInfo
@@ -962,276 +1774,141 @@ void AnubisEngine::createTextureImageSampler()
 
 void AnubisEngine::createDescriptorSetLayout()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Descriptor Set Layout *****");
 
-    // TODO: it's possible for the shader variable to be an array
-    //  add handling for this
-    std::array bindings = {
-        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
-        // for image sampling related descriptors
-        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr)
-        // NOTE: texture sampling for the vertex shader is usually for height-mapping
-    };
-
-    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo
-    {
-        .bindingCount = static_cast<uint32_t>(bindings.size()),
-        .pBindings = bindings.data()
-    };
-
-    descriptorSetLayout = vk::raii::DescriptorSetLayout(logicalDevice, layoutCreateInfo);
+    // split by how often they change, each set is rebound only when its own data does:
+    //  set 0: per frame - the camera
+    //  set 1: per material - every texture, sampler and the material table, bindless (see BindlessDescriptors.h)
+    //  set 2: per draw - the instance array the draws read (the frame ring, or the culling pass' output when gpu driven)
+    // per object values don't need a set at all, they are push constants (DrawConstants)
+    const vk::DescriptorSetLayoutBinding frameBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eVertex, nullptr);
+    frameSetLayout = vk::raii::DescriptorSetLayout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = 1,
+        .pBindings = &frameBinding
+    });
+
+    // NOTE: texture sampling for the vertex shader is usually for height-mapping
+    // every instance of the frame, indexed by the instance index.
+    //  pushed: written into the command buffer with the draw state, no set to allocate. push descriptors can't be dynamic,
+    //  the frame's slice goes into the pushed offset instead
+    const vk::DescriptorSetLayoutBinding drawBinding(0, pushDescriptorsEnabled ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eStorageBufferDynamic,
+        1, vk::ShaderStageFlagBits::eVertex, nullptr);
+    drawSetLayout = vk::raii::DescriptorSetLayout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+        .flags = pushDescriptorsEnabled ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR : vk::DescriptorSetLayoutCreateFlags{},
+        .bindingCount = 1,
+        .pBindings = &drawBinding
+    });
     Logger::printToConsole("*************************");
 }
 
-void AnubisEngine::createGraphicsPipeline()
+void AnubisEngine::createBindlessDescriptors()
 {
-    Logger::printToConsole("***** Creating Graphics Pipeline *****");
-
-    Logger::printToConsole("Creating Stages:");
-    auto shaderCode = helpers::readFile("shaders/shader.spv");
-    Logger::printToConsole("Shader Binary Size: " + std::to_string(shaderCode.size()), level::info);
-
-    vk::raii::ShaderModule shaderModule = createShaderModule(shaderCode);
-
-    vk::PipelineShaderStageCreateInfo vertShaderStageCreateInfo
-    {
-        // .stage: F12 that shit
-        .stage = vk::ShaderStageFlagBits::eVertex,
-        // .module the code to run
-        .module = shaderModule,
-        // the function to invoke
-        // this means that it’s possible to combine multiple fragment shaders into a single shader module and use different entry points to differentiate between their behaviors.
-        //  TODO:post-process library??
-        .pName = "vertMain",
-
-        // TODO: reseach more into the below
-        // pSpecifializationInfo: allows you to specify values for shader constants.
-        // You can use a single shader module where its behavior can be configured in pipeline creation by specifying different values for the constants used in it.
-        // more efficient than configuring the shader using variables at render time, because the compiler can do optimizations like eliminating if statements that depend on these values.
-        .pSpecializationInfo = nullptr
-    };
-
-    vk::PipelineShaderStageCreateInfo fragShaderStageCreateInfo
-    {
-        .stage = vk::ShaderStageFlagBits::eFragment,
-        .module = shaderModule,
-        .pName = "fragMain",
-        .pSpecializationInfo = nullptr
-    };
-
-    vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageCreateInfo, fragShaderStageCreateInfo};
-
-    Logger::printToConsole("Creating Vertex Input:");
-    
-    // pretty sure this is where we're reading/sending vertex data from/to the GPU
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo
-    {
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
-        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()),
-        .pVertexAttributeDescriptions = attributeDescriptions.data()
-    };
-
-    Logger::printToConsole("Creating Input Assembly:");
-
-    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo
-    {
-        .topology = vk::PrimitiveTopology::eTriangleList,
-        .primitiveRestartEnable = false
-    };
-
-    Logger::printToConsole("Creating Viewport:");
-    // viewport is set/defined in recordCommanBuffer
-    // TODO: Make viewport and scissor states dynamic (more flexibility w/o performance lose?! fuck yeah.)
-    //  update the tutorial musta been reading minds (it provides that option)
-    // viewports define the transformation from the image to the framebuffer
-    vk::Viewport viewport
-    {
-        0.0f,
-        0.0f,
-        static_cast<float>(swapChainExtent.width),
-        static_cast<float>(swapChainExtent.height),
-        // the below is for the frame buffer
-        0.0f,
-        1.0f
-    };
-
-    // scissor rectangles define in which region pixels will actually be stored
-    // cover the swapChainExtent
-    // can be specified as a static/dynamic part of the pipeline
-    // if dynamic = true set in the command buffer
-    vk::Rect2D scissor
-    {
-        vk::Offset2D(0, 0),
-        swapChainExtent
-    };
-
-    // static = renders the viewport and scissor fixed to the swapChainExtent
-    // static version: vk::PipelineViewportStateCreateInfo viewportStateInfo {.viewportCount = 1, .scissorCount = 1};
-    // for dynamic the ACTUAL viewports and scissors will be setup at draw time
-    // also useful for multiple viewports on the GPU
-    vk::PipelineViewportStateCreateInfo viewportStateInfo
-    {
-        .viewportCount = 1,
-        //.pViewports = &viewport,
-        .scissorCount = 1,
-        //.pScissors = &scissor
-    };
-
-    // create the rasterizer
-    Logger::printToConsole("Creating Rasterizer:");
-    // colors fragments, depth testing, face culling and scissor test
-    // output fragments that fill the entire polys or wireframe
-    vk::PipelineRasterizationStateCreateInfo rasterizerInfo
-    {
-        // depthClampEnable = true allows for shadow map creation
-        .depthClampEnable = false,
-        // WILL DISABLE OUTPUT TO THE FRAMEBUFFER IF TRUE
-        .rasterizerDiscardEnable = false,
-        // wires and points
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        //specifies vertex order
-        .frontFace = vk::FrontFace::eCounterClockwise,
-        .depthBiasEnable = false,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp = 0.0f,
-        .depthBiasSlopeFactor = 1.0f,
-        // required for point and wire configurations
-        // values > 1.0 must have wideLines enabled GPU feature
-        .lineWidth = 1.0f
-    };
+    ANUBIS_PROFILE_FUNCTION();
+    bindlessDescriptors.init(logicalDevice, physicalDevice);
+}
 
-    // create the multisampling
-    // enabling requires enabling a GPU feature
-    Logger::printToConsole("Creating Multisampling: [enabled]");
-    // antialiasing
-    vk::PipelineMultisampleStateCreateInfo multisamplingInfo
-    {
-        .rasterizationSamples = msaaSamples,
-        .sampleShadingEnable = true,
-        .minSampleShading = 0.2f,
-        // .pSampleMask = nullptr,
-        // .alphaToCoverageEnable = false,
-        // .alphaToOneEnable = false
-    };
+void AnubisEngine::createMaterials()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    Logger::printToConsole("***** Creating Materials *****");
+    // read every frame, written when a material is added
+    // transfer dst: entries read by frames in flight are rewritten in the frame's command buffer (recordMaterialUpdates)
+    helpers::createBuffer(sizeof(MaterialData) * MaxMaterials, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        MemoryPlacements::Dynamic, materialBuffer, materialBufferMemory, logicalDevice, memoryAllocator);
+    if (bindlessDescriptors.addBuffer(materialBuffer) != MaterialTableSlot)
+    {
+        Logger::printToConsole("The material table has to be the first bindless buffer!", level::err);
+        throw std::runtime_error("The material table has to be the first bindless buffer!");
+    }
 
-    // create depth
-    Logger::printToConsole("Creating Depth: [enabled]");
-    vk::PipelineDepthStencilStateCreateInfo depthStencilInfo
-    {
-        .depthTestEnable = vk::True,
-        .depthWriteEnable = vk::True,
-        .depthCompareOp = vk::CompareOp::eLess,
-        .depthBoundsTestEnable = vk::False,
-        .stencilTestEnable = vk::False
-    };
+    textureSlot = bindlessDescriptors.addTexture(textureImageView);
+    spareTextureSlot = bindlessDescriptors.addTexture(textureImageView);
+    const uint32_t samplerSlot = bindlessDescriptors.addSampler(textureImageSampler);
+    // material 0, every render object's default
+    textureMaterial = addMaterial({.textureIndex = textureSlot, .samplerIndex = samplerSlot});
+    ANUBIS_LOG_INFO("Materials: {} / {}", materialCount, MaxMaterials);
+    Logger::printToConsole("*************************");
+}
 
-    // create color blending
-    Logger::printToConsole("Creating Color Blending: [enabled]");
-    // two ways to color blend
-    //  1) mix old and new to produce final
-    //  2) combine using bitops
-
-    // per attached framebuffer color blending
-    // remember to enable for multiple framebuffers
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment
-    {
-        .blendEnable = false, // new color from the fragment shader is passed through unmodified
-        // .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
-        // .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
-        // .colorBlendOp = vk::BlendOp::eAdd,
-        // .srcAlphaBlendFactor = vk::BlendFactor::eOne,
-        // .dstAlphaBlendFactor = vk::BlendFactor::eZero,
-        // .alphaBlendOp = vk::BlendOp::eAdd,
-        // determine which channels are actually passed through
-        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-    };
-    // global color blending
-    vk::PipelineColorBlendStateCreateInfo colorBlendInfo
+uint32_t AnubisEngine::addMaterial(const MaterialData& material)
+{
+    if (materialCount == MaxMaterials)
     {
-        .logicOpEnable = false,
-        .logicOp = vk::LogicOp::eCopy,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment
-    };
+        ANUBIS_LOG_ERROR("The material table is full! capacity: {}", MaxMaterials);
+        throw std::runtime_error("The material table is full!");
+    }
+    // a new entry, nothing in flight reads it yet
+    static_cast<MaterialData*>(materialBufferMemory.getMappedData())[materialCount] = material;
+    return materialCount++;
+}
 
-    // TODO: implement alpha blending (blend colors based on their opacity during compute)
-    //  finalColor.rgb = newAlpha * newColor + (1 - newAlpha) * oldColor;
-    //  finalColor.a = newAlpha.a;
+void AnubisEngine::createGraphicsPipeline()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    Logger::printToConsole("***** Creating Graphics Pipeline *****");
 
-    Logger::printToConsole("Creating Dynamic States:");
-    // These are the things that can change before triggering recreation of the pipeline
-    // setting these causes the configuration of these values to be ignored, and I should be able to
-    // supply the settings at draw time. Kinda neat.
-    std::vector<vk::DynamicState> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    Logger::printToConsole("Creating Pipeline Layout:");
 
-    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo
+    // per draw values (DrawConstants), written into the command buffer with the draw
+    const vk::PushConstantRange drawConstantsRange
     {
-        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data()
+        .stageFlags = vk::ShaderStageFlagBits::eVertex,
+        .offset = 0,
+        .size = sizeof(DrawConstants)
     };
 
-    Logger::printToConsole("Creating Pipeline Layout:");
+    // set 0: per frame, set 1: per material (bindless), set 2: per draw
+    const std::array setLayouts = {*frameSetLayout, *bindlessDescriptors.getLayout(), *drawSetLayout};
 
     // to specify uniform shader values, they are created throughthe piplineLayoutCreateInfo
     vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo
     {
-        .setLayoutCount = 1,
-        .pSetLayouts = &*descriptorSetLayout,
+        .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+        .pSetLayouts = setLayouts.data(),
         // dynamic values == pushConstant
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &drawConstantsRange
     };
 
     pipelineLayout = vk::raii::PipelineLayout(logicalDevice, pipelineLayoutCreateInfo);
 
-    vk::Format depthFormat = helpers::findDepthFormat(physicalDevice);
-    // using one color attachment with the format of our swap chain
-    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo
-    {
-        .colorAttachmentCount = 1,
-        .pColorAttachmentFormats = &swapChainImageFormat.format,
-        .depthAttachmentFormat = depthFormat
-    };
+    // kept, the draw secondaries inherit it
+    depthFormat = helpers::findDepthFormat(physicalDevice);
+    // every permutation is built by the manager and compiled on its threads (see PipelineManager.h)
+    pipelineManager.init(logicalDevice, pipelineCache, *pipelineLayout, options.pipelineListPath);
 
-    // create the pipeline
-    Logger::printToConsole("Creating Graphics Pipeline:");
-    vk::GraphicsPipelineCreateInfo pipelineCreateInfo
-    {
-        .pNext = &pipelineRenderingCreateInfo,
-        .stageCount = 2,
-        .pStages = shaderStages,
-        .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssemblyInfo,
-        .pTessellationState = nullptr,
-        .pViewportState = &viewportStateInfo,
-        .pRasterizationState = &rasterizerInfo,
-        .pMultisampleState = &multisamplingInfo,
-        .pDepthStencilState = &depthStencilInfo,
-        .pColorBlendState = &colorBlendInfo,
-        .pDynamicState = &dynamicStateCreateInfo,
-        .layout = pipelineLayout,
-        // dynamic rendering allows us to change attachments without creating new render pass objects
-        // eliminate render pass and framebuffer objects
-        // i.e., can refer directly to the image view w/o a framebuffer
-        .renderPass = nullptr,
-        .basePipelineHandle = nullptr,
-        // pipeline inheritance
-        // can only be used if VK_PIPELINE_CREATE_DERIVATIVE_BIT is set in the flags field
-        .basePipelineIndex = -1
+    Logger::printToConsole("Creating Stages:");
+    auto shaderCode = helpers::readFile("shaders/shader.spv");
+    ANUBIS_LOG_INFO("Shader Binary Size: {}", shaderCode.size());
+    pipelineManager.registerShader("shader", shaderCode, "vertMain", "fragMain");
+
+    Logger::printToConsole("Creating Vertex Input:");
+    const auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    pipelineManager.registerVertexLayout("Vertex", Vertex::getBindingDescription(), {attributeDescriptions.begin(), attributeDescriptions.end()});
+
+    // the scene: opaque, depth tested, back faces culled. msaa into the swap chain's format with some sample shading
+    scenePipeline = PipelineDesc
+    {
+        .shader = "shader",
+        .vertexLayout = "Vertex",
+        .colorFormat = swapChainImageFormat.format,
+        .depthFormat = depthFormat,
+        .samples = msaaSamples,
+        .minSampleShading = 0.2f
     };
 
-    // capable of creating multiple pipelines in a single call
-    // pipelineCache
-    graphicsPipeline = vk::raii::Pipeline(logicalDevice, nullptr, pipelineCreateInfo);
+    // compiled now, it stands in for every permutation of the scene's pass that is still compiling
+    Logger::printToConsole("Creating Graphics Pipeline:");
+    pipelineManager.setFallback(scenePipeline);
+    // last session's permutations, in the background
+    pipelineManager.prewarm();
 }
 
 // TODO: move this to a class that can support entities
 void AnubisEngine::loadModel()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Loading Test Model *****");
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -1284,60 +1961,58 @@ void AnubisEngine::loadModel()
     Logger::printToConsole("*************************");
 }
 
-void AnubisEngine::createVertexBuffer()
+void AnubisEngine::createGeometryPool()
 {
-    Logger::printToConsole("***** Creating Vertex Buffer *****");
-    const std::vector<Vertex> vertices = std::get<0>(currentShape);
-    vk::DeviceSize bufferSize = vertices.size() * sizeof(Vertex);
-    
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    helpers::createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        stagingBuffer, stagingBufferMemory,
-        logicalDevice, physicalDevice);
-
-    // map the buffer memory into CPU accessible memory
-    void* data = stagingBufferMemory.mapMemory(0, bufferSize);
-    // this may not be an immediate transfer
-    memcpy(data, vertices.data(), (size_t) bufferSize);
-    stagingBufferMemory.unmapMemory();
-    
-    helpers::createBuffer(bufferSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eDeviceLocal,
-        vertexBuffer, vertexBufferMemory,
-        logicalDevice, physicalDevice);
-
-    helpers::copyBuffer(stagingBuffer, vertexBuffer, bufferSize, commandPool, logicalDevice, graphicsQueue);
-    
-    Logger::printToConsole("*************************");
+    ANUBIS_PROFILE_FUNCTION();
+    geometryPool.init(logicalDevice, memoryAllocator, geometryPlacement);
+    UploadBatch batch(stagingRing);
+    geometryPool.addMesh(std::get<0>(currentShape), std::get<1>(currentShape), batch);
+    // the pool is drawn from right after this, it has to be acquired by the graphics queue first
+    batch.submit().wait();
+    geometryPool.registerMovable(memoryDefragmenter, [this]() { invalidateRecordedDraws(); });
+    invalidateRecordedDraws();
 }
 
-void AnubisEngine::createIndexBuffer()
+// the loaded model once, or a square grid of copies of it with --objects
+void AnubisEngine::createScene()
 {
-    Logger::printToConsole("***** Creating Index Buffer *****");
-    const std::vector<uint32_t> indices = std::get<1>(currentShape);
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-    
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    helpers::createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        stagingBuffer, stagingBufferMemory,
-        logicalDevice, physicalDevice);
-
-    void* data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, indices.data(), (size_t) bufferSize);
-    stagingBufferMemory.unmapMemory();
-    
-    helpers::createBuffer(bufferSize, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eDeviceLocal,
-        indexBuffer, indexBufferMemory,
-        logicalDevice, physicalDevice
-    );
+    ANUBIS_PROFILE_FUNCTION();
+    Logger::printToConsole("***** Creating Scene *****");
+    renderObjects.clear();
+    // the same visible indices can mean other meshes now
+    invalidateRecordedDraws();
+
+    const uint32_t objectCount = std::max(options.sceneObjectCount, 1u);
+    const auto gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+    // shrink the grid so it stays inside the view
+    const float scale = 1.0f / static_cast<float>(gridSize);
+    const float spacing = 40.0f * scale;
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+        const float x = (static_cast<float>(i % gridSize) - static_cast<float>(gridSize - 1) * 0.5f) * spacing;
+        const float z = -static_cast<float>(i / gridSize) * spacing;
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+        transform = glm::scale(transform, glm::vec3(scale));
+        renderObjects.push_back({.meshId = 0, .transform = transform});
+    }
 
-    helpers::copyBuffer(stagingBuffer, indexBuffer, bufferSize, commandPool, logicalDevice, graphicsQueue);
-    
+    // objects of one mesh next to each other, each run is one instanced draw
+    std::ranges::stable_sort(renderObjects, {}, &RenderObject::meshId);
+
+    // the objects spin around their local y axis every frame (updateUniformBuffer). a sphere centered on that axis
+    // that holds the mesh's sphere holds it at any angle, so the bounds are built once here
+    cullBounds.clear();
+    cullBounds.reserve(renderObjects.size());
+    for (const RenderObject& object : renderObjects)
+    {
+        const glm::vec4 meshSphere = geometryPool.getMesh(object.meshId).boundingSphere;
+        const float axisDistance = glm::length(glm::vec2(meshSphere.x, meshSphere.z));
+        cullBounds.add(object.transform, glm::vec4(0.0f, meshSphere.y, 0.0f, meshSphere.w + axisDistance));
+    }
+
+    ANUBIS_LOG_INFO("Render Objects: {}", renderObjects.size());
+    ANUBIS_LOG_INFO("CPU Culling: {}, {} threads", options.cpuCulling ? getCullKernelName(frustumCuller.getKernel()) : "off",
+        workerPool.getWorkerCount());
     Logger::printToConsole("*************************");
 }
 
@@ -1345,150 +2020,182 @@ void AnubisEngine::createIndexBuffer()
 //  Not having to map the buffer every time we need to update, it increases performance.
 void AnubisEngine::createUniformBuffers()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Uniform Buffers *****");
-    uniformBuffers.clear();
-    uniformBuffersMemory.clear();
-    uniformBuffersMapped.clear();
+    // one buffer for every frame in flight: the camera + every instance of the scene (at least the default region)
+    //  the instancing benchmark grows the scene later, room for its largest one
+    const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+    const vk::DeviceSize alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+    const vk::DeviceSize uboSize = (sizeof(UniformBufferObject) + alignment - 1) / alignment * alignment;
+    instanceCapacity = options.benchmarkInstancing ? std::max(InstancingBenchmarkMaxObjects, static_cast<uint32_t>(renderObjects.size()))
+        : static_cast<uint32_t>(renderObjects.size());
+    const vk::DeviceSize instanceBytes = sizeof(InstanceData) * instanceCapacity;
+    // gpu driven frames push the culling constants too
+    const vk::DeviceSize cullSize = (sizeof(CullData) + alignment - 1) / alignment * alignment;
+    frameRing.init(logicalDevice, physicalDevice, memoryAllocator, MAX_FRAMES_IN_FLIGHT,
+        vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+        std::max(FrameRingAllocator::DefaultBytesPerFrame, uboSize + cullSize + instanceBytes));
+    ANUBIS_LOG_INFO("Instance Capacity: {}", instanceCapacity);
+    Logger::printToConsole("*************************");
+}
 
-    vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+void AnubisEngine::createGpuCulling()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    if (!gpuDrivenSupported)
     {
-        // create the buffer
-        vk::raii::Buffer uniformBuffer({});
-        vk::raii::DeviceMemory uniformBufferMemory({});
-        helpers::createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-            uniformBuffer, uniformBufferMemory,
-            logicalDevice, physicalDevice);
+        return;
+    }
+    // same capacity as the CPU written instances, the instancing benchmark grows the scene into it
+    gpuCulling.init(logicalDevice, memoryAllocator, pipelineCache, frameRing.getBuffer(), MAX_FRAMES_IN_FLIGHT, instanceCapacity, geometryPool.getMeshCount());
+    uploadGpuScene();
+}
 
-        uniformBuffers.emplace_back(std::move(uniformBuffer));
-        uniformBuffersMemory.emplace_back(std::move(uniformBufferMemory));
-        uniformBuffersMapped.emplace_back(uniformBuffersMemory[i].mapMemory(0, bufferSize));
+void AnubisEngine::uploadGpuScene()
+{
+    if (!gpuCulling.isInitialized())
+    {
+        return;
     }
-    Logger::printToConsole("*************************");
+    UploadBatch batch(stagingRing);
+    gpuCulling.uploadScene(renderObjects, geometryPool, batch);
+    // read by the next frame's culling pass
+    batch.submit().wait();
 }
 // Descriptor sets can’t be created directly, they must be allocated from a pool like command buffers.
+// sets 0 and 2 belong to a frame in flight, they come out of that frame's pool and are dropped with it (see FrameDescriptorPools.h)
 void AnubisEngine::createDescriptorPool()
 {
-    Logger::printToConsole("***** Creating Descriptor Pool *****");
+    ANUBIS_PROFILE_FUNCTION();
     // describe which descriptor types our descriptor sets are going to contain and how many of them
-    
-    std::array poolSize = {
-        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT),
-        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, MAX_FRAMES_IN_FLIGHT)
-    };
-    //allocate one each frame
-    vk::DescriptorPoolCreateInfo descriptorPoolInfo
+    //  per frame: one frame set (camera) + one draw set (instance array), unless that one is pushed
+    std::vector poolSizes = {vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1)};
+    if (!pushDescriptorsEnabled)
     {
-        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-        .maxSets = MAX_FRAMES_IN_FLIGHT,
-        .poolSizeCount = static_cast<uint32_t>(poolSize.size()),
-        .pPoolSizes = poolSize.data()
-    };
+        poolSizes.emplace_back(vk::DescriptorType::eStorageBufferDynamic, 1);
+    }
+    frameDescriptorPools.init(logicalDevice, MAX_FRAMES_IN_FLIGHT, static_cast<uint32_t>(poolSizes.size()), poolSizes);
 
-    descriptorPool = vk::raii::DescriptorPool(logicalDevice, descriptorPoolInfo);
-    Logger::printToConsole("*************************");
+    // both sets are written through update templates, no WriteDescriptorSet arrays (see DescriptorTemplate.h)
+    frameSetTemplate.init(logicalDevice, *frameSetLayout,
+        {DescriptorTemplate::entry(0, vk::DescriptorType::eUniformBufferDynamic, offsetof(FrameSetData, camera))});
+    if (pushDescriptorsEnabled)
+    {
+        // set 2 of the graphics pipeline layout, pushed by bindDrawState
+        drawSetTemplate.initPush(logicalDevice, *drawSetLayout,
+            {DescriptorTemplate::entry(0, vk::DescriptorType::eStorageBuffer, offsetof(DrawSetData, instances))}, *pipelineLayout, 2);
+    }
+    else
+    {
+        drawSetTemplate.init(logicalDevice, *drawSetLayout,
+            {DescriptorTemplate::entry(0, vk::DescriptorType::eStorageBufferDynamic, offsetof(DrawSetData, instances))});
+    }
 }
 
-void AnubisEngine::createDescriptorSets()
+void AnubisEngine::updateFrameDescriptors()
 {
-    Logger::printToConsole("***** Creating Descriptor Sets *****");
-    // specify the descriptor pool to allocate from, the number to allocate and the layout to base them on
-    // create one for each frame in flight
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *descriptorSetLayout);
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo
-    {
-        .descriptorPool = descriptorPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-    
-    descriptorSets = logicalDevice.allocateDescriptorSets(descriptorSetAllocateInfo);
-
-    //configure the individual descriptorSets
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    ANUBIS_PROFILE_FUNCTION();
+    FrameDescriptors& frame = frameDescriptors[currentFrame];
+    // gpu driven draws read what the culling pass wrote, the CPU paths their slice of the frame ring
+    const vk::Buffer instanceBuffer = gpuDriven ? *gpuCulling.getInstanceBuffer(currentFrame) : *frameRing.getBuffer();
+    const vk::DeviceSize instanceRange = gpuDriven ? gpuCulling.getInstanceBufferSize() : sizeof(InstanceData) * std::max(instanceCapacity, 1u);
+    // the slices move through dynamic offsets, the sets themselves only change with the buffers they point at
+    if (frame.frameSet && frame.instanceBuffer == instanceBuffer && frame.instanceRange == instanceRange)
     {
-        vk::DescriptorBufferInfo bufferInfo
-        {
-            .buffer = uniformBuffers[i],
-            .offset = 0,
-            .range = sizeof(UniformBufferObject)
-        };
+        return;
+    }
 
-        vk::DescriptorImageInfo imageInfo
-        {
-            .sampler = textureImageSampler,
-            .imageView = textureImageView,
-            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
-        };
+    // the frame's fence has signaled, nothing reads its old sets anymore: all of them go at once
+    frameDescriptorPools.reset(currentFrame);
+    frame.frameSet = frameDescriptorPools.allocate(currentFrame, *frameSetLayout);
+    // pushed: nothing to allocate, bindDrawState pushes the instance array with the frame's slice
+    frame.drawSet = pushDescriptorsEnabled ? vk::DescriptorSet{} : frameDescriptorPools.allocate(currentFrame, *drawSetLayout);
+    frame.instanceBuffer = instanceBuffer;
+    frame.instanceRange = instanceRange;
+
+    // the whole ring, the slice is picked by the dynamic offset at bind time
+    frameSetTemplate.update(frame.frameSet, FrameSetData{
+        .camera = {.buffer = frameRing.getBuffer(), .offset = 0, .range = sizeof(UniformBufferObject)}
+    });
+    if (!pushDescriptorsEnabled)
+    {
+        // the instance array, also picked by a dynamic offset
+        drawSetTemplate.update(frame.drawSet, DrawSetData{
+            .instances = {.buffer = instanceBuffer, .offset = 0, .range = instanceRange}
+        });
+    }
 
-        std::array descriptorWrites = {
-            vk::WriteDescriptorSet {
-                        .dstSet = descriptorSets[i],
-                        .dstBinding = 0, //index in the array we want to update
-                        .dstArrayElement = 0,
-                        .descriptorCount = 1,
-                        .descriptorType = vk::DescriptorType::eUniformBuffer,
-                        .pBufferInfo = &bufferInfo
-                    },
-            vk::WriteDescriptorSet {
-                        .dstSet = descriptorSets[i],
-                        .dstBinding = 1,
-                        .dstArrayElement = 0,
-                        .descriptorCount = 1,
-                        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                        .pImageInfo = &imageInfo
-            }
-        };
-        
+    // recorded draws of this frame bind the old sets
+    recordedDraws[currentFrame].valid = false;
+}
 
-        logicalDevice.updateDescriptorSets(descriptorWrites, {});
-    }
-    
-    Logger::printToConsole("*************************");
+void AnubisEngine::updateTextureDescriptors()
+{
+    // the frames in flight read the current slot, it can't be written until they're done. the spare one was last read
+    // before the previous move's copy, which has finished by now - the new view goes there and the slots swap roles
+    std::swap(textureSlot, spareTextureSlot);
+    bindlessDescriptors.updateTexture(textureSlot, textureImageView);
+    // the material follows in the next frame's command buffer, after the frames in flight read the old entry
+    textureMaterialDirty = true;
 }
 
-[[nodiscard]]vk::raii::ShaderModule AnubisEngine::createShaderModule(const std::vector<char>& code) const
+void AnubisEngine::recordMaterialUpdates(const vk::raii::CommandBuffer& commandBuffer)
 {
-    Logger::printToConsole("***** Creating Shader Module *****");
-    vk::ShaderModuleCreateInfo shaderModuleCreateInfo
+    if (!textureMaterialDirty)
     {
-        .codeSize = code.size() * sizeof(char),
-        .pCode = reinterpret_cast<const uint32_t*>(code.data())
-    };
+        return;
+    }
+    textureMaterialDirty = false;
 
-    vk::raii::ShaderModule shaderModule(logicalDevice, shaderModuleCreateInfo);
-    Logger::printToConsole("*************************");
-    return shaderModule;
+    // earlier frames may still read the entry
+    vk::MemoryBarrier2 barrier
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    commandBuffer.updateBuffer<uint32_t>(materialBuffer, sizeof(MaterialData) * textureMaterial + offsetof(MaterialData, textureIndex),
+        textureSlot);
+    // read by this frame's draws
+    barrier = vk::MemoryBarrier2
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        .dstAccessMask = vk::AccessFlagBits2::eMemoryRead
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
 }
 
 void AnubisEngine::initSurfaceCapabilities()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Initializing Surface Capabilities *****");
 
     // get the capabilities
     surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(mainWindowSurface);
     Logger::printToConsole("Surface Capabilities:");
-    Logger::printToConsole("Current Transform: " + vk::to_string(surfaceCapabilities.currentTransform), level::info);
-    Logger::printToConsole("Current Width: " + std::to_string(surfaceCapabilities.currentExtent.width), level::info);
-    Logger::printToConsole("Current Height: " + std::to_string(surfaceCapabilities.currentExtent.height), level::info);
-    Logger::printToConsole("Min Image Count: " + std::to_string(surfaceCapabilities.minImageCount), level::info);
-    Logger::printToConsole("Max Image Count: " + std::to_string(surfaceCapabilities.maxImageCount), level::info);
-    Logger::printToConsole("Min Image Extent Width: " + std::to_string(surfaceCapabilities.minImageExtent.width), level::info);
-    Logger::printToConsole("Min Image Extent Height: " + std::to_string(surfaceCapabilities.minImageExtent.height), level::info);
-    Logger::printToConsole("Max Image Extent Width: " + std::to_string(surfaceCapabilities.maxImageExtent.width), level::info);
-    Logger::printToConsole("Max Image Extent Height: " + std::to_string(surfaceCapabilities.maxImageExtent.height), level::info);
-    Logger::printToConsole("Supported Composite Alpha: " + vk::to_string(surfaceCapabilities.supportedCompositeAlpha), level::info);
-    Logger::printToConsole("Supported Transforms: " + vk::to_string(surfaceCapabilities.supportedTransforms), level::info);
-    Logger::printToConsole("Supported Usage Flags: " + vk::to_string(surfaceCapabilities.supportedUsageFlags), level::info);
-    Logger::printToConsole("Surface Max Image Array Layers: " + std::to_string(surfaceCapabilities.maxImageArrayLayers), level::info);
+    ANUBIS_LOG_INFO("Current Transform: {}", vk::to_string(surfaceCapabilities.currentTransform));
+    ANUBIS_LOG_INFO("Current Width: {}", surfaceCapabilities.currentExtent.width);
+    ANUBIS_LOG_INFO("Current Height: {}", surfaceCapabilities.currentExtent.height);
+    ANUBIS_LOG_INFO("Min Image Count: {}", surfaceCapabilities.minImageCount);
+    ANUBIS_LOG_INFO("Max Image Count: {}", surfaceCapabilities.maxImageCount);
+    ANUBIS_LOG_INFO("Min Image Extent Width: {}", surfaceCapabilities.minImageExtent.width);
+    ANUBIS_LOG_INFO("Min Image Extent Height: {}", surfaceCapabilities.minImageExtent.height);
+    ANUBIS_LOG_INFO("Max Image Extent Width: {}", surfaceCapabilities.maxImageExtent.width);
+    ANUBIS_LOG_INFO("Max Image Extent Height: {}", surfaceCapabilities.maxImageExtent.height);
+    ANUBIS_LOG_INFO("Supported Composite Alpha: {}", vk::to_string(surfaceCapabilities.supportedCompositeAlpha));
+    ANUBIS_LOG_INFO("Supported Transforms: {}", vk::to_string(surfaceCapabilities.supportedTransforms));
+    ANUBIS_LOG_INFO("Supported Usage Flags: {}", vk::to_string(surfaceCapabilities.supportedUsageFlags));
+    ANUBIS_LOG_INFO("Surface Max Image Array Layers: {}", surfaceCapabilities.maxImageArrayLayers);
 
     // get the formats
     surfaceFormats = physicalDevice.getSurfaceFormatsKHR(mainWindowSurface);
     Logger::printToConsole("Surface Formats:");
     for (auto& format : surfaceFormats)
     {
-        Logger::printToConsole(vk::to_string(format.format) + " " + vk::to_string(format.colorSpace), level::info);
+        ANUBIS_LOG_INFO("{} {}", vk::to_string(format.format), vk::to_string(format.colorSpace));
     }
 
     // get the present modes
@@ -1496,7 +2203,7 @@ void AnubisEngine::initSurfaceCapabilities()
     Logger::printToConsole("Surface Present Modes:");
     for (auto& mode : presentModes)
     {
-        Logger::printToConsole(vk::to_string(mode), level::info);
+        ANUBIS_LOG_INFO("{}", vk::to_string(mode));
     }
     Logger::printToConsole("*************************");
 }
@@ -1580,6 +2287,7 @@ void AnubisEngine::framebufferResizeCallback(GLFWwindow* window, int width, int
 
 void AnubisEngine::createCommandPool()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Command Pool *****");
     vk::CommandPoolCreateInfo commandPoolCreateInfo
     {
@@ -1594,8 +2302,16 @@ void AnubisEngine::createCommandPool()
     Logger::printToConsole("*************************");
 }
 
+void AnubisEngine::createStagingRing()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    // copies run on the transfer queue, the uploaded resources are handed to the graphics queue
+    stagingRing.init(logicalDevice, memoryAllocator, transferQueueIndex, transferQueue, graphicsQueueIndex, graphicsQueue);
+}
+
 void AnubisEngine::createCommandBuffers()
 {
+    ANUBIS_PROFILE_FUNCTION();
     Logger::printToConsole("***** Creating Command Buffer *****");
     commandBuffers.clear();
     // allocate the command buffer
@@ -1613,15 +2329,50 @@ void AnubisEngine::createCommandBuffers()
     Logger::printToConsole("*************************");
 }
 
+void AnubisEngine::createFrameCommandPools()
+{
+    ANUBIS_PROFILE_FUNCTION();
+    // one thread records inline into the primary, no secondaries needed - unless they are kept and replayed
+    if (workerPool.getWorkerCount() > 1 || options.drawCache)
+    {
+        frameCommandPools.init(logicalDevice, graphicsQueueIndex, MAX_FRAMES_IN_FLIGHT, workerPool.getWorkerCount());
+    }
+}
+
 void AnubisEngine::recordCommandBuffer(uint32_t imageIndex)
 {
+    ANUBIS_PROFILE_FUNCTION();
     // always begin with ->begin()
     // VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT: The command buffer will be rerecorded right after executing it once.
     // VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: This is a secondary command buffer that will be entirely within a single render pass.
     // VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT: The command buffer can be resubmitted while it is also already pending execution.
     // pInheritanceInfo - It specifies which state to inherit from the calling primary command buffers
     commandBuffers[currentFrame].begin({ });
+    // the scene's permutation once it's compiled, its pass' fallback until then. the draw secondaries bind it too
+    framePipeline = pipelineManager.request(scenePipeline);
+
+    // gpu zones, all no-ops without --profile/--benchmark
+    gpuProfiler.beginFrame(commandBuffers[currentFrame], currentFrame, frameNumber);
 
+    // defragmentation copies go first, the rest of the frame still reads the old resources
+    if (memoryDefragmenter.isActive())
+    {
+        const uint32_t defragZone = gpuProfiler.beginZone(commandBuffers[currentFrame], "defragmentation");
+        memoryDefragmenter.recordMoves(commandBuffers[currentFrame], frameNumber);
+        gpuProfiler.endZone(commandBuffers[currentFrame], defragZone);
+    }
+    // materials of textures that moved
+    recordMaterialUpdates(commandBuffers[currentFrame]);
+
+    // compute work can't be recorded inside rendering, the culling pass runs first
+    if (gpuDriven)
+    {
+        const uint32_t cullZone = gpuProfiler.beginZone(commandBuffers[currentFrame], "gpu culling");
+        gpuCulling.recordCull(commandBuffers[currentFrame], currentFrame, frameCullOffset);
+        gpuProfiler.endZone(commandBuffers[currentFrame], cullZone);
+    }
+
+    const uint32_t transitionZone = gpuProfiler.beginZone(commandBuffers[currentFrame], "layout transitions");
     // transition the image layout to optimal color attachment
     transitionEngineImageLayoutIndex(imageIndex,
         vk::ImageLayout::eUndefined,
@@ -1654,6 +2405,7 @@ void AnubisEngine::recordCommandBuffer(uint32_t imageIndex)
         vk::PipelineStageFlagBits2::eEarlyFragmentTests,
         vk::ImageAspectFlagBits::eDepth// | vk::ImageAspectFlagBits::eStencil
     );
+    gpuProfiler.endZone(commandBuffers[currentFrame], transitionZone);
     
     //set the color attachment
     // clear to black and store the resulting black
@@ -1669,7 +2421,8 @@ void AnubisEngine::recordCommandBuffer(uint32_t imageIndex)
         .resolveImageView = swapChainImageViews[imageIndex],
         .resolveImageLayout = vk::ImageLayout::eColorAttachmentOptimal,
         .loadOp = vk::AttachmentLoadOp::eClear, // what to do before rendering
-        .storeOp = vk::AttachmentStoreOp::eStore, // after rendering
+        // only the resolve survives the pass, the samples stay on chip (and a lazily allocated image never gets backed)
+        .storeOp = vk::AttachmentStoreOp::eDontCare,
         .clearValue = clearColor
     };
 
@@ -1691,48 +2444,292 @@ void AnubisEngine::recordCommandBuffer(uint32_t imageIndex)
         .pDepthAttachment = &depthAttachmentInfo
     };
 
+    // the draw list: instanced batches or single objects, drawsPerFrame times over.
+    // long lists are split across the worker threads, each records its slice into a secondary and the primary executes them.
+    // with the draw cache the secondaries are kept and replayed until something they were recorded from changes
+    const uint32_t passDraws = gpuDriven ? 1 : static_cast<uint32_t>(options.instancing ? instanceBatches.size() : visibleObjects.size());
+    const uint32_t drawItems = passDraws * drawsPerFrame;
+    const uint32_t recordChunks = gpuDriven ? 1 : getRecordChunkCount(drawItems);
+    const bool secondaryDraws = frameCommandPools.isInitialized() && (options.drawCache || recordChunks > 1);
+    if (secondaryDraws)
+    {
+        // nothing but vkCmdExecuteCommands inside this rendering, not even timestamps
+        renderingInfo.flags = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+    }
+
+    const uint32_t renderZone = gpuProfiler.beginZone(commandBuffers[currentFrame], "main pass");
+    const uint32_t drawZone = gpuProfiler.beginZone(commandBuffers[currentFrame], "draws");
     commandBuffers[currentFrame].beginRendering(renderingInfo);
 
     // basic drawing commands
 
-    // bind the graphics pipeline
-    commandBuffers[currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+    // issue the draw command for the triangle,
+    // we technically do not have a vert buffer at this point. verts stored in shader (beginning test shader).
+    // commandBuffers[currentFrame].draw(3, 1, 0, 0);
 
-    // set up viewport and scissor
-    commandBuffers[currentFrame].setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
-    commandBuffers[currentFrame].setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
+    if (secondaryDraws)
+    {
+        executeSecondaryDraws(drawItems, recordChunks);
+    }
+    else
+    {
+        lastDrawsReplayed = false;
+        bindDrawState(commandBuffers[currentFrame]);
+        if (gpuDriven)
+        {
+            // every visible object, however many there are
+            for (uint32_t i = 0; i < drawsPerFrame; i++)
+            {
+                gpuCulling.recordDraw(commandBuffers[currentFrame], currentFrame);
+            }
+        }
+        else
+        {
+            recordDraws(commandBuffers[currentFrame], 0, drawItems);
+        }
+    }
+    drawCallCount = drawItems;
 
-    // bind the vertex buffer
-    commandBuffers[currentFrame].bindVertexBuffers(0, *vertexBuffer, {0});
+    // the msaa resolve and the attachment stores happen when rendering ends.
+    // with secondaries the draws zone can only end after rendering and takes the resolve with it
+    if (!secondaryDraws)
+    {
+        gpuProfiler.endZone(commandBuffers[currentFrame], drawZone);
+    }
+    const uint32_t resolveZone = !secondaryDraws ? gpuProfiler.beginZone(commandBuffers[currentFrame], "msaa resolve") : GpuProfiler::InvalidZone;
+    commandBuffers[currentFrame].endRendering();
+    gpuProfiler.endZone(commandBuffers[currentFrame], resolveZone);
+    if (secondaryDraws)
+    {
+        gpuProfiler.endZone(commandBuffers[currentFrame], drawZone);
+    }
+    gpuProfiler.endZone(commandBuffers[currentFrame], renderZone);
 
-    // bind the index buffer
-    // if the index type changes to uint32_t, update this!!
-    commandBuffers[currentFrame].bindIndexBuffer(*indexBuffer, 0, vk::IndexType::eUint32);
+    const uint32_t outputZone = gpuProfiler.beginZone(commandBuffers[currentFrame], options.headless ? "readback" : "present transition");
+    if (options.headless)
+    {
+        // no presentation, leave the target ready to be copied out
+        transitionEngineImageLayoutIndex(imageIndex,
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageLayout::eTransferSrcOptimal,
+            vk::AccessFlagBits2::eColorAttachmentWrite,
+            vk::AccessFlagBits2::eTransferRead,
+            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            vk::PipelineStageFlagBits2::eTransfer);
 
-    // issue the draw command for the triangle,
-    // we technically do not have a vert buffer at this point. verts stored in shader (beginning test shader).
-    // commandBuffers[currentFrame].draw(3, 1, 0, 0);
+        if (!readbackBuffers.empty())
+        {
+            vk::BufferImageCopy region
+            {
+                .bufferOffset = 0,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                .imageOffset = {0, 0, 0},
+                .imageExtent = {swapChainExtent.width, swapChainExtent.height, 1}
+            };
+            commandBuffers[currentFrame].copyImageToBuffer(swapChainImages[imageIndex], vk::ImageLayout::eTransferSrcOptimal,
+                readbackBuffers[currentFrame], region);
+
+            // read on the host once the frame's fence signaled
+            vk::MemoryBarrier2 barrier
+            {
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+                .dstAccessMask = vk::AccessFlagBits2::eHostRead
+            };
+            commandBuffers[currentFrame].pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+        }
+    }
+    else
+    {
+        // transition the image for presentation
+        transitionEngineImageLayoutIndex(imageIndex,
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageLayout::ePresentSrcKHR,
+            vk::AccessFlagBits2::eColorAttachmentWrite,
+            {},
+            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            vk::PipelineStageFlagBits2::eBottomOfPipe);
+    }
+
+    gpuProfiler.endZone(commandBuffers[currentFrame], outputZone);
+    gpuProfiler.endFrame(commandBuffers[currentFrame]);
+
+    commandBuffers[currentFrame].end();
+}
+
+// pipeline, viewport/scissor, geometry and the frame's descriptor set. nothing is inherited by secondaries,
+// every command buffer that draws binds it all itself
+void AnubisEngine::bindDrawState(const vk::raii::CommandBuffer& commandBuffer) const
+{
+    // bind the graphics pipeline
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, framePipeline);
+
+    // set up viewport and scissor
+    commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
+    commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
+
+    // bind the vertex and index buffer - once for every mesh in the pool
+    geometryPool.bind(commandBuffer);
 
     // update the descriptor sets
     // descriptor sets are not unique to any specific pipeline
     //  they can be either graphic or command
-    commandBuffers[currentFrame].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, *descriptorSets[currentFrame], nullptr);
-    
-    // now using indexing
-    commandBuffers[currentFrame].drawIndexed(static_cast<uint32_t>(std::get<1>(currentShape).size()), 1, 0, 0, 0);
-    
-    commandBuffers[currentFrame].endRendering();
+    // bound once per command buffer, all three in one call (see createDescriptorSetLayout for what's in which)
+    //  the offsets pick this frame's camera (set 0) and instance array (set 2, pushed when the device can).
+    //  gpu driven: the culling pass' instance array of the frame, it has its own buffer
+    const FrameDescriptors& frame = frameDescriptors[currentFrame];
+    const uint32_t instanceOffset = gpuDriven ? 0u : frameInstanceOffset;
+    if (pushDescriptorsEnabled)
+    {
+        // set 2 goes into the command buffer itself, the slice as a plain offset
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+            {frame.frameSet, *bindlessDescriptors.getSet()}, frameUniformOffset);
+        drawSetTemplate.push(commandBuffer, DrawSetData{
+            .instances = {.buffer = frame.instanceBuffer, .offset = instanceOffset, .range = frame.instanceRange}
+        });
+    }
+    else
+    {
+        const std::array sets = {frame.frameSet, *bindlessDescriptors.getSet(), frame.drawSet};
+        const std::array dynamicOffsets = {frameUniformOffset, instanceOffset};
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, sets, dynamicOffsets);
+    }
 
-    // transition the image for presentation
-    transitionEngineImageLayoutIndex(imageIndex,
-        vk::ImageLayout::eColorAttachmentOptimal,
-        vk::ImageLayout::ePresentSrcKHR,
-        vk::AccessFlagBits2::eColorAttachmentWrite,
-        {},
-        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-        vk::PipelineStageFlagBits2::eBottomOfPipe);
+    // instanced and gpu driven draws read the instance array, per object draws push their own constants
+    if (gpuDriven || options.instancing)
+    {
+        const DrawConstants drawConstants{.instanced = 1};
+        commandBuffer.pushConstants<DrawConstants>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, drawConstants);
+    }
+}
 
-    commandBuffers[currentFrame].end();
+// draws [begin, end) of the frame's draw list. only reads engine state, runs on any thread
+void AnubisEngine::recordDraws(const vk::raii::CommandBuffer& commandBuffer, uint32_t begin, uint32_t end) const
+{
+    // now using indexing. each mesh is just a range in the pool
+    // firstInstance points an instanced draw at its objects in the instance array
+    // drawsPerFrame > 1 only while benchmarking, the repeats fail the depth test but still pay for vertex fetch
+    const auto passDraws = static_cast<uint32_t>(options.instancing ? instanceBatches.size() : visibleObjects.size());
+    for (uint32_t item = begin; item < end; item++)
+    {
+        const uint32_t draw = item % passDraws;
+        if (options.instancing)
+        {
+            const InstanceBatch& batch = instanceBatches[draw];
+            const MeshRange& mesh = geometryPool.getMesh(batch.meshId);
+            commandBuffer.drawIndexed(mesh.indexCount, batch.instanceCount, mesh.firstIndex, mesh.vertexOffset, batch.firstInstance);
+        }
+        else
+        {
+            // the object's constants go with the draw, the shader applies the frame's rotation from the UBO.
+            //  nothing here changes from frame to frame, recorded draws stay valid until the scene does
+            const RenderObject& object = renderObjects[visibleObjects[draw]];
+            const DrawConstants drawConstants{.model = object.transform, .materialIndex = object.materialIndex};
+            commandBuffer.pushConstants<DrawConstants>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, drawConstants);
+            const MeshRange& mesh = geometryPool.getMesh(object.meshId);
+            commandBuffer.drawIndexed(mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, 0);
+        }
+    }
+}
+
+uint32_t AnubisEngine::getRecordChunkCount(uint32_t drawItems) const
+{
+    if (!frameCommandPools.isInitialized())
+    {
+        return 1;
+    }
+    // a secondary per thread, unless there are too few draws to be worth the extra command buffers
+    const uint32_t threads = options.recordThreads == 0 ? workerPool.getWorkerCount() : std::min(options.recordThreads, workerPool.getWorkerCount());
+    return std::max(std::min(threads, drawItems / MinDrawsPerSecondary), 1u);
+}
+
+void AnubisEngine::executeSecondaryDraws(uint32_t drawItems, uint32_t chunks)
+{
+    RecordedDraws& recorded = recordedDraws[currentFrame];
+    // the ring offsets repeat frame after frame as long as the same things are pushed, the instance data itself is
+    // rewritten every frame and isn't part of the recording. which objects get drawn in which order is
+    const DrawStreamKey key
+    {
+        .gpuDriven = gpuDriven,
+        .instancing = options.instancing,
+        .drawItems = drawItems,
+        .chunks = chunks,
+        .uniformOffset = frameUniformOffset,
+        .instanceOffset = gpuDriven ? 0u : frameInstanceOffset,
+        .pipeline = framePipeline
+    };
+    const bool unchanged = options.drawCache && recorded.valid && recorded.key == key && (gpuDriven || recorded.visibleObjects == visibleObjects);
+    if (!unchanged)
+    {
+        // last time's secondaries of this frame are done with (its fence signaled), their pools start over
+        frameCommandPools.beginFrame(currentFrame);
+        recordSecondaryDraws(recorded.secondaries, drawItems, chunks);
+        recorded.key = key;
+        recorded.visibleObjects = gpuDriven ? std::vector<uint32_t>{} : visibleObjects;
+        recorded.valid = options.drawCache;
+        drawStreamRecordCount++;
+    }
+    lastDrawsReplayed = unchanged;
+    commandBuffers[currentFrame].executeCommands(recorded.secondaries);
+}
+
+void AnubisEngine::invalidateRecordedDraws()
+{
+    for (RecordedDraws& recorded : recordedDraws)
+    {
+        recorded.valid = false;
+    }
+}
+
+void AnubisEngine::recordSecondaryDraws(std::vector<vk::CommandBuffer>& secondaries, uint32_t drawItems, uint32_t chunks)
+{
+    ANUBIS_PROFILE_FUNCTION();
+    // what the secondaries render into, has to match the beginRendering they are executed in
+    vk::CommandBufferInheritanceRenderingInfo renderingInheritance
+    {
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &swapChainImageFormat.format,
+        .depthAttachmentFormat = depthFormat,
+        .rasterizationSamples = msaaSamples
+    };
+    vk::CommandBufferInheritanceInfo inheritanceInfo{.pNext = &renderingInheritance};
+    // VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: entirely inside the primary's rendering
+    // cached ones are executed again by later frames, one time submit only when they are re-recorded anyway
+    vk::CommandBufferUsageFlags usage = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    if (!options.drawCache)
+    {
+        usage |= vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    }
+    const vk::CommandBufferBeginInfo beginInfo{.flags = usage, .pInheritanceInfo = &inheritanceInfo};
+
+    // every chunk has its own slot, the primary executes them in draw list order whichever thread recorded them.
+    // an empty draw list still gets one (empty) secondary, there is always something to execute
+    const uint32_t chunkSize = std::max((drawItems + chunks - 1) / chunks, 1u);
+    secondaries.assign(std::max((drawItems + chunkSize - 1) / chunkSize, 1u), nullptr);
+    workerPool.parallelFor(secondaries.size() * chunkSize, chunkSize, [&](size_t begin, size_t end, uint32_t worker)
+    {
+        ANUBIS_PROFILE_ZONE("record secondary");
+        vk::raii::CommandBuffer& secondary = frameCommandPools.acquire(currentFrame, worker);
+        secondary.begin(beginInfo);
+        bindDrawState(secondary);
+        if (gpuDriven)
+        {
+            // every visible object, however many there are
+            for (size_t i = begin; i < std::min<size_t>(end, drawItems); i++)
+            {
+                gpuCulling.recordDraw(secondary, currentFrame);
+            }
+        }
+        else
+        {
+            recordDraws(secondary, static_cast<uint32_t>(begin), std::min(static_cast<uint32_t>(end), drawItems));
+        }
+        secondary.end();
+        secondaries[begin / chunkSize] = *secondary;
+    });
 }
 
 // transition the layout to one that is suitable for rendering
@@ -1812,12 +2809,12 @@ void AnubisEngine::compileShader(std::string filename, std::string target, std::
     // vertMain
     // fragMain
     // slang.spv
-    Logger::printToConsole("***** Compiling Shader [" + filename + "] *****");
-    Logger::printToConsole("Target: " + target);
-    Logger::printToConsole("Profile: " + profile);
-    Logger::printToConsole("Vert Entry: " + vertEntry);
-    Logger::printToConsole("Frag Entry: " + fragEntry);
-    Logger::printToConsole("Output Name: " + outputName);
+    ANUBIS_LOG_INFO("***** Compiling Shader [{}] *****", filename);
+    ANUBIS_LOG_INFO("Target: {}", target);
+    ANUBIS_LOG_INFO("Profile: {}", profile);
+    ANUBIS_LOG_INFO("Vert Entry: {}", vertEntry);
+    ANUBIS_LOG_INFO("Frag Entry: {}", fragEntry);
+    ANUBIS_LOG_INFO("Output Name: {}", outputName);
 
     std::string shaderFilePath = "shaders\\" + filename ;
     std::string outputPath = "shaders\\" + outputName;
@@ -1827,7 +2824,7 @@ void AnubisEngine::compileShader(std::string filename, std::string target, std::
     
     int result = system(compileCommand.c_str());
     if (result != 0)
-        Logger::printToConsole("Failed to compile shader: " + std::to_string(result), level::err);
+        ANUBIS_LOG_ERROR("Failed to compile shader: {}", result);
     else
         Logger::printToConsole("Successfully compiled shader!");
     
@@ -4,13 +4,38 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <array>
+#include <chrono>
+
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "BindlessDescriptors.h"
+#include "ChromeTrace.h"
+#include "CpuProfiler.h"
+#include "DescriptorTemplate.h"
 #include "GeneratedShapes.h"
+#include "FrameBenchmark.h"
+#include "FrameCommandPools.h"
+#include "FrameDescriptorPools.h"
+#include "FrameRingAllocator.h"
+#include "FrustumCulling.h"
+#include "GeometryPool.h"
+#include "GpuCulling.h"
+#include "GpuProfiler.h"
 #include "helpers.h"
 #include "ResourceDescriptors.h"
+#include "EngineOptions.h"
 #include "Logger.h"
+#include "MemoryAllocator.h"
+#include "MemoryDefragmenter.h"
+#include "PipelineCache.h"
+#include "PipelineManager.h"
+#include "Scene.h"
+#include "StagingRing.h"
+#include "TransientAttachments.h"
+#include "UploadBatch.h"
+#include "WorkerPool.h"
 
 // TODO: Smooth Window Resize Implementation
 // Steps needed:
@@ -28,13 +53,23 @@ constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 constexpr uint32_t WIDTH = 1280;
 constexpr uint32_t HEIGHT = 720;
 constexpr uint64_t FenceTimeout = 1000000000;
+// --benchmark animates by frame count instead of wall clock, every run renders the same frames
+constexpr float BenchmarkTimestep = 1.0f / 60.0f;
+// --bench-instancing scales the scene up to this many objects
+constexpr uint32_t InstancingBenchmarkMaxObjects = 100000;
+// entries in the bindless material table
+constexpr uint32_t MaxMaterials = 1024;
+// fewer draws than this per thread aren't split any further, another secondary isn't worth it
+constexpr uint32_t MinDrawsPerSecondary = 256;
 const std::string MODEL_PATH = "models/test_skull.obj";
 const std::string TEXTURE_PATH = "textures/test_skull.jpg";
 //const std::string TEXTURE_PATH = "textures/heart_texture.png";
 class AnubisEngine
 {
 public:
-    void run();
+    explicit AnubisEngine(const EngineOptions& options = {}) : options(options) {}
+    // EXIT_FAILURE when the frame benchmark regressed against its baseline
+    [[nodiscard]] int run();
 
 private:
     // window/render functions
@@ -44,27 +79,47 @@ private:
     void recreateSwapChain();
     void cleanupSwapChain(bool clearSwapChain);
     void createSwapChainImageViews();
-    void createMsaaResources();
-    void createDepthResources();
+    // headless: engine owned images stand in for the swapchain images
+    void createHeadlessTargets();
+    // writes a frame copied back with --readback as a binary ppm
+    void writeReadback(const std::string& path, uint32_t frameIndex);
+    std::vector<TransientAttachmentDesc> getTransientAttachmentDescs() const;
+    void createTransientAttachments();
+    void createMsaaResources(const TransientAttachmentDesc& desc);
+    void createDepthResources(const TransientAttachmentDesc& desc);
+    void logTransientAttachmentSavings();
 
     // TODO: these might need to be abstracted to an image library class
     void createTextureImage();
     void createTextureImageView();
     void createTextureImageSampler();
+    // points the texture's bindless slot at the current texture view (after the texture was moved), never one a frame
+    // in flight reads
+    void updateTextureDescriptors();
+    // the material table entries updateTextureDescriptors changed, rewritten on the GPU timeline
+    void recordMaterialUpdates(const vk::raii::CommandBuffer& commandBuffer);
+    // the bindless set (see BindlessDescriptors.h), set 1 of the graphics pipeline
+    void createBindlessDescriptors();
+    // the material table + the model's texture and sampler in their bindless slots
+    void createMaterials();
+    // the material's index in the table, what RenderObject::materialIndex refers to
+    uint32_t addMaterial(const MaterialData& material);
     //
     
     void createDescriptorSetLayout();
     void createGraphicsPipeline();
     void loadModel();
-    void createVertexBuffer();
-    void createIndexBuffer();
+    void createGeometryPool();
+    void createScene();
     void createUniformBuffers();
+    // --gpu-driven: the scene on the GPU + the culling pass (see GpuCulling.h)
+    void createGpuCulling();
+    // after every createScene while gpu driven
+    void uploadGpuScene();
+    // the per frame pools of sets 0 and 2
     void createDescriptorPool();
-    // TODO:  it is actually possible to bind multiple descriptor sets simultaneously.
-    //  You need to specify a descriptor set layout for each descriptor set when creating the pipeline layout.
-    //  You can use this feature to put descriptors that vary per-object and descriptors that are shared into separate descriptor sets.
-    void createDescriptorSets();
-    [[nodiscard]] vk::raii::ShaderModule createShaderModule(const std::vector<char>& code) const;
+    // sets 0 and 2 of the frame, written again (out of a reset pool) only when the buffers behind them changed
+    void updateFrameDescriptors();
     void initSurfaceCapabilities();
     vk::SurfaceFormatKHR chooseSwapSurfaceFormat();
     vk::PresentModeKHR chooseSwapPresentMode();
@@ -73,8 +128,21 @@ private:
 
     // command functions
     void createCommandPool();
+    void createStagingRing();
     void createCommandBuffers();
+    // per worker, per frame pools for the draw secondaries
+    void createFrameCommandPools();
     void recordCommandBuffer(uint32_t imageIndex);
+    void bindDrawState(const vk::raii::CommandBuffer& commandBuffer) const;
+    void recordDraws(const vk::raii::CommandBuffer& commandBuffer, uint32_t begin, uint32_t end) const;
+    // 1 = record inline
+    [[nodiscard]] uint32_t getRecordChunkCount(uint32_t drawItems) const;
+    // replays the frame's recorded draws, or records them again when the draw stream changed
+    void executeSecondaryDraws(uint32_t drawItems, uint32_t chunks);
+    // the draw list split across the worker pool into secondaries, in execution order
+    void recordSecondaryDraws(std::vector<vk::CommandBuffer>& secondaries, uint32_t drawItems, uint32_t chunks);
+    // scene, geometry, swap chain or descriptors changed: every frame records its draws again
+    void invalidateRecordedDraws();
     void transitionEngineImageLayoutIndex(uint32_t imageIndex, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlagBits2 srcAccessMask,
         vk::AccessFlagBits2 dstAccessMask, vk::PipelineStageFlagBits2 srcStageMask, vk::PipelineStageFlagBits2 dstStageMask);
     void transitionEngineImageLayoutImage(vk::raii::Image& image,
@@ -108,10 +176,30 @@ private:
     void pickPhysicalDevice();
     uint32_t findQueueIndex(vk::PhysicalDevice device, const vk::QueueFlagBits flag);
     uint32_t findPresentQueueIndex(vk::PhysicalDevice device, uint32_t& graphicsQueueIndex);
+    uint32_t findTransferQueueIndex(vk::PhysicalDevice device);
     void createLogicalDevice();
+    void createMemoryAllocator();
+    // loaded from disk, every pipeline is created through it (see PipelineCache.h)
+    void createPipelineCache();
+    void onMemoryPressure(const MemoryPressureEvent& event);
 
     // main execution functions
     void mainLoop();
+    // window events, nothing to do headless
+    void pollEvents();
+    [[nodiscard]] bool windowShouldClose() const;
+    // draws the test model with the geometry in every memory placement the device offers
+    void runMemoryPlacementBenchmark();
+    // 1 -> 100k objects, one draw per object vs one instanced draw per mesh (vs one indirect draw when gpu driven)
+    void runInstancingBenchmark();
+    // per object draws recorded on more and more threads
+    void runRecordingBenchmark();
+    // per draw descriptor updates: writes vs templates vs push descriptors (see DescriptorTemplate.h)
+    void runDescriptorBenchmark();
+    // fixed timestep, scripted camera. per frame CPU/GPU/present times -> percentiles and a JSON report
+    // the number of regressions against --bench-baseline (0 without one)
+    uint32_t runFrameBenchmark();
+    void recordFrameTiming(uint64_t submittedFrame, double cpuMs);
     void drawFrame();
     void updateUniformBuffer(uint32_t currentImage);
     void cleanUpBuffers();
@@ -119,10 +207,19 @@ private:
 
     // synchronization functions
     void createSyncObjects();
+
+    // cpu zones (--profile) and the --trace capture
+    void startProfiling();
+    // gpu zones (--profile, --benchmark)
+    void createGpuProfiler();
+    // the frame slot's fence has signaled, its zones are ready without waiting
+    void collectGpuZones(uint32_t frameIndex);
     
 private:
+    EngineOptions options;
+
     // window/render members
-    GLFWwindow* mainWindow;
+    GLFWwindow* mainWindow = nullptr;
     vk::raii::SurfaceKHR mainWindowSurface = nullptr;
     vk::SurfaceCapabilitiesKHR surfaceCapabilities;
     std::vector<vk::SurfaceFormatKHR> surfaceFormats;
@@ -132,28 +229,96 @@ private:
     vk::raii::SwapchainKHR swapChain = nullptr;
     std::vector<vk::Image> swapChainImages;
     std::vector<vk::raii::ImageView> swapChainImageViews;
-    vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
-    vk::raii::DescriptorPool descriptorPool = nullptr;
-    std::vector<vk::raii::DescriptorSet> descriptorSets;
+    // headless: what swapChainImages point at, one per frame in flight
+    std::vector<vk::raii::Image> headlessImages;
+    std::vector<MemoryAllocation> headlessImageMemory;
+    // headless --readback: every frame's color is copied into its frame's buffer
+    std::vector<vk::raii::Buffer> readbackBuffers;
+    std::vector<MemoryAllocation> readbackBufferMemory;
+    // set 0 (per frame) and set 2 (per draw), set 1 is bindlessDescriptors
+    vk::raii::DescriptorSetLayout frameSetLayout = nullptr;
+    vk::raii::DescriptorSetLayout drawSetLayout = nullptr;
+    // VK_KHR_push_descriptor (optional): set 2 is pushed with the draw state instead of allocated
+    bool pushDescriptorsEnabled = false;
+    // sets 0 and 2 of every frame in flight, reset wholesale (see FrameDescriptorPools.h)
+    FrameDescriptorPools frameDescriptorPools;
+    // what the templates read, one buffer info per binding (see DescriptorTemplate.h)
+    struct FrameSetData
+    {
+        vk::DescriptorBufferInfo camera;
+    };
+    struct DrawSetData
+    {
+        vk::DescriptorBufferInfo instances;
+    };
+    DescriptorTemplate frameSetTemplate;
+    // writes the pooled draw set, or pushes it
+    DescriptorTemplate drawSetTemplate;
+    struct FrameDescriptors
+    {
+        vk::DescriptorSet frameSet;
+        // null when pushed
+        vk::DescriptorSet drawSet;
+        // what drawSet points at
+        vk::Buffer instanceBuffer;
+        vk::DeviceSize instanceRange = 0;
+    };
+    std::array<FrameDescriptors, MAX_FRAMES_IN_FLIGHT> frameDescriptors;
     vk::raii::PipelineLayout pipelineLayout = nullptr;
-    vk::raii::Pipeline graphicsPipeline = nullptr;
-
-    // TODO: Driver developers recommend that multiple buffers should be stored in a single buffer
-    //  oh. just like vertex and index buffers. investigate this improvement
-    //  reason: data that is sent is more 'cache friendly'
-    //      reuse of same memory chunks for multiple resources (if not used for the same render operations)
-    //      and provided that their data is refreshed (instancing??)
-    vk::raii::Buffer indexBuffer = nullptr;
-    vk::raii::Buffer vertexBuffer = nullptr;
-    vk::raii::DeviceMemory indexBufferMemory = nullptr;
-    vk::raii::DeviceMemory vertexBufferMemory = nullptr;
-
-    std::vector<vk::raii::Buffer> uniformBuffers;
-    std::vector<vk::raii::DeviceMemory> uniformBuffersMemory;
-    std::vector<void*> uniformBuffersMapped;
+    // every graphics pipeline permutation, compiled in the background (see PipelineManager.h)
+    PipelineManager pipelineManager;
+    PipelineDesc scenePipeline;
+    // what this frame's draws bind, resolved once per frame on the main thread
+    vk::Pipeline framePipeline;
+    // every texture and sampler + the material table, indexed by the shaders (see BindlessDescriptors.h)
+    BindlessDescriptors bindlessDescriptors;
+    vk::raii::Buffer materialBuffer = nullptr;
+    MemoryAllocation materialBufferMemory = nullptr;
+    uint32_t materialCount = 0;
 
+    // every mesh's vertices and indices live in one buffer (see GeometryPool.h)
+    //  bound once per frame, draws index into it through the mesh table
+    GeometryPool geometryPool;
+    // where the pool lives. device local + staging copy unless benchmarking other placements
+    MemoryPlacement geometryPlacement = MemoryPlacements::GpuOnly;
+    // objects drawn every frame, sorted by mesh
+    std::vector<RenderObject> renderObjects;
+    // world bounds of renderObjects for the CPU culling (see FrustumCulling.h), built with the scene
+    CullBounds cullBounds;
+    FrustumCuller frustumCuller;
+    // the objects in this frame's frustum, ascending (so still sorted by mesh)
+    std::vector<uint32_t> visibleObjects;
+    // one instanced draw per mesh of the visible objects, rebuilt every frame (see Scene.h)
+    std::vector<InstanceBatch> instanceBatches;
+    // CPU work split across cores (culling, command recording)
+    WorkerPool workerPool;
+    uint32_t drawsPerFrame = 1;
+    // drawIndexed calls recorded by the last frame
+    uint32_t drawCallCount = 0;
+    // drawFrame minus the fence wait, last frame
+    double lastFrameCpuMs = 0.0;
+    // recordCommandBuffer alone, last frame
+    double lastRecordMs = 0.0;
+
+    // per-frame uniforms are sliced out of one persistently mapped ring (see FrameRingAllocator.h)
+    //  binding 0 is a dynamic uniform buffer (camera), binding 2 a dynamic storage buffer (every instance of the frame)
+    //  both are selected by dynamic offsets, one bind per frame
+    FrameRingAllocator frameRing;
+    uint32_t frameUniformOffset = 0;
+    uint32_t frameInstanceOffset = 0;
+    // instances the ring has room for each frame
+    uint32_t instanceCapacity = 0;
+
+    // --gpu-driven and the device can: the instances, draws and their count come from the culling pass.
+    //  the frame's draw set (set 2) points at the culling pass' instance array then
+    bool gpuDrivenSupported = false;
+    bool gpuDriven = false;
+    GpuCulling gpuCulling;
+    uint32_t frameCullOffset = 0;
+
+    // msaa color + depth memory: lazily allocated when possible, aliased where lifetimes allow (see TransientAttachments.h)
+    TransientAttachmentPool transientAttachments;
     vk::raii::Image depthImage = nullptr;
-    vk::raii::DeviceMemory depthImageMemory = nullptr;
     vk::raii::ImageView depthImageView = nullptr;
 
     vk::SampleCountFlagBits msaaSamples = vk::SampleCountFlagBits::e1;
@@ -168,9 +333,50 @@ private:
 
     // command buffer
     vk::raii::CommandPool commandPool = nullptr;
+    // every host -> device upload goes through this ring (see StagingRing.h)
+    StagingRing stagingRing;
     std::vector<vk::raii::CommandBuffer> commandBuffers;
+    // draws recorded on the workers (see FrameCommandPools.h)
+    FrameCommandPools frameCommandPools;
+    // what a frame's recorded draws depend on besides the scene and swap chain (those invalidate outright)
+    struct DrawStreamKey
+    {
+        bool gpuDriven = false;
+        bool instancing = false;
+        uint32_t drawItems = 0;
+        uint32_t chunks = 0;
+        uint32_t uniformOffset = 0;
+        uint32_t instanceOffset = 0;
+        // the fallback until the real pipeline is compiled
+        vk::Pipeline pipeline;
+        bool operator==(const DrawStreamKey&) const = default;
+    };
+    // a frame's draw secondaries in execution order and what they were recorded from.
+    //  kept per frame in flight: each frame binds its own descriptor set and ring region
+    struct RecordedDraws
+    {
+        DrawStreamKey key;
+        std::vector<uint32_t> visibleObjects;
+        std::vector<vk::CommandBuffer> secondaries;
+        bool valid = false;
+    };
+    std::array<RecordedDraws, MAX_FRAMES_IN_FLIGHT> recordedDraws;
+    // the last frame executed its draws as recorded by an earlier one
+    bool lastDrawsReplayed = false;
+    uint64_t drawStreamRecordCount = 0;
+    vk::Format depthFormat = vk::Format::eUndefined;
     uint32_t semaphoreIndex = 0;
     uint32_t currentFrame = 0;
+    // frames submitted so far, frame n has finished once the fence of frame n + MAX_FRAMES_IN_FLIGHT was waited on
+    uint64_t frameNumber = 0;
+
+    // frame timing for --benchmark (see FrameBenchmark.h)
+    FrameBenchmark frameBenchmark;
+    std::chrono::high_resolution_clock::time_point lastPresentTime;
+    // named GPU zones around the parts of the frame (see GpuProfiler.h), the whole frame feeds the benchmark
+    GpuProfiler gpuProfiler;
+    // --trace: CPU and GPU zones on one timeline
+    ChromeTrace trace;
 
     // vulkan members
     vk::raii::Context context;
@@ -198,11 +404,22 @@ private:
         vk::KHRCreateRenderpass2ExtensionName
     };
     vk::raii::Device logicalDevice = nullptr;
+    // every buffer/image allocation goes through here. declared after the device so it is destroyed first
+    MemoryAllocator memoryAllocator;
+    // VK_EXT_memory_budget is optional, the allocator estimates without it
+    bool memoryBudgetEnabled = false;
+    // moves resources out of sparse blocks a few per frame (see MemoryDefragmenter.h)
+    MemoryDefragmenter memoryDefragmenter;
+    // saved on cleanup, warm on the next start up
+    PipelineCache pipelineCache;
     float graphicsQueuePriority = 0.0f;
     vk::raii::Queue graphicsQueue = nullptr;
     uint32_t graphicsQueueIndex = 0;
     vk::raii::Queue presentQueue = nullptr;
     uint32_t presentQueueIndex = 0;
+    // uploads run here. a dedicated transfer family when the device has one, otherwise the graphics queue
+    vk::raii::Queue transferQueue = nullptr;
+    uint32_t transferQueueIndex = 0;
 
     // testing shape
     std::tuple<std::vector<Vertex>, std::vector<uint32_t>> currentShape;// = GeneratedShapes::getDualRectangle();
@@ -211,12 +428,17 @@ private:
     //  Image Library??
     uint32_t mipLevels;
     vk::raii::Image textureImage = nullptr;
-    vk::raii::DeviceMemory textureImageMemory = nullptr;
+    MemoryAllocation textureImageMemory = nullptr;
     vk::raii::ImageView textureImageView = nullptr;
     vk::raii::Sampler textureImageSampler = nullptr;
+    // its bindless slot + the one it moves into next (see updateTextureDescriptors)
+    uint32_t textureSlot = 0;
+    uint32_t spareTextureSlot = 0;
+    // the material sampling it, its entry still has to follow a move
+    uint32_t textureMaterial = 0;
+    bool textureMaterialDirty = false;
 
     // TODO: dynamic render targets??
     vk::raii::Image msaaRenderTargetImage = nullptr;
-    vk::raii::DeviceMemory msaaRenderTargetImageMemory = nullptr;
     vk::raii::ImageView msaaRenderTargetImageView = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "BindlessDescriptors.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "Logger.h"
+
+namespace
+{
+    // every binding: slots may stay empty, may be written while the set is bound, and ones no pending command buffer
+    // reads may be written while frames are in flight
+    constexpr vk::DescriptorBindingFlags BindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+        vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    constexpr vk::ShaderStageFlags BindlessStages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment |
+        vk::ShaderStageFlagBits::eCompute;
+}
+
+bool BindlessDescriptors::isSupported(const vk::PhysicalDeviceVulkan12Features& features)
+{
+    return features.descriptorIndexing && features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound
+        && features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind
+        && features.descriptorBindingUpdateUnusedWhilePending
+        && features.shaderSampledImageArrayNonUniformIndexing && features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+vk::PhysicalDeviceVulkan12Features BindlessDescriptors::getRequiredFeatures()
+{
+    // samplers have no update after bind feature of their own, they are always allowed
+    return vk::PhysicalDeviceVulkan12Features{
+        .descriptorIndexing = true,
+        .shaderSampledImageArrayNonUniformIndexing = true,
+        .shaderStorageBufferArrayNonUniformIndexing = true,
+        .descriptorBindingSampledImageUpdateAfterBind = true,
+        .descriptorBindingStorageBufferUpdateAfterBind = true,
+        .descriptorBindingUpdateUnusedWhilePending = true,
+        .descriptorBindingPartiallyBound = true,
+        .runtimeDescriptorArray = true
+    };
+}
+
+void BindlessDescriptors::init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice,
+    uint32_t maxTextures, uint32_t maxSamplers, uint32_t maxBuffers)
+{
+    Logger::printToConsole("***** Creating Bindless Descriptors *****");
+    device = &logicalDevice;
+
+    // the update after bind limits are separate (and on some devices lower) than the regular ones
+    const auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+    textures = {.name = "texture", .capacity = std::min({maxTextures, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages})};
+    samplers = {.name = "sampler", .capacity = std::min({maxSamplers, limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers})};
+    buffers = {.name = "buffer", .capacity = std::min({maxBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers})};
+
+    std::array bindings = {
+        vk::DescriptorSetLayoutBinding(TextureBinding, vk::DescriptorType::eSampledImage, textures.capacity, BindlessStages, nullptr),
+        vk::DescriptorSetLayoutBinding(SamplerBinding, vk::DescriptorType::eSampler, samplers.capacity, BindlessStages, nullptr),
+        vk::DescriptorSetLayoutBinding(BufferBinding, vk::DescriptorType::eStorageBuffer, buffers.capacity, BindlessStages, nullptr)
+    };
+    const std::array<vk::DescriptorBindingFlags, 3> bindingFlags = {BindingFlags, BindingFlags, BindingFlags};
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo
+    {
+        .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data()
+    };
+    layout = vk::raii::DescriptorSetLayout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+        .pNext = &bindingFlagsInfo,
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    });
+
+    // exactly the one set
+    std::array poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, textures.capacity),
+        vk::DescriptorPoolSize(vk::DescriptorType::eSampler, samplers.capacity),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, buffers.capacity)
+    };
+    pool = vk::raii::DescriptorPool(logicalDevice, vk::DescriptorPoolCreateInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        .maxSets = 1,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    });
+    vk::raii::DescriptorSets sets(logicalDevice, vk::DescriptorSetAllocateInfo{
+        .descriptorPool = pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*layout
+    });
+    set = std::move(sets.front());
+
+    ANUBIS_LOG_INFO("Texture Slots: {}", textures.capacity);
+    ANUBIS_LOG_INFO("Sampler Slots: {}", samplers.capacity);
+    ANUBIS_LOG_INFO("Buffer Slots: {}", buffers.capacity);
+    Logger::printToConsole("*************************");
+}
+
+void BindlessDescriptors::clear()
+{
+    // the pool has no FREE_DESCRIPTOR_SET, the set goes with it instead of being freed on its own
+    set.release();
+    pool.clear();
+    pool = nullptr;
+    layout.clear();
+    layout = nullptr;
+    textures = {.name = "texture"};
+    samplers = {.name = "sampler"};
+    buffers = {.name = "buffer"};
+    device = nullptr;
+}
+
+uint32_t BindlessDescriptors::addTexture(vk::ImageView imageView)
+{
+    const uint32_t slot = textures.allocate();
+    updateTexture(slot, imageView);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addSampler(vk::Sampler sampler)
+{
+    const uint32_t slot = samplers.allocate();
+    writeImage(SamplerBinding, slot, vk::DescriptorImageInfo{.sampler = sampler}, vk::DescriptorType::eSampler);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    const uint32_t slot = buffers.allocate();
+    updateBuffer(slot, buffer, offset, range);
+    return slot;
+}
+
+void BindlessDescriptors::updateTexture(uint32_t slot, vk::ImageView imageView)
+{
+    writeImage(TextureBinding, slot, vk::DescriptorImageInfo{
+        .imageView = imageView,
+        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+    }, vk::DescriptorType::eSampledImage);
+}
+
+void BindlessDescriptors::updateBuffer(uint32_t slot, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    const vk::DescriptorBufferInfo bufferInfo{.buffer = buffer, .offset = offset, .range = range};
+    device->updateDescriptorSets(vk::WriteDescriptorSet{
+        .dstSet = set,
+        .dstBinding = BufferBinding,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &bufferInfo
+    }, {});
+}
+
+void BindlessDescriptors::writeImage(uint32_t binding, uint32_t slot, const vk::DescriptorImageInfo& imageInfo, vk::DescriptorType type)
+{
+    device->updateDescriptorSets(vk::WriteDescriptorSet{
+        .dstSet = set,
+        .dstBinding = binding,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = type,
+        .pImageInfo = &imageInfo
+    }, {});
+}
+
+uint32_t BindlessDescriptors::SlotAllocator::allocate()
+{
+    if (!freeSlots.empty())
+    {
+        // lowest first, keeps the used part of the array dense
+        const auto lowest = std::ranges::min_element(freeSlots);
+        const uint32_t slot = *lowest;
+        freeSlots.erase(lowest);
+        return slot;
+    }
+    if (next == capacity)
+    {
+        ANUBIS_LOG_ERROR("Bindless {} slots are full! capacity: {}", name, capacity);
+        throw std::runtime_error("Bindless descriptor slots are full!");
+    }
+    return next++;
+}
+
+void BindlessDescriptors::SlotAllocator::release(uint32_t slot)
+{
+    freeSlots.push_back(slot);
+}
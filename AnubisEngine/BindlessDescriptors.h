@@ -0,0 +1,78 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// one descriptor set holding every texture, sampler and storage buffer the shaders can reach, each picked by its slot.
+// the bindings are partially bound (unwritten slots are fine as long as nothing reads them) and update after bind
+// (a slot can be written while command buffers binding the set are recorded or pending, as long as they don't read
+// that slot), so adding a texture is a single descriptor write into a free slot: no new set, no new layout, no rebind.
+// draws that use different textures only differ in an index, so they can share one instanced or indirect draw.
+// needs descriptor indexing (Vulkan 1.2, see isSupported)
+//
+//  binding 0: Texture2D textures[]            (slot = addTexture)
+//  binding 1: SamplerState samplers[]         (slot = addSampler)
+//  binding 2: StructuredBuffer buffers[]      (slot = addBuffer)
+class BindlessDescriptors
+{
+public:
+    static constexpr uint32_t TextureBinding = 0;
+    static constexpr uint32_t SamplerBinding = 1;
+    static constexpr uint32_t BufferBinding = 2;
+    // clamped to the device's update after bind limits
+    static constexpr uint32_t DefaultMaxTextures = 4096;
+    static constexpr uint32_t DefaultMaxSamplers = 32;
+    static constexpr uint32_t DefaultMaxBuffers = 1024;
+
+    // the Vulkan 1.2 features the set needs, checked when picking the device
+    [[nodiscard]] static bool isSupported(const vk::PhysicalDeviceVulkan12Features& features);
+    // the same features, to enable on the device
+    [[nodiscard]] static vk::PhysicalDeviceVulkan12Features getRequiredFeatures();
+
+    void init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice,
+        uint32_t maxTextures = DefaultMaxTextures, uint32_t maxSamplers = DefaultMaxSamplers, uint32_t maxBuffers = DefaultMaxBuffers);
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return device != nullptr; }
+
+    // a free slot pointed at the resource. the image has to be in SHADER_READ_ONLY_OPTIMAL when sampled
+    uint32_t addTexture(vk::ImageView imageView);
+    uint32_t addSampler(vk::Sampler sampler);
+    uint32_t addBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = vk::WholeSize);
+    // repoint a slot (a moved resource). frames in flight must not read the slot
+    void updateTexture(uint32_t slot, vk::ImageView imageView);
+    void updateBuffer(uint32_t slot, vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = vk::WholeSize);
+    // the slot is handed out again, nothing may still read it
+    void removeTexture(uint32_t slot) { textures.release(slot); }
+    void removeSampler(uint32_t slot) { samplers.release(slot); }
+    void removeBuffer(uint32_t slot) { buffers.release(slot); }
+
+    [[nodiscard]] const vk::raii::DescriptorSetLayout& getLayout() const { return layout; }
+    [[nodiscard]] const vk::raii::DescriptorSet& getSet() const { return set; }
+    [[nodiscard]] uint32_t getTextureCapacity() const { return textures.capacity; }
+
+private:
+    // lowest free slot first, released ones are reused before new ones
+    struct SlotAllocator
+    {
+        const char* name = "";
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> freeSlots;
+
+        uint32_t allocate();
+        void release(uint32_t slot);
+    };
+
+    void writeImage(uint32_t binding, uint32_t slot, const vk::DescriptorImageInfo& imageInfo, vk::DescriptorType type);
+
+    const vk::raii::Device* device = nullptr;
+    vk::raii::DescriptorSetLayout layout = nullptr;
+    vk::raii::DescriptorPool pool = nullptr;
+    vk::raii::DescriptorSet set = nullptr;
+
+    SlotAllocator textures{.name = "texture"};
+    SlotAllocator samplers{.name = "sampler"};
+    SlotAllocator buffers{.name = "buffer"};
+};
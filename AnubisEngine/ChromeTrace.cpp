@@ -0,0 +1,88 @@
+#include "ChromeTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "Logger.h"
+
+void ChromeTrace::begin(size_t eventCap)
+{
+    std::lock_guard lock(mutex);
+    origin = Clock::now();
+    maxEvents = eventCap;
+    events.clear();
+    events.reserve(std::min<size_t>(eventCap, 65536));
+    droppedEvents = 0;
+    active = true;
+}
+
+void ChromeTrace::setTrackName(uint32_t track, const std::string& name)
+{
+    std::lock_guard lock(mutex);
+    // one thread_name record per track, a renamed thread keeps its latest name
+    const auto named = std::ranges::find(trackNames, track, &std::pair<uint32_t, std::string>::first);
+    if (named != trackNames.end())
+    {
+        named->second = name;
+        return;
+    }
+    trackNames.emplace_back(track, name);
+}
+
+double ChromeTrace::toMicroseconds(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - origin).count();
+}
+
+void ChromeTrace::addZone(uint32_t track, const char* name, const char* category, Clock::time_point start, Clock::time_point end)
+{
+    addZone(track, name, category, toMicroseconds(start), std::chrono::duration<double, std::micro>(end - start).count());
+}
+
+void ChromeTrace::addZone(uint32_t track, const char* name, const char* category, double startUs, double durationUs)
+{
+    if (!active)
+    {
+        return;
+    }
+    std::lock_guard lock(mutex);
+    if (events.size() >= maxEvents)
+    {
+        droppedEvents++;
+        return;
+    }
+    events.push_back({name, category, track, startUs, durationUs});
+}
+
+void ChromeTrace::write(const std::string& path) const
+{
+    std::lock_guard lock(mutex);
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        ANUBIS_LOG_ERROR("failed to write trace: {}", path);
+        throw std::runtime_error("failed to write trace: " + path);
+    }
+
+    // complete ('X') events, one process, a thread per track
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto& [track, name] : trackNames)
+    {
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+            << ", \"args\": {\"name\": \"" << name << "\"}}";
+        first = false;
+    }
+    out.precision(3);
+    out << std::fixed;
+    for (const Event& event : events)
+    {
+        out << (first ? "" : ",\n") << "{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+            << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.track << ", \"ts\": " << event.startUs << ", \"dur\": " << event.durationUs << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+
+    ANUBIS_LOG_INFO("Wrote trace: {} ({} events, {} dropped)", path, events.size(), droppedEvents);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// collects timed zones and writes them in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// every zone sits on a track (a 'thread' in the viewer): CPU threads and the GPU queue each get their own.
+// timestamps are microseconds since begin(). thread safe, events past the cap are dropped and counted.
+class ChromeTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t DefaultMaxEvents = 1000000;
+    // track ids, cpu threads count up from MainThreadTrack
+    static constexpr uint32_t GpuTrack = 0;
+    static constexpr uint32_t MainThreadTrack = 1;
+
+    void begin(size_t maxEvents = DefaultMaxEvents);
+    [[nodiscard]] bool isActive() const { return active; }
+
+    // naming a track again replaces its name
+    void setTrackName(uint32_t track, const std::string& name);
+    // name/category must outlive the trace (string literals)
+    void addZone(uint32_t track, const char* name, const char* category, Clock::time_point start, Clock::time_point end);
+    void addZone(uint32_t track, const char* name, const char* category, double startUs, double durationUs);
+    [[nodiscard]] double toMicroseconds(Clock::time_point time) const;
+
+    void write(const std::string& path) const;
+
+private:
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        uint32_t track;
+        double startUs;
+        double durationUs;
+    };
+
+    bool active = false;
+    Clock::time_point origin;
+    size_t maxEvents = DefaultMaxEvents;
+    std::vector<Event> events;
+    std::vector<std::pair<uint32_t, std::string>> trackNames;
+    uint64_t droppedEvents = 0;
+    mutable std::mutex mutex;
+};
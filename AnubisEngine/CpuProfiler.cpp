@@ -0,0 +1,136 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+std::atomic<bool> CpuProfiler::s_enabled = false;
+std::mutex CpuProfiler::s_registryMutex;
+std::vector<std::unique_ptr<CpuProfiler::ThreadRing>> CpuProfiler::s_rings;
+std::vector<CpuZoneStats> CpuProfiler::s_stats;
+ChromeTrace* CpuProfiler::s_trace = nullptr;
+
+void CpuProfiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CpuProfiler::setTrace(ChromeTrace* trace)
+{
+    std::lock_guard lock(s_registryMutex);
+    s_trace = trace;
+}
+
+CpuProfiler::ThreadRing& CpuProfiler::threadRing()
+{
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring)
+    {
+        // once per thread
+        std::lock_guard lock(s_registryMutex);
+        auto& registered = s_rings.emplace_back(std::make_unique<ThreadRing>());
+        registered->track = ChromeTrace::MainThreadTrack + static_cast<uint32_t>(s_rings.size() - 1);
+        registered->name = "Thread " + std::to_string(registered->track);
+        ring = registered.get();
+    }
+    return *ring;
+}
+
+void CpuProfiler::setThreadName(const std::string& name)
+{
+    ThreadRing& ring = threadRing();
+    std::lock_guard lock(s_registryMutex);
+    ring.name = name;
+    // collect hands the new name on, the trace replaces the track's old one
+    ring.trackNamed = false;
+}
+
+void CpuProfiler::record(const char* name, uint64_t startNs, uint64_t endNs)
+{
+    ThreadRing& ring = threadRing();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RingCapacity)
+    {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.events[head & (RingCapacity - 1)] = {name, startNs, endNs};
+    // publishes the event to collect
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::collect()
+{
+    std::lock_guard lock(s_registryMutex);
+    for (auto& ring : s_rings)
+    {
+        if (s_trace && s_trace->isActive() && !ring->trackNamed)
+        {
+            s_trace->setTrackName(ring->track, ring->name);
+            ring->trackNamed = true;
+        }
+
+        const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; i++)
+        {
+            const Event& event = ring->events[i & (RingCapacity - 1)];
+            const double zoneMs = static_cast<double>(event.endNs - event.startNs) / 1000000.0;
+            CpuZoneStats& stats = findStats(event.name);
+            stats.averageMs = stats.samples == 0 ? zoneMs : stats.averageMs + (zoneMs - stats.averageMs) * AverageWeight;
+            stats.lastMs = zoneMs;
+            stats.maxMs = std::max(stats.maxMs, zoneMs);
+            stats.samples++;
+
+            if (s_trace)
+            {
+                const auto start = ChromeTrace::Clock::time_point(std::chrono::nanoseconds(event.startNs));
+                const auto end = ChromeTrace::Clock::time_point(std::chrono::nanoseconds(event.endNs));
+                s_trace->addZone(ring->track, event.name, "cpu", start, end);
+            }
+        }
+        // hands the slots back to the thread
+        ring->tail.store(head, std::memory_order_release);
+    }
+}
+
+CpuZoneStats& CpuProfiler::findStats(const char* name)
+{
+    for (CpuZoneStats& stats : s_stats)
+    {
+        if (stats.name == name)
+        {
+            return stats;
+        }
+    }
+    return s_stats.emplace_back(CpuZoneStats{.name = name});
+}
+
+std::vector<CpuZoneStats> CpuProfiler::getZoneStats()
+{
+    std::lock_guard lock(s_registryMutex);
+    return s_stats;
+}
+
+void CpuProfiler::logStatistics()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    std::lock_guard lock(s_registryMutex);
+    Logger::printToConsole("***** CPU Profiler Statistics *****");
+    for (const CpuZoneStats& stats : s_stats)
+    {
+        ANUBIS_LOG_INFO("{}: avg {:.3f} ms, last {:.3f} ms, max {:.3f} ms ({} samples)", stats.name, stats.averageMs, stats.lastMs, stats.maxMs, stats.samples);
+    }
+    for (const auto& ring : s_rings)
+    {
+        const uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            ANUBIS_LOG_WARN("{}: {} zones dropped (ring full)", ring->name, dropped);
+        }
+    }
+    Logger::printToConsole("*************************");
+}
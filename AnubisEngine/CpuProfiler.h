@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ChromeTrace.h"
+
+// scoped CPU zones. ANUBIS_PROFILING is defined in Debug builds only (add it to the preprocessor definitions to
+// profile an optimized build), without it every macro below compiles to nothing
+//  ANUBIS_PROFILE_ZONE("name")    times the enclosing scope
+//  ANUBIS_PROFILE_FUNCTION()      same, named after the function
+//  ANUBIS_PROFILE_THREAD("name")  names the calling thread's track in the trace
+#ifdef ANUBIS_PROFILING
+#define ANUBIS_PROFILE_CONCAT_INNER(a, b) a##b
+#define ANUBIS_PROFILE_CONCAT(a, b) ANUBIS_PROFILE_CONCAT_INNER(a, b)
+#define ANUBIS_PROFILE_ZONE(name) CpuZone ANUBIS_PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#define ANUBIS_PROFILE_FUNCTION() ANUBIS_PROFILE_ZONE(__func__)
+#define ANUBIS_PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+#else
+#define ANUBIS_PROFILE_ZONE(name)
+#define ANUBIS_PROFILE_FUNCTION()
+#define ANUBIS_PROFILE_THREAD(name)
+#endif
+
+// rolling numbers for one named zone, every occurrence is a sample
+struct CpuZoneStats
+{
+    std::string name;
+    double averageMs = 0.0;
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    uint64_t samples = 0;
+};
+
+// every thread that enters a zone gets its own ring (single producer: the thread, single consumer: collect),
+// so recording a zone is two clock reads and a store - no locks, no allocations.
+// collect() drains every ring on the main thread once a frame: rolling stats and, with a trace set, trace events.
+// a full ring drops zones (counted) rather than block the thread.
+class CpuProfiler
+{
+public:
+    // power of two
+    static constexpr uint32_t RingCapacity = 16384;
+    static constexpr double AverageWeight = 0.05;
+
+    // recording is off until enabled, zones then cost one relaxed load
+    static void setEnabled(bool enabled);
+    [[nodiscard]] static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setThreadName(const std::string& name);
+    static void setTrace(ChromeTrace* trace);
+
+    [[nodiscard]] static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(ChromeTrace::Clock::now().time_since_epoch()).count());
+    }
+    // name must be a string literal (or __func__), kept by pointer
+    static void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+    static void collect();
+    [[nodiscard]] static std::vector<CpuZoneStats> getZoneStats();
+    static void logStatistics();
+
+private:
+    struct Event
+    {
+        const char* name;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    struct ThreadRing
+    {
+        std::array<Event, RingCapacity> events;
+        std::atomic<uint64_t> head = 0; // next write, owning thread only
+        std::atomic<uint64_t> tail = 0; // next read, collect only
+        std::atomic<uint64_t> dropped = 0;
+        std::string name;
+        uint32_t track = 0;
+        bool trackNamed = false;
+    };
+
+    static ThreadRing& threadRing();
+    static CpuZoneStats& findStats(const char* name);
+
+    static std::atomic<bool> s_enabled;
+    // rings are registered once per thread and live until exit, threads that end leave theirs to be drained
+    static std::mutex s_registryMutex;
+    static std::vector<std::unique_ptr<ThreadRing>> s_rings;
+    static std::vector<CpuZoneStats> s_stats;
+    static ChromeTrace* s_trace;
+};
+
+// times its scope, see ANUBIS_PROFILE_ZONE
+class CpuZone
+{
+public:
+    explicit CpuZone(const char* name) : name(name), startNs(CpuProfiler::isEnabled() ? CpuProfiler::now() : 0) {}
+    ~CpuZone()
+    {
+        if (startNs != 0)
+        {
+            CpuProfiler::record(name, startNs, CpuProfiler::now());
+        }
+    }
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
@@ -0,0 +1,264 @@
+#include "DescriptorTemplate.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+#include "Logger.h"
+
+namespace
+{
+    // every benchmark draw points at its own slices of the buffer, round robin over this many
+    constexpr uint32_t BenchmarkSlices = 64;
+    constexpr vk::DeviceSize BenchmarkRange = 256;
+
+    // the benchmark's per draw set: the draw's uniforms + its instance array
+    struct BenchmarkDrawData
+    {
+        vk::DescriptorBufferInfo uniforms;
+        vk::DescriptorBufferInfo instances;
+    };
+}
+
+vk::DescriptorUpdateTemplateEntry DescriptorTemplate::entry(uint32_t binding, vk::DescriptorType type, size_t offset, uint32_t count, size_t stride)
+{
+    return vk::DescriptorUpdateTemplateEntry{
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = count,
+        .descriptorType = type,
+        .offset = offset,
+        .stride = stride
+    };
+}
+
+void DescriptorTemplate::init(const vk::raii::Device& logicalDevice, vk::DescriptorSetLayout layout,
+    const std::vector<vk::DescriptorUpdateTemplateEntry>& entries)
+{
+    device = &logicalDevice;
+    updateTemplate = vk::raii::DescriptorUpdateTemplate(logicalDevice, vk::DescriptorUpdateTemplateCreateInfo{
+        .descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size()),
+        .pDescriptorUpdateEntries = entries.data(),
+        .templateType = vk::DescriptorUpdateTemplateType::eDescriptorSet,
+        .descriptorSetLayout = layout
+    });
+}
+
+void DescriptorTemplate::initPush(const vk::raii::Device& logicalDevice, vk::DescriptorSetLayout layout,
+    const std::vector<vk::DescriptorUpdateTemplateEntry>& entries, vk::PipelineLayout pushPipelineLayout, uint32_t pushSet,
+    vk::PipelineBindPoint bindPoint)
+{
+    device = &logicalDevice;
+    pipelineLayout = pushPipelineLayout;
+    set = pushSet;
+    // the set layout is ignored for push templates, the pipeline layout's set decides
+    updateTemplate = vk::raii::DescriptorUpdateTemplate(logicalDevice, vk::DescriptorUpdateTemplateCreateInfo{
+        .descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size()),
+        .pDescriptorUpdateEntries = entries.data(),
+        .templateType = vk::DescriptorUpdateTemplateType::ePushDescriptorsKHR,
+        .descriptorSetLayout = layout,
+        .pipelineBindPoint = bindPoint,
+        .pipelineLayout = pushPipelineLayout,
+        .set = pushSet
+    });
+}
+
+void DescriptorTemplate::clear()
+{
+    updateTemplate.clear();
+    updateTemplate = nullptr;
+    pipelineLayout = nullptr;
+    set = 0;
+    device = nullptr;
+}
+
+void DescriptorTemplate::updateData(vk::DescriptorSet descriptorSet, const void* data) const
+{
+    device->getDispatcher()->vkUpdateDescriptorSetWithTemplate(static_cast<VkDevice>(**device), static_cast<VkDescriptorSet>(descriptorSet),
+        static_cast<VkDescriptorUpdateTemplate>(*updateTemplate), data);
+}
+
+void DescriptorTemplate::pushData(const vk::raii::CommandBuffer& commandBuffer, const void* data) const
+{
+    commandBuffer.getDispatcher()->vkCmdPushDescriptorSetWithTemplateKHR(static_cast<VkCommandBuffer>(*commandBuffer),
+        static_cast<VkDescriptorUpdateTemplate>(*updateTemplate), static_cast<VkPipelineLayout>(pipelineLayout), set, data);
+}
+
+void DescriptorTemplate::runBenchmark(const vk::raii::Device& logicalDevice, const vk::raii::CommandPool& commandPool, vk::Buffer buffer,
+    vk::DeviceSize alignment, bool pushDescriptors)
+{
+    Logger::printToConsole("***** Descriptor Update Benchmark *****");
+    const std::array bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr)
+    };
+    const vk::raii::DescriptorSetLayout layout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    });
+    const std::vector entries = {
+        entry(0, vk::DescriptorType::eUniformBuffer, offsetof(BenchmarkDrawData, uniforms)),
+        entry(1, vk::DescriptorType::eStorageBuffer, offsetof(BenchmarkDrawData, instances))
+    };
+
+    // draw i reads slice i % BenchmarkSlices, the instances in the second half of the range
+    const vk::DeviceSize stride = (BenchmarkRange + alignment - 1) / alignment * alignment;
+    auto drawData = [&](uint32_t draw)
+    {
+        const vk::DeviceSize offset = (draw % BenchmarkSlices) * stride;
+        return BenchmarkDrawData{
+            .uniforms = {.buffer = buffer, .offset = offset, .range = BenchmarkRange},
+            .instances = {.buffer = buffer, .offset = BenchmarkSlices * stride + offset, .range = BenchmarkRange}
+        };
+    };
+    auto drawWrites = [](vk::DescriptorSet drawSet, const BenchmarkDrawData& data)
+    {
+        return std::array{
+            vk::WriteDescriptorSet{
+                .dstSet = drawSet,
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                .pBufferInfo = &data.uniforms
+            },
+            vk::WriteDescriptorSet{
+                .dstSet = drawSet,
+                .dstBinding = 1,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &data.instances
+            }
+        };
+    };
+
+    // pooled: a set per draw, the pool reset every iteration like a frame's pool (see FrameDescriptorPools.h)
+    const std::array poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, BenchmarkDraws),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, BenchmarkDraws)
+    };
+    vk::raii::DescriptorPool pool(logicalDevice, vk::DescriptorPoolCreateInfo{
+        .maxSets = BenchmarkDraws,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    });
+    const vk::DescriptorSetAllocateInfo allocateInfo
+    {
+        .descriptorPool = pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*layout
+    };
+    std::vector<vk::DescriptorSet> sets(BenchmarkDraws);
+    // one vkAllocateDescriptorSets per draw, straight through the dispatcher: raii sets would free themselves
+    auto allocateSets = [&]
+    {
+        pool.reset();
+        for (vk::DescriptorSet& drawSet : sets)
+        {
+            logicalDevice.getDispatcher()->vkAllocateDescriptorSets(static_cast<VkDevice>(*logicalDevice),
+                reinterpret_cast<const VkDescriptorSetAllocateInfo*>(&allocateInfo), reinterpret_cast<VkDescriptorSet*>(&drawSet));
+        }
+    };
+    DescriptorTemplate setTemplate;
+    setTemplate.init(logicalDevice, *layout, entries);
+
+    // pushed: recorded into a command buffer that is never submitted
+    vk::raii::DescriptorSetLayout pushLayout = nullptr;
+    vk::raii::PipelineLayout pushPipelineLayout = nullptr;
+    vk::raii::CommandBuffer commandBuffer = nullptr;
+    DescriptorTemplate pushTemplate;
+    if (pushDescriptors)
+    {
+        pushLayout = vk::raii::DescriptorSetLayout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+            .flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings = bindings.data()
+        });
+        pushPipelineLayout = vk::raii::PipelineLayout(logicalDevice, vk::PipelineLayoutCreateInfo{
+            .setLayoutCount = 1,
+            .pSetLayouts = &*pushLayout
+        });
+        pushTemplate.initPush(logicalDevice, *pushLayout, entries, *pushPipelineLayout, 0);
+        vk::raii::CommandBuffers commandBuffers(logicalDevice, vk::CommandBufferAllocateInfo{
+            .commandPool = commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        });
+        commandBuffer = std::move(commandBuffers.front());
+    }
+    auto recordPushes = [&](auto&& pushDraw)
+    {
+        commandBuffer.reset();
+        commandBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        for (uint32_t draw = 0; draw < BenchmarkDraws; draw++)
+        {
+            pushDraw(draw);
+        }
+        commandBuffer.end();
+    };
+
+    struct DescriptorRun
+    {
+        const char* name;
+        bool pushed;
+        std::function<void()> updateDraws;
+    };
+    const std::array<DescriptorRun, 5> runs = {{
+        {"writes", false, [&]
+        {
+            allocateSets();
+            for (uint32_t draw = 0; draw < BenchmarkDraws; draw++)
+            {
+                const BenchmarkDrawData data = drawData(draw);
+                logicalDevice.updateDescriptorSets(drawWrites(sets[draw], data), {});
+            }
+        }},
+        // the part of the pooled runs the push runs don't have
+        {"allocate only", false, allocateSets},
+        {"template", false, [&]
+        {
+            allocateSets();
+            for (uint32_t draw = 0; draw < BenchmarkDraws; draw++)
+            {
+                setTemplate.update(sets[draw], drawData(draw));
+            }
+        }},
+        {"push", true, [&]
+        {
+            recordPushes([&](uint32_t draw)
+            {
+                const BenchmarkDrawData data = drawData(draw);
+                commandBuffer.pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pushPipelineLayout, 0, drawWrites(nullptr, data));
+            });
+        }},
+        {"push template", true, [&]
+        {
+            recordPushes([&](uint32_t draw) { pushTemplate.push(commandBuffer, drawData(draw)); });
+        }}
+    }};
+
+    ANUBIS_LOG_INFO("{} draws, 2 buffer descriptors per draw, {} iterations", BenchmarkDraws, BenchmarkIterations);
+    double writesNs = 0.0;
+    for (const DescriptorRun& run : runs)
+    {
+        if (run.pushed && !pushDescriptors)
+        {
+            ANUBIS_LOG_INFO("{:<13}: VK_KHR_push_descriptor not supported", run.name);
+            continue;
+        }
+        // warm the pool and the command buffer
+        run.updateDraws();
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < BenchmarkIterations; i++)
+        {
+            run.updateDraws();
+        }
+        const double drawNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count()
+            / (static_cast<double>(BenchmarkIterations) * BenchmarkDraws);
+        // writes run first, everything else relative to them
+        writesNs = writesNs == 0.0 ? drawNs : writesNs;
+        ANUBIS_LOG_INFO("{:<13}: {:.1f} ns per draw, {:.2f}x writes", run.name, drawNs, writesNs / drawNs);
+    }
+
+    Logger::printToConsole("*************************");
+}
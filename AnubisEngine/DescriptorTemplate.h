@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// descriptor writes without building WriteDescriptorSet arrays. the template is made once from where every descriptor's
+// info sits inside a plain struct, after that a whole set is written from a pointer to that struct
+// (vkUpdateDescriptorSetWithTemplate): the driver walks a layout it already decoded instead of every write's fields.
+// made for a push descriptor layout (VK_KHR_push_descriptor), the same struct goes straight into the command buffer
+// (vkCmdPushDescriptorSetWithTemplateKHR): no set, no pool, nothing to allocate or reset - for bindings that change per draw
+//
+//  struct DrawSetData { vk::DescriptorBufferInfo instances; };
+//  init(device, layout, {entry(0, eStorageBufferDynamic, offsetof(DrawSetData, instances))})       -> update(set, data)
+//  initPush(device, pushLayout, {entry(0, eStorageBuffer, ...)}, pipelineLayout, 2)                -> push(commandBuffer, data)
+class DescriptorTemplate
+{
+public:
+    // --bench-descriptors
+    static constexpr uint32_t BenchmarkDraws = 10000;
+    static constexpr uint32_t BenchmarkIterations = 20;
+
+    // count descriptors of the binding, the first one's info at offset in the data struct, the next ones stride apart
+    [[nodiscard]] static vk::DescriptorUpdateTemplateEntry entry(uint32_t binding, vk::DescriptorType type, size_t offset,
+        uint32_t count = 1, size_t stride = sizeof(vk::DescriptorBufferInfo));
+
+    // writes sets allocated with layout
+    void init(const vk::raii::Device& logicalDevice, vk::DescriptorSetLayout layout, const std::vector<vk::DescriptorUpdateTemplateEntry>& entries);
+    // pushes set number set of pipelineLayout, layout has to be created with ePushDescriptorKHR
+    void initPush(const vk::raii::Device& logicalDevice, vk::DescriptorSetLayout layout, const std::vector<vk::DescriptorUpdateTemplateEntry>& entries,
+        vk::PipelineLayout pipelineLayout, uint32_t set, vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return device != nullptr; }
+
+    // data is the struct the entries were made for
+    template <typename T>
+    void update(vk::DescriptorSet set, const T& data) const { updateData(set, &data); }
+    template <typename T>
+    void push(const vk::raii::CommandBuffer& commandBuffer, const T& data) const { pushData(commandBuffer, &data); }
+
+    // per draw descriptor updates: writes vs templates (both out of a pool) vs push descriptors. ns per draw.
+    // buffer needs uniform and storage usage and 128 * 256 bytes (rounded up to alignment)
+    static void runBenchmark(const vk::raii::Device& logicalDevice, const vk::raii::CommandPool& commandPool, vk::Buffer buffer,
+        vk::DeviceSize alignment, bool pushDescriptors);
+
+private:
+    void updateData(vk::DescriptorSet set, const void* data) const;
+    void pushData(const vk::raii::CommandBuffer& commandBuffer, const void* data) const;
+
+    const vk::raii::Device* device = nullptr;
+    vk::raii::DescriptorUpdateTemplate updateTemplate = nullptr;
+    // push templates only
+    vk::PipelineLayout pipelineLayout;
+    uint32_t set = 0;
+};
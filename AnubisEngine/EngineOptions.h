@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// command line switches
+//  --bench-placement         render with the geometry in each memory placement and report draw throughput
+//  --benchmark               fixed timestep, scripted camera run: per frame CPU/GPU/present times -> percentiles + JSON report
+//  --bench-frames <n>        frames measured per benchmark run
+//  --warmup <n>              frames rendered before measuring
+//  --bench-report <file>     where --benchmark writes its JSON report
+//  --bench-baseline <file>   compare the --benchmark report against a stored one, exit code 1 on regressions
+//  --bench-threshold <pct>   slowdown that counts as a regression (default 5)
+//  --bench-compare <baseline> <current>  only compare two reports, exit code 1 on regressions (no rendering)
+//  --draws-per-frame <n>     how many times the scene is drawn per frame while benchmarking
+//  --objects <n>             number of copies of the model in the scene, laid out in a grid
+//  --no-instancing           one drawIndexed per object instead of one per mesh
+//  --bench-instancing        1 to 100k objects, per object draws vs instanced (vs gpu driven): draw calls and CPU time per frame
+//  --no-cpu-culling          CPU draw paths draw every object instead of the ones in the frustum
+//  --bench-culling           SoA frustum culling kernels (scalar, SSE, AVX2) single and multithreaded: objects/ns (no rendering)
+//  --record-threads <n>      threads recording the draws into secondary command buffers (0 = every core, 1 = inline)
+//  --bench-recording         per object draws recorded on 1, 2, 4 ... every core (and cached): CPU record time per frame
+//  --no-draw-cache           record the draws every frame instead of replaying them while nothing changed
+//  --bench-descriptors       per draw descriptor updates: writes vs update templates vs push descriptors, ns per draw
+//  --no-push-descriptors     allocate the per draw set out of the frame's pool even when VK_KHR_push_descriptor is there
+//  --gpu-driven              compute frustum culling + one drawIndexedIndirectCount per frame, the CPU never touches the objects
+//  --single-queue            run uploads on the graphics queue even when there is a dedicated transfer queue
+//  --defrag                  evacuate sparse memory blocks after start up instead of waiting for memory pressure
+//  --headless                no window/surface/swapchain, render into engine owned images (CI, lavapipe)
+//  --frames <n>              stop after n frames (0 = until the window closes). headless defaults to 300
+//  --readback <file.ppm>     headless: copy every frame back to the host and write the last one out
+//  --profile                 CPU (ANUBIS_PROFILING builds) and GPU zones, rolling averages logged on exit
+//  --trace <file.json>       --profile + every zone written as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+//  --pipeline-cache <file>   where the pipeline cache is loaded from and saved to (default pipeline_cache.bin)
+//  --cold-pipeline-cache     ignore the saved pipeline cache, start up compiling every pipeline from scratch
+//  --pipeline-list <file>    permutations used this session, prewarmed by the next one (default pipeline_list.txt)
+struct EngineOptions
+{
+    bool benchmarkMemoryPlacement = false;
+    bool benchmark = false;
+    bool compareReports = false;
+    std::string benchmarkReportPath = "benchmark_report.json";
+    std::string benchmarkBaselinePath;
+    double benchmarkThreshold = 5.0;
+    uint32_t benchmarkFrames = 1000;
+    uint32_t benchmarkWarmupFrames = 100;
+    uint32_t benchmarkDrawsPerFrame = 64;
+    uint32_t sceneObjectCount = 1;
+    bool instancing = true;
+    bool benchmarkInstancing = false;
+    bool gpuDriven = false;
+    bool cpuCulling = true;
+    uint32_t recordThreads = 0;
+    bool benchmarkRecording = false;
+    bool drawCache = true;
+    bool benchmarkDescriptors = false;
+    bool pushDescriptors = true;
+    bool benchmarkCulling = false;
+    bool singleQueue = false;
+    bool defragment = false;
+    bool headless = false;
+    uint32_t frameLimit = 0;
+    std::string readbackPath;
+    bool profile = false;
+    std::string tracePath;
+    std::string pipelineCachePath = "pipeline_cache.bin";
+    bool coldPipelineCache = false;
+    std::string pipelineListPath = "pipeline_list.txt";
+
+    static EngineOptions parse(int argc, char* argv[])
+    {
+        EngineOptions options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--bench-placement")
+            {
+                options.benchmarkMemoryPlacement = true;
+            }
+            else if (arg == "--benchmark")
+            {
+                options.benchmark = true;
+            }
+            else if (arg == "--warmup" && hasValue)
+            {
+                options.benchmarkWarmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--bench-report" && hasValue)
+            {
+                options.benchmarkReportPath = argv[++i];
+            }
+            else if (arg == "--bench-baseline" && hasValue)
+            {
+                options.benchmarkBaselinePath = argv[++i];
+            }
+            else if (arg == "--bench-threshold" && hasValue)
+            {
+                options.benchmarkThreshold = std::stod(argv[++i]);
+            }
+            else if (arg == "--bench-compare" && i + 2 < argc)
+            {
+                options.compareReports = true;
+                options.benchmarkBaselinePath = argv[++i];
+                options.benchmarkReportPath = argv[++i];
+            }
+            else if (arg == "--bench-frames" && hasValue)
+            {
+                options.benchmarkFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--draws-per-frame" && hasValue)
+            {
+                options.benchmarkDrawsPerFrame = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--single-queue")
+            {
+                options.singleQueue = true;
+            }
+            else if (arg == "--defrag")
+            {
+                options.defragment = true;
+            }
+            else if (arg == "--headless")
+            {
+                options.headless = true;
+            }
+            else if (arg == "--frames" && hasValue)
+            {
+                options.frameLimit = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--readback" && hasValue)
+            {
+                options.readbackPath = argv[++i];
+            }
+            else if (arg == "--profile")
+            {
+                options.profile = true;
+            }
+            else if (arg == "--trace" && hasValue)
+            {
+                options.profile = true;
+                options.tracePath = argv[++i];
+            }
+            else if (arg == "--pipeline-cache" && hasValue)
+            {
+                options.pipelineCachePath = argv[++i];
+            }
+            else if (arg == "--cold-pipeline-cache")
+            {
+                options.coldPipelineCache = true;
+            }
+            else if (arg == "--pipeline-list" && hasValue)
+            {
+                options.pipelineListPath = argv[++i];
+            }
+            else if (arg == "--no-instancing")
+            {
+                options.instancing = false;
+            }
+            else if (arg == "--bench-instancing")
+            {
+                options.benchmarkInstancing = true;
+            }
+            else if (arg == "--no-cpu-culling")
+            {
+                options.cpuCulling = false;
+            }
+            else if (arg == "--bench-culling")
+            {
+                options.benchmarkCulling = true;
+            }
+            else if (arg == "--record-threads" && hasValue)
+            {
+                options.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--bench-recording")
+            {
+                options.benchmarkRecording = true;
+            }
+            else if (arg == "--no-draw-cache")
+            {
+                options.drawCache = false;
+            }
+            else if (arg == "--bench-descriptors")
+            {
+                options.benchmarkDescriptors = true;
+            }
+            else if (arg == "--no-push-descriptors")
+            {
+                options.pushDescriptors = false;
+            }
+            else if (arg == "--gpu-driven")
+            {
+                options.gpuDriven = true;
+            }
+            else if (arg == "--objects" && hasValue)
+            {
+                options.sceneObjectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else
+            {
+                // the logger isn't up yet
+                std::cerr << "unknown argument: " << arg << std::endl;
+            }
+        }
+
+        // nothing closes a headless run
+        if (options.headless && options.frameLimit == 0)
+        {
+            options.frameLimit = 300;
+        }
+        return options;
+    }
+};
@@ -0,0 +1,260 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include "Logger.h"
+
+namespace
+{
+    std::string formatStats(const FrameTimeStats& stats)
+    {
+        return "mean " + std::to_string(stats.mean) + " p50 " + std::to_string(stats.p50) + " p95 " + std::to_string(stats.p95)
+            + " p99 " + std::to_string(stats.p99) + " max " + std::to_string(stats.max);
+    }
+
+    void writeStats(std::ostream& out, const std::string& name, const FrameTimeStats& stats)
+    {
+        out << "  \"" << name << "\": {\"mean\": " << stats.mean << ", \"p50\": " << stats.p50 << ", \"p95\": " << stats.p95
+            << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << "},\n";
+    }
+
+    std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string readFile(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            ANUBIS_LOG_ERROR("failed to open benchmark report: {}", path);
+            throw std::runtime_error("failed to open benchmark report: " + path);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+}
+
+void FrameBenchmark::begin(uint64_t first, uint32_t frameCount)
+{
+    firstFrame = first;
+    samples.assign(frameCount, {});
+    recordedFrames = 0;
+}
+
+bool FrameBenchmark::isMeasuring(uint64_t frameNumber) const
+{
+    return frameNumber >= firstFrame && frameNumber - firstFrame < samples.size();
+}
+
+void FrameBenchmark::recordCpu(uint64_t frameNumber, double cpuMs, double presentIntervalMs)
+{
+    if (!isMeasuring(frameNumber))
+    {
+        return;
+    }
+    FrameSample& sample = samples[frameNumber - firstFrame];
+    sample.cpuMs = cpuMs;
+    sample.presentIntervalMs = presentIntervalMs;
+    sample.hasCpu = true;
+    recordedFrames++;
+}
+
+void FrameBenchmark::recordGpu(uint64_t frameNumber, double gpuMs)
+{
+    if (!isMeasuring(frameNumber))
+    {
+        return;
+    }
+    FrameSample& sample = samples[frameNumber - firstFrame];
+    sample.gpuMs = gpuMs;
+    sample.hasGpu = true;
+}
+
+bool FrameBenchmark::isComplete() const
+{
+    return recordedFrames >= samples.size();
+}
+
+FrameTimeStats FrameBenchmark::computeStats(std::vector<double> values)
+{
+    FrameTimeStats stats;
+    if (values.empty())
+    {
+        return stats;
+    }
+    std::ranges::sort(values);
+    const auto percentile = [&values](double p)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(values.size())));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    };
+    stats.mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    stats.p50 = percentile(50.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+    stats.max = values.back();
+    return stats;
+}
+
+FrameTimeStats FrameBenchmark::getCpuStats() const
+{
+    std::vector<double> values;
+    for (const FrameSample& sample : samples)
+    {
+        if (sample.hasCpu)
+        {
+            values.push_back(sample.cpuMs);
+        }
+    }
+    return computeStats(std::move(values));
+}
+
+FrameTimeStats FrameBenchmark::getGpuStats() const
+{
+    std::vector<double> values;
+    for (const FrameSample& sample : samples)
+    {
+        if (sample.hasGpu)
+        {
+            values.push_back(sample.gpuMs);
+        }
+    }
+    return computeStats(std::move(values));
+}
+
+FrameTimeStats FrameBenchmark::getPresentIntervalStats() const
+{
+    std::vector<double> values;
+    for (const FrameSample& sample : samples)
+    {
+        if (sample.hasCpu)
+        {
+            values.push_back(sample.presentIntervalMs);
+        }
+    }
+    return computeStats(std::move(values));
+}
+
+void FrameBenchmark::logSummary() const
+{
+    Logger::printToConsole("***** Frame Benchmark Results *****");
+    ANUBIS_LOG_INFO("Frames: {}", recordedFrames);
+    ANUBIS_LOG_INFO("CPU ms: {}", formatStats(getCpuStats()));
+    ANUBIS_LOG_INFO("GPU ms: {}", formatStats(getGpuStats()));
+    ANUBIS_LOG_INFO("Present Interval ms: {}", formatStats(getPresentIntervalStats()));
+    Logger::printToConsole("*************************");
+}
+
+void FrameBenchmark::writeReport(const std::string& path, const BenchmarkInfo& info) const
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        ANUBIS_LOG_ERROR("failed to write benchmark report: {}", path);
+        throw std::runtime_error("failed to write benchmark report: " + path);
+    }
+
+    out << "{\n";
+    out << "  \"device\": \"" << escape(info.deviceName) << "\",\n";
+    out << "  \"headless\": " << (info.headless ? "true" : "false") << ",\n";
+    out << "  \"width\": " << info.width << ",\n";
+    out << "  \"height\": " << info.height << ",\n";
+    out << "  \"objects\": " << info.objectCount << ",\n";
+    out << "  \"warmupFrames\": " << info.warmupFrames << ",\n";
+    out << "  \"frames\": " << recordedFrames << ",\n";
+    out << "  \"timestep\": " << info.timestep << ",\n";
+    out << "  \"gpuTimestamps\": " << (info.gpuTimestamps ? "true" : "false") << ",\n";
+    writeStats(out, "cpuMs", getCpuStats());
+    writeStats(out, "gpuMs", getGpuStats());
+    writeStats(out, "presentIntervalMs", getPresentIntervalStats());
+    // every frame, for plotting: [cpu, gpu, present interval]
+    out << "  \"samples\": [";
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        out << (i ? ", " : "") << "[" << samples[i].cpuMs << ", " << samples[i].gpuMs << ", " << samples[i].presentIntervalMs << "]";
+    }
+    out << "]\n";
+    out << "}\n";
+    ANUBIS_LOG_INFO("Wrote benchmark report: {}", path);
+}
+
+std::optional<double> FrameBenchmark::readStat(const std::string& json, const std::string& metric, const std::string& stat)
+{
+    const size_t metricStart = json.find("\"" + metric + "\"");
+    if (metricStart == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    const size_t blockStart = json.find('{', metricStart);
+    const size_t blockEnd = json.find('}', blockStart);
+    const size_t statStart = json.find("\"" + stat + "\":", blockStart);
+    if (blockStart == std::string::npos || statStart == std::string::npos || statStart > blockEnd)
+    {
+        return std::nullopt;
+    }
+    return std::strtod(json.c_str() + statStart + stat.size() + 3, nullptr);
+}
+
+uint32_t FrameBenchmark::compareReports(const std::string& baselinePath, const std::string& currentPath, double thresholdPercent)
+{
+    Logger::printToConsole("***** Frame Benchmark Comparison *****");
+    ANUBIS_LOG_INFO("Baseline: {}", baselinePath);
+    ANUBIS_LOG_INFO("Current: {}", currentPath);
+    ANUBIS_LOG_INFO("Threshold: {:.2f}%", thresholdPercent);
+    const std::string baseline = readFile(baselinePath);
+    const std::string current = readFile(currentPath);
+
+    // max is a single frame, too noisy to gate on
+    uint32_t regressions = 0;
+    for (const char* metric : {"cpuMs", "gpuMs", "presentIntervalMs"})
+    {
+        for (const char* stat : {"p50", "p95", "p99"})
+        {
+            const std::optional<double> before = readStat(baseline, metric, stat);
+            const std::optional<double> after = readStat(current, metric, stat);
+            if (!before || !after || *before <= 0.0)
+            {
+                continue;
+            }
+            const double deltaPercent = (*after - *before) / *before * 100.0;
+            const bool regressed = deltaPercent > thresholdPercent;
+            regressions += regressed ? 1 : 0;
+            if (regressed)
+            {
+                ANUBIS_LOG_WARN("{} {}: {:.3f} -> {:.3f} ({:+.2f}%) REGRESSION", metric, stat, *before, *after, deltaPercent);
+            }
+            else
+            {
+                ANUBIS_LOG_INFO("{} {}: {:.3f} -> {:.3f} ({:+.2f}%)", metric, stat, *before, *after, deltaPercent);
+            }
+        }
+    }
+
+    if (regressions > 0)
+    {
+        ANUBIS_LOG_ERROR("{} regressions", regressions);
+    }
+    else
+    {
+        ANUBIS_LOG_INFO("0 regressions");
+    }
+    Logger::printToConsole("*************************");
+    return regressions;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// one measured frame
+struct FrameSample
+{
+    double cpuMs = 0.0;             // drawFrame minus the fence wait: update, record, submit
+    double gpuMs = 0.0;             // first to last command of the frame's command buffer (timestamp queries)
+    double presentIntervalMs = 0.0; // time since the previous present (previous submit headless)
+    bool hasCpu = false;
+    bool hasGpu = false;
+};
+
+struct FrameTimeStats
+{
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// what the report was measured on, written next to the numbers
+struct BenchmarkInfo
+{
+    std::string deviceName;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t objectCount = 0;
+    uint32_t warmupFrames = 0;
+    double timestep = 0.0;
+    bool headless = false;
+    bool gpuTimestamps = false;
+};
+
+// collects per frame timings for a fixed number of frames after a warm up, reduces them to percentiles
+// and writes/compares JSON reports. samples are keyed by the engine's frame number because GPU times
+// only arrive once the frame's fence has signaled, a couple of frames after the CPU side.
+class FrameBenchmark
+{
+public:
+    // frames before firstFrame are warm up and ignored
+    void begin(uint64_t firstFrame, uint32_t frameCount);
+    void recordCpu(uint64_t frameNumber, double cpuMs, double presentIntervalMs);
+    void recordGpu(uint64_t frameNumber, double gpuMs);
+    // every frame has its CPU side recorded (GPU times of the last frames may still be in flight)
+    [[nodiscard]] bool isComplete() const;
+    [[nodiscard]] bool isMeasuring(uint64_t frameNumber) const;
+
+    [[nodiscard]] FrameTimeStats getCpuStats() const;
+    [[nodiscard]] FrameTimeStats getGpuStats() const;
+    [[nodiscard]] FrameTimeStats getPresentIntervalStats() const;
+    [[nodiscard]] uint32_t getRecordedFrameCount() const { return recordedFrames; }
+
+    void logSummary() const;
+    void writeReport(const std::string& path, const BenchmarkInfo& info) const;
+
+    // nearest rank percentiles over a copy of the values
+    static FrameTimeStats computeStats(std::vector<double> values);
+    // p50/p95/p99 of every metric in current vs baseline. anything slower by more than thresholdPercent is a regression.
+    // returns the number of regressions (throws when a report can't be read)
+    static uint32_t compareReports(const std::string& baselinePath, const std::string& currentPath, double thresholdPercent);
+
+private:
+    // the stat of one metric block in a report written by writeReport
+    static std::optional<double> readStat(const std::string& json, const std::string& metric, const std::string& stat);
+
+    uint64_t firstFrame = 0;
+    std::vector<FrameSample> samples;
+    uint32_t recordedFrames = 0;
+};
@@ -0,0 +1,80 @@
+#include "FrameCommandPools.h"
+
+#include "Logger.h"
+
+void FrameCommandPools::init(const vk::raii::Device& logicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t workerCount)
+{
+    Logger::printToConsole("***** Creating Frame Command Pools *****");
+    device = &logicalDevice;
+    frames.clear();
+    frames.resize(frameCount);
+    for (std::vector<WorkerCommands>& workers : frames)
+    {
+        workers.resize(workerCount);
+        for (WorkerCommands& worker : workers)
+        {
+            // no eResetCommandBuffer: buffers are only ever reset together with their pool
+            worker.pool = vk::raii::CommandPool(logicalDevice, vk::CommandPoolCreateInfo{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = queueFamilyIndex
+            });
+        }
+    }
+    ANUBIS_LOG_INFO("Frames In Flight: {}", frameCount);
+    ANUBIS_LOG_INFO("Workers: {}", workerCount);
+    Logger::printToConsole("*************************");
+}
+
+void FrameCommandPools::clear()
+{
+    // buffers before their pools
+    for (std::vector<WorkerCommands>& workers : frames)
+    {
+        for (WorkerCommands& worker : workers)
+        {
+            worker.buffers.clear();
+        }
+    }
+    frames.clear();
+    device = nullptr;
+}
+
+void FrameCommandPools::beginFrame(uint32_t frameIndex)
+{
+    for (WorkerCommands& worker : frames[frameIndex])
+    {
+        if (worker.used > 0)
+        {
+            worker.pool.reset();
+            worker.used = 0;
+        }
+    }
+}
+
+vk::raii::CommandBuffer& FrameCommandPools::acquire(uint32_t frameIndex, uint32_t worker)
+{
+    WorkerCommands& commands = frames[frameIndex][worker];
+    if (commands.used == commands.buffers.size())
+    {
+        vk::raii::CommandBuffers allocated(*device, vk::CommandBufferAllocateInfo{
+            .commandPool = commands.pool,
+            .level = vk::CommandBufferLevel::eSecondary,
+            .commandBufferCount = 1
+        });
+        commands.buffers.push_back(std::move(allocated.front()));
+    }
+    return commands.buffers[commands.used++];
+}
+
+size_t FrameCommandPools::getAllocatedCount() const
+{
+    size_t count = 0;
+    for (const std::vector<WorkerCommands>& workers : frames)
+    {
+        for (const WorkerCommands& worker : workers)
+        {
+            count += worker.buffers.size();
+        }
+    }
+    return count;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <vector>
+
+// secondary command buffers for recording a frame on several threads.
+// a command pool can only be used by one thread at a time, so every worker has its own - and every frame in flight
+// its own set of those, a frame's pools are only touched again once its fence has signaled.
+// the pools are transient and reset whole when the frame records its draws again (one vkResetCommandPool per pool
+// instead of a reset per buffer), the buffers stay allocated and are handed out again from the start.
+// a frame replaying its cached draws leaves its pools alone
+//
+//  frames[frame][worker] -> pool + the secondaries it has allocated so far
+class FrameCommandPools
+{
+public:
+    void init(const vk::raii::Device& logicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t workerCount);
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return !frames.empty(); }
+
+    // the frame's fence has signaled and its secondaries are recorded again: every pool of the frame is reset
+    void beginFrame(uint32_t frameIndex);
+    // the worker's next secondary for this frame, allocated the first time it's needed. only called from that worker
+    vk::raii::CommandBuffer& acquire(uint32_t frameIndex, uint32_t worker);
+
+    // secondaries allocated over all pools, they are never freed until clear
+    [[nodiscard]] size_t getAllocatedCount() const;
+
+private:
+    // own cache line, workers bump their counters side by side
+    struct alignas(64) WorkerCommands
+    {
+        vk::raii::CommandPool pool = nullptr;
+        std::vector<vk::raii::CommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+
+    const vk::raii::Device* device = nullptr;
+    std::vector<std::vector<WorkerCommands>> frames;
+};
@@ -0,0 +1,50 @@
+#include "FrameDescriptorPools.h"
+
+#include <string>
+
+#include "Logger.h"
+
+void FrameDescriptorPools::init(const vk::raii::Device& logicalDevice, uint32_t frameCount, uint32_t maxSets,
+    const std::vector<vk::DescriptorPoolSize>& poolSizes)
+{
+    Logger::printToConsole("***** Creating Frame Descriptor Pools *****");
+    device = &logicalDevice;
+    pools.clear();
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        // no eFreeDescriptorSet: sets only go with a reset of the whole pool
+        pools.emplace_back(logicalDevice, vk::DescriptorPoolCreateInfo{
+            .maxSets = maxSets,
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data()
+        });
+    }
+    ANUBIS_LOG_INFO("Frames In Flight: {}", frameCount);
+    ANUBIS_LOG_INFO("Sets Per Frame: {}", maxSets);
+    Logger::printToConsole("*************************");
+}
+
+void FrameDescriptorPools::clear()
+{
+    pools.clear();
+    device = nullptr;
+}
+
+void FrameDescriptorPools::reset(uint32_t frameIndex)
+{
+    pools[frameIndex].reset();
+    resetCount++;
+}
+
+vk::DescriptorSet FrameDescriptorPools::allocate(uint32_t frameIndex, vk::DescriptorSetLayout layout)
+{
+    const vk::DescriptorSetAllocateInfo allocateInfo
+    {
+        .descriptorPool = pools[frameIndex],
+        .descriptorSetCount = 1,
+        .pSetLayouts = &layout
+    };
+    // a raii set would free itself, which a pool without FREE_DESCRIPTOR_SET doesn't allow
+    vk::raii::DescriptorSets sets(*device, allocateInfo);
+    return sets.front().release();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <vector>
+
+// descriptor sets that live for one frame in flight: a pool per frame, created without FREE_DESCRIPTOR_SET.
+// nothing is ever freed on its own - reset drops every set of the frame with one vkResetDescriptorPool
+// (no per set bookkeeping in the driver, no fragmentation), the frame's fence having signaled is all it needs.
+// the sets are plain handles, they are only valid until the next reset of their frame
+//
+//  pools[frame] -> this frame's sets
+class FrameDescriptorPools
+{
+public:
+    // poolSizes and maxSets are per frame
+    void init(const vk::raii::Device& logicalDevice, uint32_t frameCount, uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes);
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return !pools.empty(); }
+
+    // the frame's fence has signaled: every set allocated for it is gone
+    void reset(uint32_t frameIndex);
+    [[nodiscard]] vk::DescriptorSet allocate(uint32_t frameIndex, vk::DescriptorSetLayout layout);
+
+    [[nodiscard]] uint64_t getResetCount() const { return resetCount; }
+
+private:
+    const vk::raii::Device* device = nullptr;
+    std::vector<vk::raii::DescriptorPool> pools;
+    uint64_t resetCount = 0;
+};
@@ -0,0 +1,73 @@
+#include "FrameRingAllocator.h"
+
+#include "helpers.h"
+#include "Logger.h"
+
+void FrameRingAllocator::init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, MemoryAllocator& allocator,
+    uint32_t frames, vk::BufferUsageFlags usage, vk::DeviceSize bytesPerFrame)
+{
+    Logger::printToConsole("***** Creating Frame Ring Allocator *****");
+    const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+
+    // dynamic offsets have to respect the device alignment of every kind of descriptor that reads the ring
+    alignment = 1;
+    if (usage & vk::BufferUsageFlagBits::eUniformBuffer)
+    {
+        alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+    }
+    if (usage & vk::BufferUsageFlagBits::eStorageBuffer)
+    {
+        alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+    }
+
+    frameCount = frames;
+    regionSize = (bytesPerFrame + alignment - 1) / alignment * alignment;
+
+    // written by the CPU every frame, read by the GPU every frame
+    helpers::createBuffer(regionSize * frameCount, usage,
+        MemoryPlacements::Dynamic,
+        buffer, bufferMemory,
+        logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eUniform);
+
+    regionStart = 0;
+    head = 0;
+
+    ANUBIS_LOG_INFO("Offset Alignment: {}", alignment);
+    ANUBIS_LOG_INFO("Bytes Per Frame: {}", regionSize);
+    ANUBIS_LOG_INFO("Memory Type: {} {}", bufferMemory.getMemoryTypeIndex(),
+        vk::to_string(allocator.getMemoryTypeFlags(bufferMemory.getMemoryTypeIndex())));
+    Logger::printToConsole("*************************");
+}
+
+void FrameRingAllocator::clear()
+{
+    buffer.clear();
+    buffer = nullptr;
+    bufferMemory.clear();
+    bufferMemory = nullptr;
+}
+
+void FrameRingAllocator::beginFrame(uint32_t frameIndex)
+{
+    regionStart = regionSize * (frameIndex % frameCount);
+    head = regionStart;
+}
+
+FrameSlice FrameRingAllocator::allocate(vk::DeviceSize size)
+{
+    const vk::DeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+    if (head + alignedSize > regionStart + regionSize)
+    {
+        ANUBIS_LOG_ERROR("Frame ring allocator is out of space! requested: {} used: {} / {}", size, head - regionStart, regionSize);
+        throw std::runtime_error("Frame ring allocator is out of space!");
+    }
+
+    FrameSlice slice
+    {
+        .offset = head,
+        .size = size,
+        .mapped = static_cast<char*>(bufferMemory.getMappedData()) + head
+    };
+    head += alignedSize;
+    return slice;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstring>
+
+#include "MemoryAllocator.h"
+
+// a slice of this frame's region. offset is relative to the start of the ring buffer
+// (i.e. it can be handed straight to a dynamic descriptor or bindVertexBuffers)
+struct FrameSlice
+{
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mapped = nullptr;
+};
+
+// one persistently mapped buffer split into a region per frame in flight.
+// every frame the region of that frame is reset (its fence was just waited on) and handed out linearly,
+// so per-frame data (uniforms, per-object constants) costs a pointer bump and a memcpy - no allocation,
+// no descriptor writes. the descriptors point at the whole buffer and pick the slice through dynamic offsets.
+//
+//  [ frame 0 region | frame 1 region | ... ]
+class FrameRingAllocator
+{
+public:
+    static constexpr vk::DeviceSize DefaultBytesPerFrame = 4ull * 1024 * 1024;
+
+    void init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, MemoryAllocator& allocator,
+        uint32_t frameCount, vk::BufferUsageFlags usage, vk::DeviceSize bytesPerFrame = DefaultBytesPerFrame);
+    void clear();
+
+    // start handing out the region of this frame. only call once the frame's fence has signaled
+    void beginFrame(uint32_t frameIndex);
+
+    // size is rounded up so the next slice stays aligned to the device's offset alignment
+    FrameSlice allocate(vk::DeviceSize size);
+
+    template <typename T>
+    FrameSlice push(const T& data)
+    {
+        FrameSlice slice = allocate(sizeof(T));
+        memcpy(slice.mapped, &data, sizeof(T));
+        return slice;
+    }
+
+    [[nodiscard]] const vk::raii::Buffer& getBuffer() const { return buffer; }
+    [[nodiscard]] vk::DeviceSize getAlignment() const { return alignment; }
+    // bytes used in the current frame's region
+    [[nodiscard]] vk::DeviceSize getUsedBytes() const { return head - regionStart; }
+
+private:
+    vk::raii::Buffer buffer = nullptr;
+    MemoryAllocation bufferMemory = nullptr;
+
+    vk::DeviceSize alignment = 1;
+    vk::DeviceSize regionSize = 0;
+    uint32_t frameCount = 0;
+
+    vk::DeviceSize regionStart = 0;
+    vk::DeviceSize head = 0;
+};
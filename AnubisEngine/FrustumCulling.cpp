@@ -0,0 +1,383 @@
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CpuProfiler.h"
+#include "Logger.h"
+#include "Scene.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define ANUBIS_CULL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// msvc emits any intrinsic as is, gcc/clang only inside functions compiled for the instruction set
+#if defined(__GNUC__) || defined(__clang__)
+#define ANUBIS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ANUBIS_TARGET_AVX2
+#endif
+
+namespace
+{
+    // the planes split into components once per cull, every kernel broadcasts from here
+    struct PlaneSet
+    {
+        float x[6], y[6], z[6], w[6];
+        // |normal|, the box's half extent projected onto the normal
+        float absX[6], absY[6], absZ[6];
+    };
+
+    PlaneSet splitPlanes(const std::array<glm::vec4, 6>& planes)
+    {
+        PlaneSet set{};
+        for (int plane = 0; plane < 6; plane++)
+        {
+            set.x[plane] = planes[plane].x;
+            set.y[plane] = planes[plane].y;
+            set.z[plane] = planes[plane].z;
+            set.w[plane] = planes[plane].w;
+            set.absX[plane] = std::abs(planes[plane].x);
+            set.absY[plane] = std::abs(planes[plane].y);
+            set.absZ[plane] = std::abs(planes[plane].z);
+        }
+        return set;
+    }
+
+    // the reference. the SIMD kernels do the same operations in the same order, so they agree bit for bit
+    size_t cullScalar(const CullBounds& bounds, const PlaneSet& planes, size_t begin, size_t end, uint32_t* out)
+    {
+        size_t visibleCount = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            bool visible = true;
+            for (int plane = 0; plane < 6 && visible; plane++)
+            {
+                const float sphereDistance = planes.x[plane] * bounds.sphereX[i] + planes.y[plane] * bounds.sphereY[i]
+                    + planes.z[plane] * bounds.sphereZ[i] + planes.w[plane];
+                // the box corner furthest along the normal
+                const float boxDistance = planes.x[plane] * bounds.boxCenterX[i] + planes.y[plane] * bounds.boxCenterY[i]
+                    + planes.z[plane] * bounds.boxCenterZ[i] + planes.w[plane]
+                    + (planes.absX[plane] * bounds.boxExtentX[i] + planes.absY[plane] * bounds.boxExtentY[i] + planes.absZ[plane] * bounds.boxExtentZ[i]);
+                visible = sphereDistance >= -bounds.sphereRadius[i] && boxDistance >= 0.0f;
+            }
+            out[visibleCount] = static_cast<uint32_t>(i);
+            visibleCount += visible ? 1 : 0;
+        }
+        return visibleCount;
+    }
+
+#ifdef ANUBIS_CULL_X86
+    size_t cullSse(const CullBounds& bounds, const PlaneSet& planes, size_t begin, size_t end, uint32_t* out)
+    {
+        size_t visibleCount = 0;
+        size_t i = begin;
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 sphereX = _mm_loadu_ps(&bounds.sphereX[i]);
+            const __m128 sphereY = _mm_loadu_ps(&bounds.sphereY[i]);
+            const __m128 sphereZ = _mm_loadu_ps(&bounds.sphereZ[i]);
+            const __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(&bounds.sphereRadius[i]));
+            const __m128 boxX = _mm_loadu_ps(&bounds.boxCenterX[i]);
+            const __m128 boxY = _mm_loadu_ps(&bounds.boxCenterY[i]);
+            const __m128 boxZ = _mm_loadu_ps(&bounds.boxCenterZ[i]);
+            const __m128 extentX = _mm_loadu_ps(&bounds.boxExtentX[i]);
+            const __m128 extentY = _mm_loadu_ps(&bounds.boxExtentY[i]);
+            const __m128 extentZ = _mm_loadu_ps(&bounds.boxExtentZ[i]);
+
+            __m128 visible = _mm_cmpeq_ps(zero, zero);
+            for (int plane = 0; plane < 6; plane++)
+            {
+                const __m128 normalX = _mm_set1_ps(planes.x[plane]);
+                const __m128 normalY = _mm_set1_ps(planes.y[plane]);
+                const __m128 normalZ = _mm_set1_ps(planes.z[plane]);
+                const __m128 distance = _mm_set1_ps(planes.w[plane]);
+
+                const __m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, sphereX), _mm_mul_ps(normalY, sphereY)),
+                    _mm_mul_ps(normalZ, sphereZ)), distance);
+                const __m128 projectedExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absX[plane]), extentX),
+                    _mm_mul_ps(_mm_set1_ps(planes.absY[plane]), extentY)), _mm_mul_ps(_mm_set1_ps(planes.absZ[plane]), extentZ));
+                const __m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, boxX), _mm_mul_ps(normalY, boxY)),
+                    _mm_mul_ps(normalZ, boxZ)), distance), projectedExtent);
+
+                visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmpge_ps(sphereDistance, negativeRadius), _mm_cmpge_ps(boxDistance, zero)));
+                // all four out, skip the remaining planes
+                if (_mm_movemask_ps(visible) == 0)
+                {
+                    break;
+                }
+            }
+
+            // branchless compaction: always write, only advance for visible lanes
+            const int mask = _mm_movemask_ps(visible);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                out[visibleCount] = static_cast<uint32_t>(i + lane);
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+        return visibleCount + cullScalar(bounds, planes, i, end, out + visibleCount);
+    }
+
+    ANUBIS_TARGET_AVX2 size_t cullAvx2(const CullBounds& bounds, const PlaneSet& planes, size_t begin, size_t end, uint32_t* out)
+    {
+        size_t visibleCount = 0;
+        size_t i = begin;
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= end; i += 8)
+        {
+            const __m256 sphereX = _mm256_loadu_ps(&bounds.sphereX[i]);
+            const __m256 sphereY = _mm256_loadu_ps(&bounds.sphereY[i]);
+            const __m256 sphereZ = _mm256_loadu_ps(&bounds.sphereZ[i]);
+            const __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(&bounds.sphereRadius[i]));
+            const __m256 boxX = _mm256_loadu_ps(&bounds.boxCenterX[i]);
+            const __m256 boxY = _mm256_loadu_ps(&bounds.boxCenterY[i]);
+            const __m256 boxZ = _mm256_loadu_ps(&bounds.boxCenterZ[i]);
+            const __m256 extentX = _mm256_loadu_ps(&bounds.boxExtentX[i]);
+            const __m256 extentY = _mm256_loadu_ps(&bounds.boxExtentY[i]);
+            const __m256 extentZ = _mm256_loadu_ps(&bounds.boxExtentZ[i]);
+
+            __m256 visible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+            for (int plane = 0; plane < 6; plane++)
+            {
+                const __m256 normalX = _mm256_set1_ps(planes.x[plane]);
+                const __m256 normalY = _mm256_set1_ps(planes.y[plane]);
+                const __m256 normalZ = _mm256_set1_ps(planes.z[plane]);
+                const __m256 distance = _mm256_set1_ps(planes.w[plane]);
+
+                // no fma, it would round differently than the scalar reference
+                const __m256 sphereDistance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, sphereX), _mm256_mul_ps(normalY, sphereY)),
+                    _mm256_mul_ps(normalZ, sphereZ)), distance);
+                const __m256 projectedExtent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absX[plane]), extentX),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.absY[plane]), extentY)), _mm256_mul_ps(_mm256_set1_ps(planes.absZ[plane]), extentZ));
+                const __m256 boxDistance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, boxX), _mm256_mul_ps(normalY, boxY)),
+                    _mm256_mul_ps(normalZ, boxZ)), distance), projectedExtent);
+
+                visible = _mm256_and_ps(visible, _mm256_and_ps(_mm256_cmp_ps(sphereDistance, negativeRadius, _CMP_GE_OQ),
+                    _mm256_cmp_ps(boxDistance, zero, _CMP_GE_OQ)));
+                if (_mm256_movemask_ps(visible) == 0)
+                {
+                    break;
+                }
+            }
+
+            const int mask = _mm256_movemask_ps(visible);
+            for (int lane = 0; lane < 8; lane++)
+            {
+                out[visibleCount] = static_cast<uint32_t>(i + lane);
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+        return visibleCount + cullScalar(bounds, planes, i, end, out + visibleCount);
+    }
+#endif
+}
+
+void CullBounds::clear()
+{
+    for (std::vector<float>* component : {&sphereX, &sphereY, &sphereZ, &sphereRadius, &boxCenterX, &boxCenterY, &boxCenterZ,
+        &boxExtentX, &boxExtentY, &boxExtentZ})
+    {
+        component->clear();
+    }
+}
+
+void CullBounds::reserve(size_t count)
+{
+    for (std::vector<float>* component : {&sphereX, &sphereY, &sphereZ, &sphereRadius, &boxCenterX, &boxCenterY, &boxCenterZ,
+        &boxExtentX, &boxExtentY, &boxExtentZ})
+    {
+        component->reserve(count);
+    }
+}
+
+void CullBounds::add(const glm::mat4& transform, const glm::vec4& localSphere)
+{
+    const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(localSphere), 1.0f));
+    const float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+    // the sphere's local box [c - r, c + r] through the transform: |linear part| * r per axis
+    const glm::mat3 linear(transform);
+    const glm::vec3 extent = glm::vec3(
+        std::abs(linear[0].x) + std::abs(linear[1].x) + std::abs(linear[2].x),
+        std::abs(linear[0].y) + std::abs(linear[1].y) + std::abs(linear[2].y),
+        std::abs(linear[0].z) + std::abs(linear[1].z) + std::abs(linear[2].z)) * localSphere.w;
+    add(glm::vec4(center, localSphere.w * scale), center, extent);
+}
+
+void CullBounds::add(const glm::vec4& sphere, const glm::vec3& boxCenter, const glm::vec3& boxExtent)
+{
+    sphereX.push_back(sphere.x);
+    sphereY.push_back(sphere.y);
+    sphereZ.push_back(sphere.z);
+    sphereRadius.push_back(sphere.w);
+    boxCenterX.push_back(boxCenter.x);
+    boxCenterY.push_back(boxCenter.y);
+    boxCenterZ.push_back(boxCenter.z);
+    boxExtentX.push_back(boxExtent.x);
+    boxExtentY.push_back(boxExtent.y);
+    boxExtentZ.push_back(boxExtent.z);
+}
+
+const char* getCullKernelName(CullKernel kernel)
+{
+    switch (kernel)
+    {
+    case CullKernel::eSse: return "sse";
+    case CullKernel::eAvx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+bool FrustumCuller::isSupported(CullKernel kernel)
+{
+#ifdef ANUBIS_CULL_X86
+    switch (kernel)
+    {
+    case CullKernel::eSse:
+        // part of x64
+        return true;
+    case CullKernel::eAvx2:
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        // the OS has to save the ymm registers too (OSXSAVE + XCR0)
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+    default:
+        return true;
+    }
+#else
+    return kernel == CullKernel::eScalar;
+#endif
+}
+
+CullKernel FrustumCuller::getBestKernel()
+{
+    if (isSupported(CullKernel::eAvx2))
+    {
+        return CullKernel::eAvx2;
+    }
+    return isSupported(CullKernel::eSse) ? CullKernel::eSse : CullKernel::eScalar;
+}
+
+size_t FrustumCuller::cullRange(CullKernel kernel, const CullBounds& bounds, const std::array<glm::vec4, 6>& planes, size_t begin, size_t end, uint32_t* out)
+{
+    const PlaneSet planeSet = splitPlanes(planes);
+#ifdef ANUBIS_CULL_X86
+    switch (kernel)
+    {
+    case CullKernel::eSse: return cullSse(bounds, planeSet, begin, end, out);
+    case CullKernel::eAvx2: return cullAvx2(bounds, planeSet, begin, end, out);
+    default: break;
+    }
+#endif
+    return cullScalar(bounds, planeSet, begin, end, out);
+}
+
+void FrustumCuller::cull(const CullBounds& bounds, const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible, WorkerPool* pool)
+{
+    ANUBIS_PROFILE_FUNCTION();
+    const size_t count = bounds.size();
+    // worst case everything is visible
+    visible.resize(count);
+    if (!pool || count <= ChunkSize)
+    {
+        visible.resize(cullRange(kernel, bounds, planes, 0, count, visible.data()));
+        return;
+    }
+
+    // every chunk fills the start of its own range of the output...
+    chunkVisible.assign((count + ChunkSize - 1) / ChunkSize, 0);
+    pool->parallelFor(count, ChunkSize, [&](size_t begin, size_t end, uint32_t)
+    {
+        chunkVisible[begin / ChunkSize] = cullRange(kernel, bounds, planes, begin, end, visible.data() + begin);
+    });
+
+    // ...and the ranges are packed behind each other, still in order
+    size_t packed = chunkVisible[0];
+    for (size_t chunk = 1; chunk < chunkVisible.size(); chunk++)
+    {
+        const uint32_t* chunkStart = visible.data() + chunk * ChunkSize;
+        std::copy(chunkStart, chunkStart + chunkVisible[chunk], visible.data() + packed);
+        packed += chunkVisible[chunk];
+    }
+    visible.resize(packed);
+}
+
+void FrustumCuller::runBenchmark()
+{
+    Logger::printToConsole("***** Culling Benchmark *****");
+    // random spheres in a cube around a camera like the engine's, roughly a fifth of them visible
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 4.0f);
+    CullBounds bounds;
+    bounds.reserve(BenchmarkObjects);
+    for (uint32_t i = 0; i < BenchmarkObjects; i++)
+    {
+        const glm::vec3 center(position(random), position(random), position(random));
+        const float r = radius(random);
+        bounds.add(glm::vec4(center, r), center, glm::vec3(r * 0.75f, r, r * 0.5f));
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 12.0f, 60.0f), glm::vec3(0.0f, 12.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 proj = glm::perspective(glm::radians(35.0f), 16.0f / 9.0f, 0.01f, 250.0f);
+    const std::array<glm::vec4, 6> planes = extractFrustumPlanes(proj * view);
+
+    WorkerPool pool;
+    FrustumCuller culler;
+    culler.setKernel(CullKernel::eScalar);
+    std::vector<uint32_t> reference;
+    culler.cull(bounds, planes, reference);
+
+    ANUBIS_LOG_INFO("{} objects, {} visible, {} iterations, {} threads", BenchmarkObjects, reference.size(), BenchmarkIterations, pool.getWorkerCount());
+    double scalarNs = 0.0;
+    for (const CullKernel kernel : {CullKernel::eScalar, CullKernel::eSse, CullKernel::eAvx2})
+    {
+        if (!isSupported(kernel))
+        {
+            ANUBIS_LOG_INFO("{:<6}: not supported by this CPU", getCullKernelName(kernel));
+            continue;
+        }
+        culler.setKernel(kernel);
+        for (WorkerPool* threads : {static_cast<WorkerPool*>(nullptr), &pool})
+        {
+            std::vector<uint32_t> visible;
+            // warm the caches and the output
+            culler.cull(bounds, planes, visible, threads);
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < BenchmarkIterations; i++)
+            {
+                culler.cull(bounds, planes, visible, threads);
+            }
+            const double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count()
+                / BenchmarkIterations;
+            if (kernel == CullKernel::eScalar && !threads)
+            {
+                scalarNs = elapsedNs;
+            }
+
+            ANUBIS_LOG_INFO("{:<6} {:>2} thread(s): {:.3f} objects/ns, {:.3f} ms per cull, {:.2f}x scalar{}", getCullKernelName(kernel),
+                threads ? threads->getWorkerCount() : 1u, BenchmarkObjects / elapsedNs, elapsedNs / 1000000.0, scalarNs / elapsedNs,
+                visible == reference ? "" : " - MISMATCH");
+            if (visible != reference)
+            {
+                ANUBIS_LOG_WARN("{} culled differently than the scalar reference", getCullKernelName(kernel));
+            }
+        }
+    }
+    Logger::printToConsole("*************************");
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "WorkerPool.h"
+
+// world space bounds of every object, structure of arrays: a kernel loads 4/8 objects' x (y, z, ...) with one load.
+// each object has a sphere and an AABB (center + half extent), visible means both touch the frustum -
+// the sphere is cheap, the box is tighter for long thin things
+struct CullBounds
+{
+    std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+    std::vector<float> boxCenterX, boxCenterY, boxCenterZ;
+    std::vector<float> boxExtentX, boxExtentY, boxExtentZ;
+
+    void clear();
+    void reserve(size_t count);
+    // a local space sphere placed by transform: the world sphere (radius scaled by the largest axis)
+    // and the world AABB of the sphere's box
+    void add(const glm::mat4& transform, const glm::vec4& localSphere);
+    // already in world space
+    void add(const glm::vec4& sphere, const glm::vec3& boxCenter, const glm::vec3& boxExtent);
+    [[nodiscard]] size_t size() const { return sphereX.size(); }
+};
+
+enum class CullKernel
+{
+    eScalar,
+    eSse,   // 4 objects per iteration
+    eAvx2   // 8 objects per iteration
+};
+
+const char* getCullKernelName(CullKernel kernel);
+
+// CPU frustum culling for the CPU draw path: CullBounds against the six planes of extractFrustumPlanes (Scene.h),
+// writes the indices of the visible objects in order (a compact list, the instance array is built from it).
+// the kernel is picked at runtime from what the CPU supports, the scalar one is the reference the others have to match.
+// with a worker pool the objects are split into chunks, each culled into its own range of the output and then packed
+class FrustumCuller
+{
+public:
+    // objects per parallel chunk, a multiple of every kernel's width
+    static constexpr size_t ChunkSize = 4096;
+    // --bench-culling
+    static constexpr uint32_t BenchmarkObjects = 1u << 20;
+    static constexpr uint32_t BenchmarkIterations = 50;
+
+    FrustumCuller() : kernel(getBestKernel()) {}
+
+    [[nodiscard]] static CullKernel getBestKernel();
+    [[nodiscard]] static bool isSupported(CullKernel kernel);
+    void setKernel(CullKernel cullKernel) { kernel = cullKernel; }
+    [[nodiscard]] CullKernel getKernel() const { return kernel; }
+
+    // visible is overwritten with the indices of the visible objects, ascending
+    void cull(const CullBounds& bounds, const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible, WorkerPool* pool = nullptr);
+
+    // [begin, end) into out (room for end - begin), returns how many were visible
+    static size_t cullRange(CullKernel kernel, const CullBounds& bounds, const std::array<glm::vec4, 6>& planes, size_t begin, size_t end, uint32_t* out);
+
+    // objects per nanosecond of every supported kernel on one thread and on the pool, checked against the scalar kernel. no Vulkan
+    static void runBenchmark();
+
+private:
+    CullKernel kernel;
+    // visible objects per chunk, packed after the chunks ran
+    std::vector<size_t> chunkVisible;
+};
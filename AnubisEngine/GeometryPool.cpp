@@ -0,0 +1,155 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "helpers.h"
+#include "Logger.h"
+#include "MemoryDefragmenter.h"
+
+namespace
+{
+    // transfer src so the defragmenter can copy the pool somewhere else
+    constexpr vk::BufferUsageFlags PoolUsage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+}
+
+void GeometryPool::init(const vk::raii::Device& logicalDevice, MemoryAllocator& memoryAllocator, const MemoryPlacement& placement,
+    vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity)
+{
+    Logger::printToConsole("***** Creating Geometry Pool *****");
+
+    // the index region has to start on a 4 byte boundary for bindIndexBuffer
+    indexRegionOffset = (vertexCapacity + 3) & ~vk::DeviceSize(3);
+    helpers::createBuffer(indexRegionOffset + indexCapacity,
+        PoolUsage,
+        placement,
+        buffer, bufferMemory,
+        logicalDevice, memoryAllocator, AllocationStrategy::eFreeList, MemoryCategory::eGeometry);
+
+    vertexRegion.emplace(vertexCapacity, AllocationStrategy::eFreeList);
+    indexRegion.emplace(indexCapacity, AllocationStrategy::eFreeList);
+    meshes.clear();
+
+    ANUBIS_LOG_INFO("Vertex Capacity: {} bytes", vertexCapacity);
+    ANUBIS_LOG_INFO("Index Capacity: {} bytes", indexCapacity);
+    ANUBIS_LOG_INFO("Memory Type: {} {}", bufferMemory.getMemoryTypeIndex(),
+        vk::to_string(memoryAllocator.getMemoryTypeFlags(bufferMemory.getMemoryTypeIndex())));
+    Logger::printToConsole("*************************");
+}
+
+void GeometryPool::clear()
+{
+    if (defragmenter)
+    {
+        defragmenter->unregister(bufferMemory);
+        defragmenter = nullptr;
+    }
+    meshes.clear();
+    vertexRegion.reset();
+    indexRegion.reset();
+    buffer.clear();
+    buffer = nullptr;
+    bufferMemory.clear();
+    bufferMemory = nullptr;
+}
+
+void GeometryPool::registerMovable(MemoryDefragmenter& memoryDefragmenter, std::function<void()> onMoved)
+{
+    // draws bind the buffer at record time, a moved pool needs nothing rebuilt - besides anything recorded once and replayed
+    defragmenter = &memoryDefragmenter;
+    defragmenter->registerBuffer(buffer, bufferMemory, indexRegionOffset + indexRegion->getSize(), PoolUsage, std::move(onMoved));
+}
+
+uint32_t GeometryPool::addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadBatch& batch)
+{
+    const vk::DeviceSize vertexBytes = vertices.size() * sizeof(Vertex);
+    const vk::DeviceSize indexBytes = indices.size() * sizeof(uint32_t);
+
+    // vertex ranges are aligned to whole vertices so vertexOffset can be expressed in vertices
+    vk::DeviceSize vertexOffset = 0;
+    vk::DeviceSize indexOffset = 0;
+    if (!vertexRegion->allocate(vertexBytes, sizeof(Vertex), vertexOffset))
+    {
+        Logger::printToConsole("Geometry pool is out of vertex space!", level::err);
+        throw std::runtime_error("Geometry pool is out of vertex space!");
+    }
+    if (!indexRegion->allocate(indexBytes, sizeof(uint32_t), indexOffset))
+    {
+        vertexRegion->free(vertexOffset);
+        Logger::printToConsole("Geometry pool is out of index space!", level::err);
+        throw std::runtime_error("Geometry pool is out of index space!");
+    }
+
+    if (void* mapped = bufferMemory.getMappedData())
+    {
+        // host visible pool, write straight into it
+        memcpy(static_cast<char*>(mapped) + vertexOffset, vertices.data(), vertexBytes);
+        memcpy(static_cast<char*>(mapped) + indexRegionOffset + indexOffset, indices.data(), indexBytes);
+    }
+    else
+    {
+        // both ranges go through the staging ring, they land when the batch is submitted
+        batch.uploadBuffer(vertices.data(), vertexBytes, *buffer, vertexOffset);
+        batch.uploadBuffer(indices.data(), indexBytes, *buffer, indexRegionOffset + indexOffset);
+    }
+
+    // bounds center is the middle of the box, radius reaches the farthest vertex
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    const glm::vec3 center = vertices.empty() ? glm::vec3(0.0f) : (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+
+    meshes.emplace_back(MeshRange
+    {
+        .vertexOffset = static_cast<int32_t>(vertexOffset / sizeof(Vertex)),
+        .firstIndex = static_cast<uint32_t>(indexOffset / sizeof(uint32_t)),
+        .indexCount = static_cast<uint32_t>(indices.size()),
+        .vertexCount = static_cast<uint32_t>(vertices.size()),
+        .boundingSphere = glm::vec4(center, radius)
+    });
+
+    ANUBIS_LOG_INFO("Added mesh {} to geometry pool: {} vertices, {} indices", meshes.size() - 1, vertices.size(), indices.size());
+    return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void GeometryPool::removeMesh(uint32_t meshId)
+{
+    if (meshId >= meshes.size() || !meshes[meshId])
+    {
+        ANUBIS_LOG_WARN("GeometryPool::removeMesh called with invalid mesh id: {}", meshId);
+        return;
+    }
+
+    // caller makes sure no frame in flight still draws it
+    vertexRegion->free(static_cast<vk::DeviceSize>(meshes[meshId]->vertexOffset) * sizeof(Vertex));
+    indexRegion->free(static_cast<vk::DeviceSize>(meshes[meshId]->firstIndex) * sizeof(uint32_t));
+    meshes[meshId].reset();
+}
+
+const MeshRange& GeometryPool::getMesh(uint32_t meshId) const
+{
+    if (!hasMesh(meshId))
+    {
+        ANUBIS_LOG_ERROR("GeometryPool::getMesh called with invalid mesh id: {}", meshId);
+        throw std::runtime_error("Geometry pool mesh id is invalid!");
+    }
+    return *meshes[meshId];
+}
+
+void GeometryPool::bind(const vk::raii::CommandBuffer& commandBuffer) const
+{
+    // every mesh shares the same binding, draws select their range with vertexOffset/firstIndex
+    commandBuffer.bindVertexBuffers(0, *buffer, {0});
+    commandBuffer.bindIndexBuffer(*buffer, indexRegionOffset, vk::IndexType::eUint32);
+}
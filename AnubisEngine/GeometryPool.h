@@ -0,0 +1,71 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "GeneratedShapes.h"
+#include "MemoryAllocator.h"
+#include "UploadBatch.h"
+
+class MemoryDefragmenter;
+
+// where a mesh lives inside the pool. matches the drawIndexed/VkDrawIndexedIndirectCommand arguments
+struct MeshRange
+{
+    int32_t vertexOffset = 0;   // in vertices
+    uint32_t firstIndex = 0;    // in indices
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    glm::vec4 boundingSphere{0.0f}; // mesh space: xyz center, w radius (culling)
+};
+
+// one buffer holding every mesh's vertices and indices
+//  [ vertex region | index region ]
+// bound once per frame, each draw just picks its range through the mesh table.
+// (driver developers recommend storing multiple buffers in a single buffer - cache friendly, no per object binds)
+class GeometryPool
+{
+public:
+    static constexpr vk::DeviceSize DefaultVertexCapacity = 32ull * 1024 * 1024;
+    static constexpr vk::DeviceSize DefaultIndexCapacity = 16ull * 1024 * 1024;
+
+    void init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator, const MemoryPlacement& placement,
+        vk::DeviceSize vertexCapacity = DefaultVertexCapacity, vk::DeviceSize indexCapacity = DefaultIndexCapacity);
+    void clear();
+
+    // copies the mesh into the pool and returns its id in the mesh table.
+    // a device local pool is filled through the upload batch, submit it before drawing the mesh
+    uint32_t addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadBatch& batch);
+    // frees the mesh's ranges, the id stays invalid afterwards
+    void removeMesh(uint32_t meshId);
+
+    // lets the defragmenter move the pool's buffer out of a sparse block. clear() unregisters it again
+    //  meshes must not be added while a move is in flight. onMoved: command buffers kept around still bind the old buffer
+    void registerMovable(MemoryDefragmenter& memoryDefragmenter, std::function<void()> onMoved = {});
+
+    // vertex buffer binding 0 + the uint32 index buffer
+    void bind(const vk::raii::CommandBuffer& commandBuffer) const;
+
+    // throws on an id that was never added or has been removed (see hasMesh)
+    [[nodiscard]] const MeshRange& getMesh(uint32_t meshId) const;
+    [[nodiscard]] bool hasMesh(uint32_t meshId) const { return meshId < meshes.size() && meshes[meshId].has_value(); }
+    [[nodiscard]] uint32_t getMeshCount() const { return static_cast<uint32_t>(meshes.size()); }
+    [[nodiscard]] const vk::raii::Buffer& getBuffer() const { return buffer; }
+    [[nodiscard]] const MemoryAllocation& getMemory() const { return bufferMemory; }
+
+private:
+    vk::raii::Buffer buffer = nullptr;
+    MemoryAllocation bufferMemory = nullptr;
+    vk::DeviceSize indexRegionOffset = 0;
+
+    // sub-allocation of the two regions. offsets are relative to the region start
+    std::optional<BlockMetadata> vertexRegion;
+    std::optional<BlockMetadata> indexRegion;
+
+    std::vector<std::optional<MeshRange>> meshes;
+
+    MemoryDefragmenter* defragmenter = nullptr;
+};
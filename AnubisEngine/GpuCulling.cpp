@@ -0,0 +1,241 @@
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "helpers.h"
+#include "Logger.h"
+
+namespace
+{
+    constexpr vk::BufferUsageFlags SceneUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    // the count is zeroed with fillBuffer at the start of every cull
+    constexpr vk::BufferUsageFlags CountUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+        vk::BufferUsageFlagBits::eTransferDst;
+    constexpr vk::BufferUsageFlags CommandUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+}
+
+void GpuCulling::init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator, PipelineCache& pipelineCache, const vk::raii::Buffer& uniformRing,
+    uint32_t frameCount, uint32_t maxObjects, uint32_t maxMeshes)
+{
+    Logger::printToConsole("***** Creating GPU Culling *****");
+    objectCapacity = std::max(maxObjects, 1u);
+    meshCapacity = std::max(maxMeshes, 1u);
+    objectCount = 0;
+
+    helpers::createBuffer(sizeof(GpuObject) * objectCapacity, SceneUsage, MemoryPlacements::GpuOnly, objects, objectsMemory,
+        logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eGeometry);
+    helpers::createBuffer(sizeof(GpuMesh) * meshCapacity, SceneUsage, MemoryPlacements::GpuOnly, meshes, meshesMemory,
+        logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eGeometry);
+
+    // worst case every object is visible: one instance and one command each
+    frames.clear();
+    frames.resize(frameCount);
+    for (FrameOutputs& frame : frames)
+    {
+        helpers::createBuffer(sizeof(InstanceData) * objectCapacity, vk::BufferUsageFlagBits::eStorageBuffer, MemoryPlacements::GpuOnly,
+            frame.instances, frame.instancesMemory, logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eOther);
+        helpers::createBuffer(sizeof(vk::DrawIndexedIndirectCommand) * objectCapacity, CommandUsage, MemoryPlacements::GpuOnly,
+            frame.commands, frame.commandsMemory, logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eOther);
+        helpers::createBuffer(sizeof(uint32_t), CountUsage, MemoryPlacements::GpuOnly,
+            frame.count, frame.countMemory, logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eOther);
+    }
+
+    createPipeline(logicalDevice, pipelineCache);
+    createDescriptors(logicalDevice, uniformRing);
+
+    ANUBIS_LOG_INFO("Object Capacity: {}", objectCapacity);
+    ANUBIS_LOG_INFO("Mesh Capacity: {}", meshCapacity);
+    ANUBIS_LOG_INFO("Frames In Flight: {}", frameCount);
+    Logger::printToConsole("*************************");
+}
+
+void GpuCulling::createPipeline(const vk::raii::Device& logicalDevice, PipelineCache& pipelineCache)
+{
+    std::array bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+        // CullData, out of the frame ring like the camera
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+        vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+        vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr)
+    };
+    descriptorSetLayout = vk::raii::DescriptorSetLayout(logicalDevice, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    });
+
+    pipelineLayout = vk::raii::PipelineLayout(logicalDevice, vk::PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &*descriptorSetLayout
+    });
+
+    // compile_shader.bat doesn't know compute entry points:
+    //  slangc shaders/cull.slang -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name -entry cullMain -o shaders/cull.spv
+    const std::vector<char> shaderCode = helpers::readFile("shaders/cull.spv");
+    vk::raii::ShaderModule shaderModule(logicalDevice, vk::ShaderModuleCreateInfo{
+        .codeSize = shaderCode.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(shaderCode.data())
+    });
+
+    vk::ComputePipelineCreateInfo pipelineCreateInfo
+    {
+        .stage = {
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            .module = shaderModule,
+            .pName = "cullMain"
+        },
+        .layout = pipelineLayout
+    };
+    pipeline = pipelineCache.createComputePipeline(pipelineCreateInfo);
+}
+
+void GpuCulling::createDescriptors(const vk::raii::Device& logicalDevice, const vk::raii::Buffer& uniformRing)
+{
+    const auto frameCount = static_cast<uint32_t>(frames.size());
+    std::array poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 5 * frameCount),
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, frameCount)
+    };
+    descriptorPool = vk::raii::DescriptorPool(logicalDevice, vk::DescriptorPoolCreateInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = frameCount,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    });
+
+    std::vector<vk::DescriptorSetLayout> layouts(frameCount, *descriptorSetLayout);
+    std::vector<vk::raii::DescriptorSet> sets = logicalDevice.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+        .descriptorPool = descriptorPool,
+        .descriptorSetCount = frameCount,
+        .pSetLayouts = layouts.data()
+    });
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        FrameOutputs& frame = frames[i];
+        frame.descriptorSet = std::move(sets[i]);
+
+        std::array bufferInfos = {
+            vk::DescriptorBufferInfo{.buffer = objects, .offset = 0, .range = vk::WholeSize},
+            vk::DescriptorBufferInfo{.buffer = meshes, .offset = 0, .range = vk::WholeSize},
+            // the slice is picked by the dynamic offset at dispatch time
+            vk::DescriptorBufferInfo{.buffer = uniformRing, .offset = 0, .range = sizeof(CullData)},
+            vk::DescriptorBufferInfo{.buffer = frame.instances, .offset = 0, .range = vk::WholeSize},
+            vk::DescriptorBufferInfo{.buffer = frame.commands, .offset = 0, .range = vk::WholeSize},
+            vk::DescriptorBufferInfo{.buffer = frame.count, .offset = 0, .range = vk::WholeSize}
+        };
+        std::array<vk::WriteDescriptorSet, bufferInfos.size()> descriptorWrites;
+        for (uint32_t binding = 0; binding < bufferInfos.size(); binding++)
+        {
+            descriptorWrites[binding] = vk::WriteDescriptorSet{
+                .dstSet = frame.descriptorSet,
+                .dstBinding = binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = binding == 2 ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &bufferInfos[binding]
+            };
+        }
+        logicalDevice.updateDescriptorSets(descriptorWrites, {});
+    }
+}
+
+void GpuCulling::clear()
+{
+    // sets before their pool
+    frames.clear();
+    descriptorPool = nullptr;
+    pipeline = nullptr;
+    pipelineLayout = nullptr;
+    descriptorSetLayout = nullptr;
+    objects = nullptr;
+    objectsMemory = nullptr;
+    meshes = nullptr;
+    meshesMemory = nullptr;
+    objectCount = 0;
+}
+
+void GpuCulling::uploadScene(const std::vector<RenderObject>& renderObjects, const GeometryPool& geometryPool, UploadBatch& batch)
+{
+    if (renderObjects.size() > objectCapacity || geometryPool.getMeshCount() > meshCapacity)
+    {
+        Logger::printToConsole("Scene doesn't fit the GPU culling buffers!", level::err);
+        throw std::runtime_error("Scene doesn't fit the GPU culling buffers!");
+    }
+
+    std::vector<GpuObject> gpuObjects(renderObjects.size());
+    for (size_t i = 0; i < renderObjects.size(); i++)
+    {
+        gpuObjects[i] = GpuObject{
+            .transform = renderObjects[i].transform,
+            .meshId = renderObjects[i].meshId,
+            .materialIndex = renderObjects[i].materialIndex
+        };
+    }
+
+    // removed meshes stay as zeroed entries, nothing references them
+    std::vector<GpuMesh> gpuMeshes(geometryPool.getMeshCount(), GpuMesh{});
+    for (uint32_t meshId = 0; meshId < geometryPool.getMeshCount(); meshId++)
+    {
+        if (!geometryPool.hasMesh(meshId))
+        {
+            continue;
+        }
+        const MeshRange& mesh = geometryPool.getMesh(meshId);
+        gpuMeshes[meshId] = GpuMesh{
+            .boundingSphere = mesh.boundingSphere,
+            .indexCount = mesh.indexCount,
+            .firstIndex = mesh.firstIndex,
+            .vertexOffset = mesh.vertexOffset
+        };
+    }
+
+    if (!gpuObjects.empty())
+    {
+        batch.uploadBuffer(gpuObjects.data(), sizeof(GpuObject) * gpuObjects.size(), *objects, 0);
+    }
+    if (!gpuMeshes.empty())
+    {
+        batch.uploadBuffer(gpuMeshes.data(), sizeof(GpuMesh) * gpuMeshes.size(), *meshes, 0);
+    }
+    objectCount = static_cast<uint32_t>(gpuObjects.size());
+}
+
+void GpuCulling::recordCull(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t cullDataOffset) const
+{
+    const FrameOutputs& frame = frames[frameIndex];
+
+    // this frame's outputs were last read before its fence signaled, only the count reset has to land before the shader
+    commandBuffer.fillBuffer(frame.count, 0, sizeof(uint32_t), 0);
+    vk::MemoryBarrier2 resetBarrier
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &resetBarrier});
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, *frame.descriptorSet, {cullDataOffset});
+    commandBuffer.dispatch((objectCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+
+    // commands + count for the indirect draw, instances for the vertex shader
+    vk::MemoryBarrier2 cullBarrier
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader,
+        .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &cullBarrier});
+}
+
+void GpuCulling::recordDraw(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex) const
+{
+    const FrameOutputs& frame = frames[frameIndex];
+    commandBuffer.drawIndexedIndirectCount(frame.commands, 0, frame.count, 0, objectCapacity, sizeof(vk::DrawIndexedIndirectCommand));
+}
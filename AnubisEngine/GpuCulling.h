@@ -0,0 +1,107 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GeometryPool.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ResourceDescriptors.h"
+#include "Scene.h"
+#include "UploadBatch.h"
+
+// the structs below are read by shaders/cull.slang (std430, CullData std140)
+
+// one render object, persistent on the GPU until the scene changes
+struct GpuObject
+{
+    alignas(16) glm::mat4 transform;
+    uint32_t meshId;
+    uint32_t materialIndex;
+    uint32_t padding[2];
+};
+
+// the mesh table, mirrors MeshRange
+struct GpuMesh
+{
+    alignas(16) glm::vec4 boundingSphere;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+
+// per frame, pushed into the frame ring next to the camera
+struct CullData
+{
+    alignas(16) glm::mat4 sceneRotation;
+    alignas(16) glm::vec4 frustumPlanes[6];
+    uint32_t objectCount;
+    uint32_t padding[3];
+};
+
+// gpu driven rendering: the scene lives on the GPU, a compute pass culls it against the frustum and writes
+// the frame's instance array, one VkDrawIndexedIndirectCommand per visible object and the number of them.
+// the graphics pass draws it all with a single drawIndexedIndirectCount - recording costs the same for 1 or 100k objects.
+// needs multiDrawIndirect + drawIndirectFirstInstance + drawIndirectCount (lavapipe has all three, so it runs headless in CI)
+//
+//  objects + meshes --cull--> instances[frame] + commands[frame] + count[frame] --drawIndexedIndirectCount-->
+//
+// every frame in flight has its own outputs, a frame only overwrites them once its fence has signaled
+class GpuCulling
+{
+public:
+    static constexpr uint32_t WorkgroupSize = 64;
+
+    // uniformRing is the frame ring CullData is pushed into, bound with a dynamic offset
+    void init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator, PipelineCache& pipelineCache, const vk::raii::Buffer& uniformRing,
+        uint32_t frameCount, uint32_t maxObjects, uint32_t maxMeshes);
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return !frames.empty(); }
+
+    // replaces the GPU copy of the scene. nothing in flight may still read it (idle device)
+    void uploadScene(const std::vector<RenderObject>& renderObjects, const GeometryPool& geometryPool, UploadBatch& batch);
+
+    // outside of rendering: reset the count, cull, make the outputs visible to the indirect draw and the vertex shader
+    void recordCull(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t cullDataOffset) const;
+    // inside rendering, with the graphics pipeline, geometry and the frame's instance array bound
+    void recordDraw(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex) const;
+
+    // what the vertex shader reads instead of the CPU written instances
+    [[nodiscard]] const vk::raii::Buffer& getInstanceBuffer(uint32_t frameIndex) const { return frames[frameIndex].instances; }
+    [[nodiscard]] vk::DeviceSize getInstanceBufferSize() const { return sizeof(InstanceData) * objectCapacity; }
+    [[nodiscard]] uint32_t getObjectCount() const { return objectCount; }
+
+private:
+    struct FrameOutputs
+    {
+        vk::raii::Buffer instances = nullptr;
+        MemoryAllocation instancesMemory = nullptr;
+        vk::raii::Buffer commands = nullptr;
+        MemoryAllocation commandsMemory = nullptr;
+        vk::raii::Buffer count = nullptr;
+        MemoryAllocation countMemory = nullptr;
+        vk::raii::DescriptorSet descriptorSet = nullptr;
+    };
+
+    void createPipeline(const vk::raii::Device& logicalDevice, PipelineCache& pipelineCache);
+    void createDescriptors(const vk::raii::Device& logicalDevice, const vk::raii::Buffer& uniformRing);
+
+    vk::raii::Buffer objects = nullptr;
+    MemoryAllocation objectsMemory = nullptr;
+    vk::raii::Buffer meshes = nullptr;
+    MemoryAllocation meshesMemory = nullptr;
+    std::vector<FrameOutputs> frames;
+
+    vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
+    vk::raii::DescriptorPool descriptorPool = nullptr;
+    vk::raii::PipelineLayout pipelineLayout = nullptr;
+    vk::raii::Pipeline pipeline = nullptr;
+
+    uint32_t objectCapacity = 0;
+    uint32_t meshCapacity = 0;
+    uint32_t objectCount = 0;
+};
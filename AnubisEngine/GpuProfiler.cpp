@@ -0,0 +1,190 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+void GpuProfiler::init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+{
+    Logger::printToConsole("***** Creating GPU Profiler *****");
+    const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0)
+    {
+        Logger::printToConsole("Queue family has no timestamps, GPU zones are not measured", level::warn);
+        Logger::printToConsole("*************************");
+        return;
+    }
+
+    timestampPeriodNs = physicalDevice.getProperties().limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    slots.clear();
+    slots.resize(framesInFlight);
+    for (Slot& slot : slots)
+    {
+        slot.queryPool = vk::raii::QueryPool(logicalDevice, vk::QueryPoolCreateInfo{
+            .queryType = vk::QueryType::eTimestamp,
+            .queryCount = MaxZonesPerFrame * 2
+        });
+        slot.zones.reserve(MaxZonesPerFrame);
+    }
+
+    ANUBIS_LOG_INFO("Frames In Flight: {}", framesInFlight);
+    ANUBIS_LOG_INFO("Max Zones Per Frame: {}", MaxZonesPerFrame);
+    ANUBIS_LOG_INFO("Timestamp Period: {} ns", timestampPeriodNs);
+    ANUBIS_LOG_INFO("Timestamp Valid Bits: {}", validBits);
+    Logger::printToConsole("*************************");
+}
+
+void GpuProfiler::clear()
+{
+    slots.clear();
+    recording = nullptr;
+    zoneStats.clear();
+}
+
+void GpuProfiler::beginFrame(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex, uint64_t frameNumber)
+{
+    if (slots.empty())
+    {
+        return;
+    }
+    recording = &slots[frameIndex];
+    recording->zones.clear();
+    recording->queryCount = 0;
+    recording->frameNumber = frameNumber;
+    recording->pending = false;
+    commandBuffer.resetQueryPool(*recording->queryPool, 0, MaxZonesPerFrame * 2);
+    // zone 0, closed by endFrame
+    beginZone(commandBuffer, "frame");
+}
+
+void GpuProfiler::endFrame(const vk::raii::CommandBuffer& commandBuffer)
+{
+    if (!recording)
+    {
+        return;
+    }
+    // zones left open end with the frame, an unwritten query would keep the whole slot from ever being available
+    for (uint32_t zone = static_cast<uint32_t>(recording->zones.size()); zone-- > 0;)
+    {
+        if (!recording->zones[zone].closed)
+        {
+            endZone(commandBuffer, zone);
+        }
+    }
+    recording->pending = true;
+    recording = nullptr;
+}
+
+uint32_t GpuProfiler::beginZone(const vk::raii::CommandBuffer& commandBuffer, const char* name)
+{
+    if (!recording || recording->zones.size() >= MaxZonesPerFrame)
+    {
+        return InvalidZone;
+    }
+    Zone zone{
+        .name = name,
+        .beginQuery = recording->queryCount++,
+        .endQuery = recording->queryCount++
+    };
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *recording->queryPool, zone.beginQuery);
+    recording->zones.push_back(zone);
+    return static_cast<uint32_t>(recording->zones.size() - 1);
+}
+
+void GpuProfiler::endZone(const vk::raii::CommandBuffer& commandBuffer, uint32_t zone)
+{
+    if (!recording || zone == InvalidZone)
+    {
+        return;
+    }
+    Zone& ended = recording->zones[zone];
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *recording->queryPool, ended.endQuery);
+    ended.closed = true;
+}
+
+void GpuProfiler::markSubmitted(uint32_t frameIndex)
+{
+    if (slots.empty())
+    {
+        return;
+    }
+    slots[frameIndex].submitTime = ChromeTrace::Clock::now();
+}
+
+std::optional<GpuFrameTime> GpuProfiler::collect(uint32_t frameIndex)
+{
+    if (slots.empty() || !slots[frameIndex].pending || slots[frameIndex].zones.empty())
+    {
+        return std::nullopt;
+    }
+    Slot& slot = slots[frameIndex];
+    slot.pending = false;
+
+    // no wait flag: the fence has signaled, anything not available is skipped rather than stalled on
+    auto [result, timestamps] = slot.queryPool.getResults<uint64_t>(0, slot.queryCount, slot.queryCount * sizeof(uint64_t), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess)
+    {
+        return std::nullopt;
+    }
+
+    const double tickMs = timestampPeriodNs / 1000000.0;
+    const uint64_t frameStart = timestamps[slot.zones.front().beginQuery] & timestampMask;
+    const auto ticksBetween = [this](uint64_t from, uint64_t to) { return ((to & timestampMask) - (from & timestampMask)) & timestampMask; };
+
+    double traceStartUs = 0.0;
+    if (trace && trace->isActive())
+    {
+        traceStartUs = std::max(trace->toMicroseconds(slot.submitTime), lastTraceEndUs);
+    }
+
+    GpuFrameTime frameTime{.frameNumber = slot.frameNumber};
+    for (const Zone& zone : slot.zones)
+    {
+        const double zoneMs = static_cast<double>(ticksBetween(timestamps[zone.beginQuery], timestamps[zone.endQuery])) * tickMs;
+        GpuZoneStats& stats = findStats(zone.name);
+        stats.averageMs = stats.samples == 0 ? zoneMs : stats.averageMs + (zoneMs - stats.averageMs) * AverageWeight;
+        stats.lastMs = zoneMs;
+        stats.maxMs = std::max(stats.maxMs, zoneMs);
+        stats.samples++;
+
+        if (trace && trace->isActive())
+        {
+            const double offsetMs = static_cast<double>(ticksBetween(frameStart, timestamps[zone.beginQuery])) * tickMs;
+            trace->addZone(ChromeTrace::GpuTrack, zone.name, "gpu", traceStartUs + offsetMs * 1000.0, zoneMs * 1000.0);
+        }
+        if (&zone == &slot.zones.front())
+        {
+            frameTime.frameMs = zoneMs;
+        }
+    }
+    lastTraceEndUs = traceStartUs + frameTime.frameMs * 1000.0;
+    return frameTime;
+}
+
+GpuZoneStats& GpuProfiler::findStats(const char* name)
+{
+    for (GpuZoneStats& stats : zoneStats)
+    {
+        if (stats.name == name)
+        {
+            return stats;
+        }
+    }
+    return zoneStats.emplace_back(GpuZoneStats{.name = name});
+}
+
+void GpuProfiler::logStatistics() const
+{
+    if (slots.empty())
+    {
+        return;
+    }
+    Logger::printToConsole("***** GPU Profiler Statistics *****");
+    for (const GpuZoneStats& stats : zoneStats)
+    {
+        ANUBIS_LOG_INFO("{}: avg {:.3f} ms, last {:.3f} ms, max {:.3f} ms ({} samples)", stats.name, stats.averageMs, stats.lastMs, stats.maxMs, stats.samples);
+    }
+    Logger::printToConsole("*************************");
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ChromeTrace.h"
+
+// rolling numbers for one named zone
+struct GpuZoneStats
+{
+    std::string name;
+    double averageMs = 0.0;
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    uint64_t samples = 0;
+};
+
+// the GPU time of one finished frame
+struct GpuFrameTime
+{
+    uint64_t frameNumber = 0;
+    double frameMs = 0.0;
+};
+
+// named GPU zones from timestamp queries.
+// every frame in flight has its own query pool, so a frame's results are read once its fence has signaled
+// (collect) - nothing ever waits on a query. zones can nest, the whole frame is the outermost one.
+// the GPU clock isn't calibrated against the CPU one: for the trace each frame is anchored at its submit
+// (or at the end of the previous GPU frame when that is later, the queue runs frames back to back).
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t MaxZonesPerFrame = 32;
+    // weight of a new sample in the rolling average
+    static constexpr double AverageWeight = 0.05;
+    static constexpr uint32_t InvalidZone = UINT32_MAX;
+
+    // disabled (every call a no-op) when the queue family has no timestamps
+    void init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+    void clear();
+    [[nodiscard]] bool isEnabled() const { return !slots.empty(); }
+
+    // first/last thing in the frame's command buffer. the slot's previous frame must have been collected
+    void beginFrame(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+    void endFrame(const vk::raii::CommandBuffer& commandBuffer);
+    // name must be a string literal (kept by pointer)
+    uint32_t beginZone(const vk::raii::CommandBuffer& commandBuffer, const char* name);
+    void endZone(const vk::raii::CommandBuffer& commandBuffer, uint32_t zone);
+
+    // right after the frame's submit, where its zones start on the trace timeline
+    void markSubmitted(uint32_t frameIndex);
+    // after the slot's fence signaled: reads its timestamps, updates the stats and the trace
+    std::optional<GpuFrameTime> collect(uint32_t frameIndex);
+
+    [[nodiscard]] std::vector<GpuZoneStats> getZoneStats() const { return zoneStats; }
+    void logStatistics() const;
+
+    // collected zones also go to the trace's GPU track
+    void setTrace(ChromeTrace* chromeTrace) { trace = chromeTrace; }
+
+private:
+    struct Zone
+    {
+        const char* name = nullptr;
+        uint32_t beginQuery = 0;
+        uint32_t endQuery = 0;
+        bool closed = false;
+    };
+
+    struct Slot
+    {
+        vk::raii::QueryPool queryPool = nullptr;
+        std::vector<Zone> zones;
+        uint32_t queryCount = 0;
+        uint64_t frameNumber = 0;
+        bool pending = false;
+        ChromeTrace::Clock::time_point submitTime;
+    };
+
+    GpuZoneStats& findStats(const char* name);
+
+    std::vector<Slot> slots;
+    // the slot being recorded
+    Slot* recording = nullptr;
+    double timestampPeriodNs = 0.0;
+    uint64_t timestampMask = 0;
+
+    std::vector<GpuZoneStats> zoneStats;
+    ChromeTrace* trace = nullptr;
+    // where the last collected frame ended on the trace timeline
+    double lastTraceEndUs = 0.0;
+};
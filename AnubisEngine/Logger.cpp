@@ -1,4 +1,5 @@
 ﻿#include "Logger.h"
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
@@ -6,8 +7,12 @@ std::shared_ptr<spdlog::logger> Logger::s_logger;
 
 void Logger::init()
 {
+    // one writer thread behind a bounded queue
+    spdlog::init_thread_pool(QueueSize, 1);
+
     // create console sink (how it should be displayed in the console)
-    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    // the sinks are only touched by the writer thread, no need for the _mt variants
+    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
     //console_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] %^%v%$\n");
     
     
@@ -16,12 +21,13 @@ void Logger::init()
     std::filesystem::path logsPath = std::filesystem::current_path() / "logs";
     std::filesystem::create_directories(logsPath);
 
-    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>((logsPath / "log.txt").string(), true);
+    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_st>((logsPath / "log.txt").string(), true);
     //file_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] %v\n");
 
     // create logger with multiple sinks
-    s_logger = std::make_shared<spdlog::logger>("logger", 
-        sinks_init_list{console_sink, file_sink});
+    // never block the caller: a full queue overwrites its oldest message
+    s_logger = std::make_shared<spdlog::async_logger>("logger",
+        sinks_init_list{console_sink, file_sink}, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
 
     // set global pattern
     //set_pattern("%^[%Y-%m-%d %H:%M:%S.%e] %v%$", pattern_time_type::local);
@@ -31,12 +37,30 @@ void Logger::init()
     // set global log level
     s_logger->set_level(spdlog::level::trace);
 
-    // flush on error
-    s_logger->flush_on(spdlog::level::info);
+    // flush on warnings/errors, the rest is flushed periodically by spdlog's flusher thread
+    s_logger->flush_on(spdlog::level::warn);
+    spdlog::register_logger(s_logger);
+    spdlog::flush_every(std::chrono::seconds(1));
+}
 
+void Logger::shutdown()
+{
+    if (!s_logger)
+    {
+        return;
+    }
+    const size_t dropped = spdlog::thread_pool()->overrun_counter();
+    if (dropped > 0)
+    {
+        s_logger->warn("{} log messages dropped (queue full)", dropped);
+    }
+    s_logger->flush();
+    s_logger.reset();
+    // joins the writer and the flusher
+    spdlog::shutdown();
 }
 
-void Logger::printToConsole(std::string message, level::level_enum level)
+void Logger::printToConsole(std::string_view message, level::level_enum level)
 {
     switch (level)
     {
@@ -62,4 +86,4 @@ void Logger::printToConsole(std::string message, level::level_enum level)
             s_logger->info(message);
             break;
     }
-}
\ No newline at end of file
+}
@@ -1,15 +1,43 @@
 ﻿#pragma once
+// lowest level that is compiled in, the ANUBIS_LOG_* macros below it expand to nothing.
+//  has to be set before spdlog is included
+#ifndef SPDLOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#else
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+#endif
 #include <spdlog/spdlog.h>
 #include <memory>
 #include <filesystem>
+#include <string_view>
 
 using namespace spdlog;
 
+// format string logging, arguments are only formatted when the level is enabled:
+//  ANUBIS_LOG_INFO("Min Image Count: {}", minImageCount);
+// the message is queued and the background writer does the pattern, console and file output
+#define ANUBIS_LOG_TRACE(...) SPDLOG_LOGGER_TRACE(Logger::get(), __VA_ARGS__)
+#define ANUBIS_LOG_DEBUG(...) SPDLOG_LOGGER_DEBUG(Logger::get(), __VA_ARGS__)
+#define ANUBIS_LOG_INFO(...) SPDLOG_LOGGER_INFO(Logger::get(), __VA_ARGS__)
+#define ANUBIS_LOG_WARN(...) SPDLOG_LOGGER_WARN(Logger::get(), __VA_ARGS__)
+#define ANUBIS_LOG_ERROR(...) SPDLOG_LOGGER_ERROR(Logger::get(), __VA_ARGS__)
+#define ANUBIS_LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(Logger::get(), __VA_ARGS__)
+
+// asynchronous: callers enqueue into a bounded queue, one writer thread formats and writes.
+// a full queue drops the oldest messages instead of blocking the caller (counted, reported on shutdown).
+// warnings and errors are flushed right away, everything else at least once a second.
 class Logger {
 public:
+    static constexpr size_t QueueSize = 8192;
+
     static void init();
-    static void printToConsole(std::string message, level::level_enum level = level::info);
+    // drains the queue and stops the writer, nothing is logged after this
+    static void shutdown();
+    static void printToConsole(std::string_view message, level::level_enum level = level::info);
+    static spdlog::logger* get() { return s_logger.get(); }
     
 private:
     static std::shared_ptr<spdlog::logger> s_logger;
-};
\ No newline at end of file
+};
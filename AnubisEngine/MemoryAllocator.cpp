@@ -0,0 +1,675 @@
+#include "MemoryAllocator.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+namespace
+{
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    // for "{:.2f} MiB"
+    double toMiB(vk::DeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+// ***** BlockMetadata *****
+
+BlockMetadata::BlockMetadata(vk::DeviceSize size, AllocationStrategy strategy)
+    : blockSize(size), strategy(strategy)
+{
+    if (strategy == AllocationStrategy::eFreeList)
+    {
+        freeRanges.emplace(0, size);
+    }
+}
+
+bool BlockMetadata::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& outOffset)
+{
+    if (strategy == AllocationStrategy::eLinear)
+    {
+        vk::DeviceSize alignedOffset = alignUp(linearHead, alignment);
+        if (alignedOffset + size > blockSize)
+        {
+            return false;
+        }
+
+        allocatedRanges.emplace(alignedOffset, std::make_pair(linearHead, alignedOffset + size));
+        linearHead = alignedOffset + size;
+        usedBytes += size;
+        allocationCount++;
+        outOffset = alignedOffset;
+        return true;
+    }
+
+    // first fit. padding in front of an aligned offset stays on the free list for smaller requests
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        const vk::DeviceSize rangeStart = it->first;
+        const vk::DeviceSize rangeEnd = it->first + it->second;
+        const vk::DeviceSize alignedOffset = alignUp(rangeStart, alignment);
+        if (alignedOffset + size > rangeEnd)
+        {
+            continue;
+        }
+
+        freeRanges.erase(it);
+        if (alignedOffset > rangeStart)
+        {
+            freeRanges.emplace(rangeStart, alignedOffset - rangeStart);
+        }
+        if (alignedOffset + size < rangeEnd)
+        {
+            freeRanges.emplace(alignedOffset + size, rangeEnd - (alignedOffset + size));
+        }
+
+        allocatedRanges.emplace(alignedOffset, std::make_pair(alignedOffset, alignedOffset + size));
+        usedBytes += size;
+        allocationCount++;
+        outOffset = alignedOffset;
+        return true;
+    }
+
+    return false;
+}
+
+void BlockMetadata::free(vk::DeviceSize offset)
+{
+    auto allocated = allocatedRanges.find(offset);
+    if (allocated == allocatedRanges.end())
+    {
+        ANUBIS_LOG_ERROR("BlockMetadata::free called with unknown offset: {}", offset);
+        return;
+    }
+
+    auto [rangeStart, rangeEnd] = allocated->second;
+    usedBytes -= rangeEnd - offset;
+    allocationCount--;
+    allocatedRanges.erase(allocated);
+
+    if (strategy == AllocationStrategy::eLinear)
+    {
+        // nothing is reclaimed until the whole block drains
+        if (allocationCount == 0)
+        {
+            linearHead = 0;
+        }
+        return;
+    }
+
+    // merge with the free neighbours on either side
+    auto next = freeRanges.lower_bound(rangeStart);
+    if (next != freeRanges.end() && next->first == rangeEnd)
+    {
+        rangeEnd += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == rangeStart)
+        {
+            rangeStart = previous->first;
+            freeRanges.erase(previous);
+        }
+    }
+    freeRanges.emplace(rangeStart, rangeEnd - rangeStart);
+}
+
+// ***** MemoryAllocation *****
+
+MemoryAllocation::~MemoryAllocation()
+{
+    clear();
+}
+
+MemoryAllocation::MemoryAllocation(MemoryAllocation&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MemoryAllocation& MemoryAllocation::operator=(MemoryAllocation&& other) noexcept
+{
+    if (this != &other)
+    {
+        clear();
+        allocator = std::exchange(other.allocator, nullptr);
+        block = std::exchange(other.block, nullptr);
+        dedicatedMemory = std::move(other.dedicatedMemory);
+        memory = std::exchange(other.memory, nullptr);
+        offset = std::exchange(other.offset, 0);
+        size = std::exchange(other.size, 0);
+        memoryTypeIndex = std::exchange(other.memoryTypeIndex, 0);
+        category = std::exchange(other.category, MemoryCategory::eOther);
+        mapped = std::exchange(other.mapped, nullptr);
+    }
+    return *this;
+}
+
+MemoryAllocation& MemoryAllocation::operator=(std::nullptr_t)
+{
+    clear();
+    return *this;
+}
+
+void MemoryAllocation::clear()
+{
+    if (allocator && memory)
+    {
+        allocator->free(*this);
+    }
+    allocator = nullptr;
+    block = nullptr;
+    dedicatedMemory = nullptr;
+    memory = nullptr;
+    offset = 0;
+    size = 0;
+    mapped = nullptr;
+}
+
+// ***** MemoryAllocator *****
+
+MemoryAllocator::~MemoryAllocator()
+{
+    clear();
+}
+
+void MemoryAllocator::init(const vk::raii::PhysicalDevice& physical, const vk::raii::Device& logicalDevice, bool memoryBudget)
+{
+    Logger::printToConsole("***** Initializing Memory Allocator *****");
+    device = &logicalDevice;
+    physicalDevice = &physical;
+    memoryProperties = physical.getMemoryProperties();
+    maxAllocationCount = physical.getProperties().limits.maxMemoryAllocationCount;
+    heapStatistics.assign(memoryProperties.memoryHeapCount, {});
+    categoryStatistics = {};
+    memoryBudgetSupported = memoryBudget;
+    budgets.assign(memoryProperties.memoryHeapCount, {});
+
+    ANUBIS_LOG_INFO("Max Memory Allocation Count: {}", maxAllocationCount);
+    ANUBIS_LOG_INFO("Memory Budget: {}", memoryBudgetSupported ? "VK_EXT_memory_budget" : "estimated (no VK_EXT_memory_budget)");
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        ANUBIS_LOG_INFO("Heap {}: {:.2f} MiB {}", i, toMiB(memoryProperties.memoryHeaps[i].size), vk::to_string(memoryProperties.memoryHeaps[i].flags));
+    }
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        ANUBIS_LOG_INFO("Memory Type {}: heap {} {}", i, memoryProperties.memoryTypes[i].heapIndex,
+            vk::to_string(memoryProperties.memoryTypes[i].propertyFlags));
+    }
+    Logger::printToConsole("*************************");
+}
+
+void MemoryAllocator::clear()
+{
+    std::lock_guard lock(mutex);
+    for (const auto& block : blocks)
+    {
+        if (!block->metadata.isEmpty())
+        {
+            ANUBIS_LOG_WARN("Memory block freed with {} live allocations!", block->metadata.getAllocationCount());
+        }
+    }
+    blocks.clear();
+    heapStatistics.assign(memoryProperties.memoryHeapCount, {});
+    categoryStatistics = {};
+    budgets.assign(memoryProperties.memoryHeapCount, {});
+    pressureCallbacks.clear();
+    deviceAllocationCount = 0;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, const MemoryPlacement& placement) const
+{
+    // special purpose memory is only ever picked on request
+    constexpr vk::MemoryPropertyFlags specialFlags = vk::MemoryPropertyFlagBits::eLazilyAllocated | vk::MemoryPropertyFlagBits::eProtected |
+        vk::MemoryPropertyFlagBits::eDeviceCoherentAMD | vk::MemoryPropertyFlagBits::eDeviceUncachedAMD;
+    // flags that cost something when they come along uninvited
+    constexpr vk::MemoryPropertyFlags costlyFlags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible |
+        vk::MemoryPropertyFlagBits::eHostCached;
+
+    const vk::MemoryPropertyFlags wanted = placement.required | placement.preferred;
+    uint32_t bestIndex = UINT32_MAX;
+    int bestScore = INT32_MIN;
+
+    // iterate through the memory types
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        const vk::MemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        // the type must match the filter and have every required property
+        if (!(typeFilter & (1 << i)) || (flags & placement.required) != placement.required || (flags & specialFlags & ~wanted))
+        {
+            continue;
+        }
+
+        // every preferred flag outweighs any number of uninvited ones, ties go to the lower (driver ordered) index
+        const int score = std::popcount(static_cast<VkMemoryPropertyFlags>(flags & placement.preferred)) * 8
+            - std::popcount(static_cast<VkMemoryPropertyFlags>(flags & costlyFlags & ~wanted));
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestIndex = i;
+        }
+    }
+
+    if (bestIndex == UINT32_MAX)
+    {
+        ANUBIS_LOG_ERROR("failed to find suitable memory type! required: {}", vk::to_string(placement.required));
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+    return bestIndex;
+}
+
+bool MemoryAllocator::hasMemoryType(vk::MemoryPropertyFlags required) const
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((memoryProperties.memoryTypes[i].propertyFlags & required) == required)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+MemoryAllocation MemoryAllocator::allocateForBuffer(const vk::raii::Buffer& buffer, const MemoryPlacement& placement,
+    AllocationStrategy strategy, MemoryCategory category)
+{
+    auto requirements = device->getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::BufferMemoryRequirementsInfo2{.buffer = *buffer});
+    const auto& dedicated = requirements.get<vk::MemoryDedicatedRequirements>();
+
+    return allocate(requirements.get<vk::MemoryRequirements2>().memoryRequirements,
+        dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation,
+        ResourceKind::eBuffer, placement, strategy, category, *buffer, nullptr);
+}
+
+MemoryAllocation MemoryAllocator::allocateForImage(const vk::raii::Image& image, const MemoryPlacement& placement,
+    AllocationStrategy strategy, MemoryCategory category)
+{
+    auto requirements = device->getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::ImageMemoryRequirementsInfo2{.image = *image});
+    const auto& dedicated = requirements.get<vk::MemoryDedicatedRequirements>();
+
+    // every image the engine makes is optimal tiling (render targets, textures)
+    return allocate(requirements.get<vk::MemoryRequirements2>().memoryRequirements,
+        dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation,
+        ResourceKind::eImageOptimal, placement, strategy, category, nullptr, *image);
+}
+
+MemoryAllocation MemoryAllocator::allocateAliased(const std::vector<vk::MemoryRequirements>& requirements, const MemoryPlacement& placement,
+    MemoryCategory category)
+{
+    // big enough for the largest, placeable where all of them can live
+    vk::MemoryRequirements combined{.size = 0, .alignment = 1, .memoryTypeBits = ~0u};
+    for (const auto& requirement : requirements)
+    {
+        combined.size = std::max(combined.size, requirement.size);
+        combined.alignment = std::max(combined.alignment, requirement.alignment);
+        combined.memoryTypeBits &= requirement.memoryTypeBits;
+    }
+    if (requirements.empty() || !combined.memoryTypeBits)
+    {
+        Logger::printToConsole("aliased resources have no memory type in common!", level::err);
+        throw std::runtime_error("aliased resources have no memory type in common!");
+    }
+
+    // its own allocation, everything is bound at offset 0
+    std::lock_guard lock(mutex);
+    return allocateDedicated(combined, findMemoryType(combined.memoryTypeBits, placement), category, nullptr, nullptr);
+}
+
+vk::DeviceSize MemoryAllocator::getCommitment(const MemoryAllocation& allocation) const
+{
+    if (!allocation || !(getMemoryTypeFlags(allocation.memoryTypeIndex) & vk::MemoryPropertyFlagBits::eLazilyAllocated))
+    {
+        return 0;
+    }
+    return allocation.block ? allocation.block->memory.getCommitment() : allocation.dedicatedMemory.getCommitment();
+}
+
+MemoryAllocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, bool prefersDedicated, ResourceKind kind,
+    const MemoryPlacement& placement, AllocationStrategy strategy, MemoryCategory category, vk::Buffer dedicatedBuffer, vk::Image dedicatedImage)
+{
+    std::lock_guard lock(mutex);
+    const uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, placement);
+    const vk::DeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+    // big resources (render targets, large textures) get their own allocation
+    //  packing them would waste most of a block and they rarely get freed anyway
+    if (prefersDedicated || requirements.size > blockSize / 2)
+    {
+        return allocateDedicated(requirements, memoryTypeIndex, category, dedicatedBuffer, dedicatedImage);
+    }
+
+    MemoryBlock* target = nullptr;
+    vk::DeviceSize offset = 0;
+    for (auto& block : blocks)
+    {
+        if (block->memoryTypeIndex == memoryTypeIndex && block->kind == kind && block->metadata.getStrategy() == strategy && !block->evacuating &&
+            block->metadata.allocate(requirements.size, requirements.alignment, offset))
+        {
+            target = block.get();
+            break;
+        }
+    }
+
+    if (!target)
+    {
+        target = &createBlock(memoryTypeIndex, kind, strategy, requirements.size);
+        if (!target->metadata.allocate(requirements.size, requirements.alignment, offset))
+        {
+            Logger::printToConsole("failed to sub-allocate from a fresh memory block!", level::err);
+            throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+        }
+    }
+
+    HeapStatistics& stats = heapStatistics[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    stats.allocationCount++;
+    stats.usedBytes += requirements.size;
+    CategoryStatistics& categoryStats = categoryStatistics[static_cast<size_t>(category)];
+    categoryStats.allocationCount++;
+    categoryStats.usedBytes += requirements.size;
+
+    MemoryAllocation allocation;
+    allocation.allocator = this;
+    allocation.block = target;
+    allocation.memory = *target->memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.category = category;
+    allocation.mapped = target->mapped ? static_cast<char*>(target->mapped) + offset : nullptr;
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateDedicated(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category,
+    vk::Buffer dedicatedBuffer, vk::Image dedicatedImage)
+{
+    if (deviceAllocationCount >= maxAllocationCount)
+    {
+        Logger::printToConsole("maxMemoryAllocationCount reached!", level::err);
+        throw std::runtime_error("maxMemoryAllocationCount reached!");
+    }
+
+    vk::MemoryDedicatedAllocateInfo dedicatedInfo
+    {
+        .image = dedicatedImage,
+        .buffer = dedicatedBuffer
+    };
+    vk::MemoryAllocateInfo allocInfo
+    {
+        .pNext = &dedicatedInfo,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+
+    MemoryAllocation allocation;
+    allocation.dedicatedMemory = vk::raii::DeviceMemory(*device, allocInfo);
+    allocation.allocator = this;
+    allocation.memory = *allocation.dedicatedMemory;
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.category = category;
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        allocation.mapped = allocation.dedicatedMemory.mapMemory(0, requirements.size);
+    }
+    deviceAllocationCount++;
+
+    HeapStatistics& stats = heapStatistics[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    stats.dedicatedCount++;
+    stats.allocationCount++;
+    stats.reservedBytes += requirements.size;
+    stats.usedBytes += requirements.size;
+    CategoryStatistics& categoryStats = categoryStatistics[static_cast<size_t>(category)];
+    categoryStats.allocationCount++;
+    categoryStats.usedBytes += requirements.size;
+    return allocation;
+}
+
+MemoryBlock& MemoryAllocator::createBlock(uint32_t memoryTypeIndex, ResourceKind kind, AllocationStrategy strategy, vk::DeviceSize minimumSize)
+{
+    if (deviceAllocationCount >= maxAllocationCount)
+    {
+        Logger::printToConsole("maxMemoryAllocationCount reached!", level::err);
+        throw std::runtime_error("maxMemoryAllocationCount reached!");
+    }
+
+    const vk::DeviceSize size = std::max(getBlockSize(memoryTypeIndex), minimumSize);
+    auto block = std::make_unique<MemoryBlock>(size, strategy);
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->kind = kind;
+
+    vk::MemoryAllocateInfo allocInfo
+    {
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+    block->memory = vk::raii::DeviceMemory(*device, allocInfo);
+
+    // 'persistent mapping' for anything the CPU can see. mapping once per block instead of per resource
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        block->mapped = block->memory.mapMemory(0, size);
+    }
+    deviceAllocationCount++;
+
+    HeapStatistics& stats = heapStatistics[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    stats.blockCount++;
+    stats.reservedBytes += size;
+
+    ANUBIS_LOG_INFO("Allocated memory block: type {} {:.2f} MiB [{}]", memoryTypeIndex, toMiB(size),
+        strategy == AllocationStrategy::eLinear ? "linear" : "free list");
+
+    blocks.emplace_back(std::move(block));
+    return *blocks.back();
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+    std::lock_guard lock(mutex);
+    HeapStatistics& stats = heapStatistics[memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex];
+    stats.allocationCount--;
+    stats.usedBytes -= allocation.size;
+    CategoryStatistics& categoryStats = categoryStatistics[static_cast<size_t>(allocation.category)];
+    categoryStats.allocationCount--;
+    categoryStats.usedBytes -= allocation.size;
+
+    if (!allocation.block)
+    {
+        // dedicated. the raii memory is released by the caller (MemoryAllocation::clear)
+        stats.dedicatedCount--;
+        stats.reservedBytes -= allocation.size;
+        deviceAllocationCount--;
+        return;
+    }
+
+    MemoryBlock* block = allocation.block;
+    block->metadata.free(allocation.offset);
+    if (!block->metadata.isEmpty())
+    {
+        return;
+    }
+    // evacuation is done, the block can take allocations again (or go away below)
+    block->evacuating = false;
+
+    // keep one empty block per type/kind/strategy around so load/unload cycles don't thrash vkAllocateMemory
+    const bool hasSpare = std::ranges::any_of(blocks, [block](const auto& other)
+    {
+        return other.get() != block && other->metadata.isEmpty() && other->memoryTypeIndex == block->memoryTypeIndex &&
+            other->kind == block->kind && other->metadata.getStrategy() == block->metadata.getStrategy();
+    });
+    if (hasSpare)
+    {
+        stats.blockCount--;
+        stats.reservedBytes -= block->metadata.getSize();
+        deviceAllocationCount--;
+        std::erase_if(blocks, [block](const auto& other) { return other.get() == block; });
+    }
+}
+
+vk::DeviceSize MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+{
+    // small heaps (the 256MB BAR window, integrated GPUs carving out system memory) get smaller blocks
+    const vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return heapSize <= 1024ull * 1024 * 1024 ? std::min(DefaultBlockSize, heapSize / 8) : DefaultBlockSize;
+}
+
+std::vector<HeapStatistics> MemoryAllocator::getHeapStatistics() const
+{
+    std::lock_guard lock(mutex);
+    return heapStatistics;
+}
+
+std::array<CategoryStatistics, static_cast<size_t>(MemoryCategory::eCount)> MemoryAllocator::getCategoryStatistics() const
+{
+    std::lock_guard lock(mutex);
+    return categoryStatistics;
+}
+
+void MemoryAllocator::logStatistics() const
+{
+    std::lock_guard lock(mutex);
+    Logger::printToConsole("***** Memory Allocator Statistics *****");
+    ANUBIS_LOG_INFO("vkAllocateMemory calls live: {} / {}", deviceAllocationCount, maxAllocationCount);
+    for (uint32_t i = 0; i < heapStatistics.size(); i++)
+    {
+        const HeapStatistics& stats = heapStatistics[i];
+        ANUBIS_LOG_INFO("Heap {}: {} allocations, {} blocks, {} dedicated, {:.2f} MiB used / {:.2f} MiB reserved", i, stats.allocationCount, stats.blockCount,
+            stats.dedicatedCount, toMiB(stats.usedBytes), toMiB(stats.reservedBytes));
+        if (budgets[i].budget)
+        {
+            ANUBIS_LOG_INFO("Heap {} budget: {:.2f} MiB / {:.2f} MiB", i, toMiB(budgets[i].usage), toMiB(budgets[i].budget));
+        }
+    }
+    for (size_t i = 0; i < categoryStatistics.size(); i++)
+    {
+        const CategoryStatistics& stats = categoryStatistics[i];
+        if (stats.allocationCount)
+        {
+            ANUBIS_LOG_INFO("{}: {} allocations, {:.2f} MiB", getMemoryCategoryName(static_cast<MemoryCategory>(i)), stats.allocationCount,
+                toMiB(stats.usedBytes));
+        }
+    }
+    Logger::printToConsole("*************************");
+}
+
+void MemoryAllocator::updateBudget()
+{
+    std::vector<MemoryPressureEvent> events;
+    std::vector<MemoryPressureCallback> callbacks;
+    {
+        std::lock_guard lock(mutex);
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+        if (memoryBudgetSupported)
+        {
+            auto properties = physicalDevice->getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+            budgetProperties = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        }
+
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+        {
+            HeapBudget& heap = budgets[i];
+            if (memoryBudgetSupported)
+            {
+                heap.budget = budgetProperties.heapBudget[i];
+                heap.usage = budgetProperties.heapUsage[i];
+            }
+            else
+            {
+                // without the extension the best guess is the heap size minus some headroom for everyone else,
+                //  and only what we allocated ourselves
+                heap.budget = memoryProperties.memoryHeaps[i].size / 10 * 8;
+                heap.usage = heapStatistics[i].reservedBytes;
+            }
+
+            const double ratio = heap.budget ? static_cast<double>(heap.usage) / static_cast<double>(heap.budget) : 0.0;
+            const MemoryPressure pressure = ratio >= CriticalPressure ? MemoryPressure::eCritical
+                : ratio >= ModeratePressure ? MemoryPressure::eModerate : MemoryPressure::eNone;
+            if (pressure != heap.pressure)
+            {
+                events.push_back({.heapIndex = i, .previous = heap.pressure, .current = pressure, .usage = heap.usage, .budget = heap.budget});
+                heap.pressure = pressure;
+            }
+        }
+
+        if (!events.empty())
+        {
+            for (const auto& callback : pressureCallbacks)
+            {
+                callbacks.push_back(callback.second);
+            }
+        }
+    }
+
+    // outside the lock, the callbacks are expected to free (or move) memory
+    for (const MemoryPressureEvent& event : events)
+    {
+        for (const MemoryPressureCallback& callback : callbacks)
+        {
+            callback(event);
+        }
+    }
+}
+
+std::vector<HeapBudget> MemoryAllocator::getBudgets() const
+{
+    std::lock_guard lock(mutex);
+    return budgets;
+}
+
+uint32_t MemoryAllocator::addPressureCallback(MemoryPressureCallback callback)
+{
+    std::lock_guard lock(mutex);
+    pressureCallbacks.emplace_back(nextCallbackId, std::move(callback));
+    return nextCallbackId++;
+}
+
+void MemoryAllocator::removePressureCallback(uint32_t id)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(pressureCallbacks, [id](const auto& callback) { return callback.first == id; });
+}
+
+std::vector<BlockUsage> MemoryAllocator::getBlockUsage() const
+{
+    std::lock_guard lock(mutex);
+    std::vector<BlockUsage> usage;
+    usage.reserve(blocks.size());
+    for (const auto& block : blocks)
+    {
+        usage.push_back(
+        {
+            .block = block.get(),
+            .memoryTypeIndex = block->memoryTypeIndex,
+            .kind = block->kind,
+            .strategy = block->metadata.getStrategy(),
+            .size = block->metadata.getSize(),
+            .usedBytes = block->metadata.getUsedBytes(),
+            .allocationCount = block->metadata.getAllocationCount(),
+            .evacuating = block->evacuating
+        });
+    }
+    return usage;
+}
+
+void MemoryAllocator::setEvacuating(const MemoryBlock* block, bool evacuating)
+{
+    std::lock_guard lock(mutex);
+    for (auto& candidate : blocks)
+    {
+        if (candidate.get() == block)
+        {
+            candidate->evacuating = evacuating && !candidate->metadata.isEmpty();
+        }
+    }
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// engine owned device memory allocator
+// instead of a vkAllocateMemory per resource, large blocks are allocated per memory type
+// and buffers/images are carved out of them at aligned offsets.
+//  see: VulkanMemoryAllocator library for the 'real' version of this idea
+
+// how a block hands out its ranges
+enum class AllocationStrategy
+{
+    // first fit over a sorted free list, neighbours coalesce on free
+    eFreeList,
+    // bump pointer. ranges are only reclaimed once every allocation in the block is gone
+    //  great for short lived resources that die together (staging, per-load scratch)
+    eLinear
+};
+
+// resources that are not 'linear' (optimal tiling images) must not share a bufferImageGranularity page
+// with linear ones. instead of tracking neighbours, they simply live in different blocks.
+enum class ResourceKind
+{
+    eBuffer,
+    eImageOptimal
+};
+
+// what an allocation is for. only used for the per category usage readout and budget decisions
+enum class MemoryCategory
+{
+    eGeometry,
+    eTexture,
+    eRenderTarget,
+    eStaging,
+    eUniform,
+    eOther,
+    eCount
+};
+
+inline const char* getMemoryCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::eGeometry: return "geometry";
+    case MemoryCategory::eTexture: return "textures";
+    case MemoryCategory::eRenderTarget: return "render targets";
+    case MemoryCategory::eStaging: return "staging";
+    case MemoryCategory::eUniform: return "uniforms";
+    default: return "other";
+    }
+}
+
+// memory type selection policy
+// required flags must all be present on a type, preferred flags only raise its score.
+// flags nobody asked for count against a type (e.g. a GPU only buffer shouldn't eat the small BAR heap)
+struct MemoryPlacement
+{
+    vk::MemoryPropertyFlags required;
+    vk::MemoryPropertyFlags preferred;
+};
+
+namespace MemoryPlacements
+{
+    // only the GPU touches it (geometry, textures, render targets)
+    inline constexpr MemoryPlacement GpuOnly{.required = vk::MemoryPropertyFlagBits::eDeviceLocal};
+    // CPU writes it once, GPU reads it once (staging)
+    inline constexpr MemoryPlacement Upload{.required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent};
+    // CPU writes it every frame, GPU reads it every frame (uniforms, per-frame dynamic data)
+    //  lands in DEVICE_LOCAL|HOST_VISIBLE (ReBAR) when the device has it, plain host memory otherwise
+    inline constexpr MemoryPlacement Dynamic{
+        .required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        .preferred = vk::MemoryPropertyFlagBits::eDeviceLocal};
+    // GPU writes it, CPU reads it back (screenshots, headless frames)
+    inline constexpr MemoryPlacement Readback{
+        .required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        .preferred = vk::MemoryPropertyFlagBits::eHostCached};
+    // attachments that only live inside a render pass (MSAA color, depth)
+    //  LAZILY_ALLOCATED when the device has it - on tilers it stays in tile memory and is never committed
+    inline constexpr MemoryPlacement Transient{
+        .required = vk::MemoryPropertyFlagBits::eDeviceLocal,
+        .preferred = vk::MemoryPropertyFlagBits::eLazilyAllocated};
+}
+
+// offset bookkeeping for one block - no vulkan calls in here
+class BlockMetadata
+{
+public:
+    BlockMetadata(vk::DeviceSize size, AllocationStrategy strategy);
+
+    bool allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& outOffset);
+    void free(vk::DeviceSize offset);
+
+    [[nodiscard]] bool isEmpty() const { return allocationCount == 0; }
+    [[nodiscard]] vk::DeviceSize getSize() const { return blockSize; }
+    [[nodiscard]] vk::DeviceSize getUsedBytes() const { return usedBytes; }
+    [[nodiscard]] uint32_t getAllocationCount() const { return allocationCount; }
+    [[nodiscard]] AllocationStrategy getStrategy() const { return strategy; }
+
+private:
+    vk::DeviceSize blockSize;
+    AllocationStrategy strategy;
+    vk::DeviceSize usedBytes = 0;
+    uint32_t allocationCount = 0;
+
+    // free list: offset -> size of every free range
+    std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+    // offset handed out -> [start, end] of the range it owns (linear allocations own their alignment padding)
+    std::map<vk::DeviceSize, std::pair<vk::DeviceSize, vk::DeviceSize>> allocatedRanges;
+
+    // linear: next free byte
+    vk::DeviceSize linearHead = 0;
+};
+
+struct MemoryBlock
+{
+    vk::raii::DeviceMemory memory = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    ResourceKind kind = ResourceKind::eBuffer;
+    void* mapped = nullptr;
+    // set by the defragmenter while it moves everything out, no new allocations land here
+    bool evacuating = false;
+    BlockMetadata metadata;
+
+    MemoryBlock(vk::DeviceSize size, AllocationStrategy strategy) : metadata(size, strategy) {}
+};
+
+class MemoryAllocator;
+
+// handle to a range of device memory. move only.
+// naming mirrors the vk::raii objects it replaces (clear() / = nullptr) so resource cleanup reads the same
+class MemoryAllocation
+{
+public:
+    MemoryAllocation() = default;
+    MemoryAllocation(std::nullptr_t) {}
+    ~MemoryAllocation();
+
+    MemoryAllocation(const MemoryAllocation&) = delete;
+    MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+    MemoryAllocation(MemoryAllocation&& other) noexcept;
+    MemoryAllocation& operator=(MemoryAllocation&& other) noexcept;
+    MemoryAllocation& operator=(std::nullptr_t);
+
+    // hand the range back to the allocator
+    void clear();
+
+    [[nodiscard]] vk::DeviceMemory getMemory() const { return memory; }
+    [[nodiscard]] vk::DeviceSize getOffset() const { return offset; }
+    [[nodiscard]] vk::DeviceSize getSize() const { return size; }
+    [[nodiscard]] uint32_t getMemoryTypeIndex() const { return memoryTypeIndex; }
+    [[nodiscard]] bool isDedicated() const { return block == nullptr && memory; }
+    [[nodiscard]] MemoryCategory getCategory() const { return category; }
+    // the shared block the range is in, nullptr for dedicated allocations
+    [[nodiscard]] const MemoryBlock* getBlock() const { return block; }
+    // persistently mapped pointer (nullptr when the memory type isn't host visible)
+    [[nodiscard]] void* getMappedData() const { return mapped; }
+
+    explicit operator bool() const { return static_cast<bool>(memory); }
+
+private:
+    friend class MemoryAllocator;
+
+    MemoryAllocator* allocator = nullptr;
+    MemoryBlock* block = nullptr;
+    vk::raii::DeviceMemory dedicatedMemory = nullptr;
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    MemoryCategory category = MemoryCategory::eOther;
+    void* mapped = nullptr;
+};
+
+// per heap numbers for the 'how much are we using' readout
+struct HeapStatistics
+{
+    uint32_t blockCount = 0;        // vkAllocateMemory calls backing shared blocks
+    uint32_t dedicatedCount = 0;    // vkAllocateMemory calls for single resources
+    uint32_t allocationCount = 0;   // live resources placed in this heap
+    vk::DeviceSize reservedBytes = 0; // bytes taken from the heap (blocks + dedicated)
+    vk::DeviceSize usedBytes = 0;     // bytes actually handed to resources
+};
+
+struct CategoryStatistics
+{
+    uint32_t allocationCount = 0;
+    vk::DeviceSize usedBytes = 0;
+};
+
+// how close a heap is to its budget
+enum class MemoryPressure
+{
+    eNone,
+    eModerate,  // stop growing caches, stream out what isn't needed soon
+    eCritical   // the next allocations may fail or get paged out, free memory now
+};
+
+// per heap numbers from VK_EXT_memory_budget (estimated from our own allocations without it)
+struct HeapBudget
+{
+    vk::DeviceSize budget = 0;  // what the process can use before the OS starts paging or allocations fail
+    vk::DeviceSize usage = 0;   // what the process uses right now, including memory the allocator didn't make
+    MemoryPressure pressure = MemoryPressure::eNone;
+};
+
+struct MemoryPressureEvent
+{
+    uint32_t heapIndex = 0;
+    MemoryPressure previous = MemoryPressure::eNone;
+    MemoryPressure current = MemoryPressure::eNone;
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize budget = 0;
+};
+
+using MemoryPressureCallback = std::function<void(const MemoryPressureEvent&)>;
+
+// one shared block as seen by the defragmenter
+struct BlockUsage
+{
+    const MemoryBlock* block = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    ResourceKind kind = ResourceKind::eBuffer;
+    AllocationStrategy strategy = AllocationStrategy::eFreeList;
+    vk::DeviceSize size = 0;
+    vk::DeviceSize usedBytes = 0;
+    uint32_t allocationCount = 0;
+    bool evacuating = false;
+};
+
+class MemoryAllocator
+{
+public:
+    // default size of a shared block, shrunk for small heaps
+    static constexpr vk::DeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+    // usage / budget at which a heap counts as under pressure
+    static constexpr double ModeratePressure = 0.8;
+    static constexpr double CriticalPressure = 0.95;
+
+    MemoryAllocator() = default;
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+    ~MemoryAllocator();
+
+    // memoryBudget: VK_EXT_memory_budget is enabled on the device
+    void init(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& logicalDevice, bool memoryBudget = false);
+    // frees every block. all allocations must be released before this
+    void clear();
+
+    MemoryAllocation allocateForBuffer(const vk::raii::Buffer& buffer, const MemoryPlacement& placement,
+        AllocationStrategy strategy = AllocationStrategy::eFreeList, MemoryCategory category = MemoryCategory::eOther);
+    MemoryAllocation allocateForImage(const vk::raii::Image& image, const MemoryPlacement& placement,
+        AllocationStrategy strategy = AllocationStrategy::eFreeList, MemoryCategory category = MemoryCategory::eOther);
+    // one allocation that every image in the list can be bound to at offset 0 (aliasing).
+    // the images must never hold live contents at the same time
+    MemoryAllocation allocateAliased(const std::vector<vk::MemoryRequirements>& requirements, const MemoryPlacement& placement,
+        MemoryCategory category = MemoryCategory::eOther);
+
+    // bytes the driver actually backs a LAZILY_ALLOCATED allocation with right now (0 for other types)
+    [[nodiscard]] vk::DeviceSize getCommitment(const MemoryAllocation& allocation) const;
+
+    // highest scoring type for the placement, throws when no type has the required flags
+    [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, const MemoryPlacement& placement) const;
+    // is there any memory type that has all of these flags
+    [[nodiscard]] bool hasMemoryType(vk::MemoryPropertyFlags required) const;
+    [[nodiscard]] vk::MemoryPropertyFlags getMemoryTypeFlags(uint32_t memoryTypeIndex) const { return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags; }
+    [[nodiscard]] const vk::PhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+
+    [[nodiscard]] std::vector<HeapStatistics> getHeapStatistics() const;
+    [[nodiscard]] std::array<CategoryStatistics, static_cast<size_t>(MemoryCategory::eCount)> getCategoryStatistics() const;
+    void logStatistics() const;
+
+    // re-reads the per heap budget/usage and fires the pressure callbacks of heaps whose level changed. once per frame
+    void updateBudget();
+    [[nodiscard]] std::vector<HeapBudget> getBudgets() const;
+    [[nodiscard]] bool hasMemoryBudget() const { return memoryBudgetSupported; }
+    // returns an id for removePressureCallback. callbacks run on the thread calling updateBudget, outside the allocator lock
+    uint32_t addPressureCallback(MemoryPressureCallback callback);
+    void removePressureCallback(uint32_t id);
+
+    // defragmentation support (see MemoryDefragmenter.h)
+    [[nodiscard]] std::vector<BlockUsage> getBlockUsage() const;
+    // an evacuating block takes no new allocations. the flag drops by itself once the block runs empty
+    void setEvacuating(const MemoryBlock* block, bool evacuating);
+
+private:
+    friend class MemoryAllocation;
+
+    MemoryAllocation allocate(const vk::MemoryRequirements& requirements, bool prefersDedicated, ResourceKind kind,
+        const MemoryPlacement& placement, AllocationStrategy strategy, MemoryCategory category,
+        vk::Buffer dedicatedBuffer, vk::Image dedicatedImage);
+    MemoryAllocation allocateDedicated(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category,
+        vk::Buffer dedicatedBuffer, vk::Image dedicatedImage);
+    MemoryBlock& createBlock(uint32_t memoryTypeIndex, ResourceKind kind, AllocationStrategy strategy, vk::DeviceSize minimumSize);
+    void free(MemoryAllocation& allocation);
+
+    [[nodiscard]] vk::DeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+
+    const vk::raii::Device* device = nullptr;
+    const vk::raii::PhysicalDevice* physicalDevice = nullptr;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    uint32_t maxAllocationCount = 0;
+    uint32_t deviceAllocationCount = 0;
+
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    std::vector<HeapStatistics> heapStatistics;
+    std::array<CategoryStatistics, static_cast<size_t>(MemoryCategory::eCount)> categoryStatistics{};
+
+    bool memoryBudgetSupported = false;
+    std::vector<HeapBudget> budgets;
+    std::vector<std::pair<uint32_t, MemoryPressureCallback>> pressureCallbacks;
+    uint32_t nextCallbackId = 0;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,375 @@
+#include "MemoryDefragmenter.h"
+
+#include <algorithm>
+#include <map>
+
+#include "Logger.h"
+
+namespace
+{
+    // for "{:.2f} MiB"
+    double toMiB(vk::DeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    void recordImageBarrier(const vk::raii::CommandBuffer& commandBuffer, vk::Image image, uint32_t mipLevels,
+        vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+        vk::PipelineStageFlags2 srcStage, vk::AccessFlags2 srcAccess, vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess)
+    {
+        vk::ImageMemoryBarrier2 barrier
+        {
+            .srcStageMask = srcStage,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = dstStage,
+            .dstAccessMask = dstAccess,
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1}
+        };
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier});
+    }
+}
+
+void MemoryDefragmenter::init(const vk::raii::Device& logicalDevice, MemoryAllocator& memoryAllocator, vk::DeviceSize frameBytes)
+{
+    device = &logicalDevice;
+    allocator = &memoryAllocator;
+    bytesPerFrame = frameBytes;
+}
+
+void MemoryDefragmenter::clear()
+{
+    moves.clear();
+    retired.clear();
+    if (allocator)
+    {
+        for (const MemoryBlock* block : evacuatingBlocks)
+        {
+            allocator->setEvacuating(block, false);
+        }
+    }
+    evacuatingBlocks.clear();
+    resources.clear();
+}
+
+void MemoryDefragmenter::registerBuffer(vk::raii::Buffer& buffer, MemoryAllocation& memory, vk::DeviceSize size, vk::BufferUsageFlags usage,
+    MovedCallback onMoved)
+{
+    auto resource = std::make_unique<Resource>();
+    resource->buffer = &buffer;
+    resource->memory = &memory;
+    resource->bufferInfo = vk::BufferCreateInfo
+    {
+        .size = size,
+        .usage = usage | vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive
+    };
+    resource->onMoved = std::move(onMoved);
+    resources.push_back(std::move(resource));
+}
+
+void MemoryDefragmenter::registerImage(vk::raii::Image& image, MemoryAllocation& memory, vk::Format format, vk::Extent2D extent, uint32_t mipLevels,
+    vk::ImageUsageFlags usage, vk::ImageLayout layout, MovedCallback onMoved)
+{
+    auto resource = std::make_unique<Resource>();
+    resource->image = &image;
+    resource->memory = &memory;
+    resource->imageInfo = vk::ImageCreateInfo
+    {
+        .imageType = vk::ImageType::e2D,
+        .format = format,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = mipLevels,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = usage | vk::ImageUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive
+    };
+    resource->layout = layout;
+    resource->onMoved = std::move(onMoved);
+    resources.push_back(std::move(resource));
+}
+
+void MemoryDefragmenter::unregister(const MemoryAllocation& memory)
+{
+    auto it = std::ranges::find_if(resources, [&memory](const auto& resource) { return resource->memory == &memory; });
+    if (it == resources.end())
+    {
+        return;
+    }
+    Resource* resource = it->get();
+
+    // a copy into the new objects may still be running, they retire like old ones
+    for (auto move = moves.begin(); move != moves.end();)
+    {
+        if (move->resource == resource)
+        {
+            retired.push_back({.memory = std::move(move->memory), .buffer = std::move(move->buffer), .image = std::move(move->image),
+                .lastUseFrame = lastRecordedFrame});
+            move = moves.erase(move);
+        }
+        else
+        {
+            ++move;
+        }
+    }
+
+    // the resource stays where it is, its block can't run empty anymore
+    const MemoryBlock* block = memory.getBlock();
+    if (isEvacuating(block))
+    {
+        allocator->setEvacuating(block, false);
+        std::erase(evacuatingBlocks, block);
+    }
+    resources.erase(it);
+}
+
+void MemoryDefragmenter::retire(vk::raii::ImageView view)
+{
+    // behind the old image it views, the queue stays ordered by lastUseFrame
+    retired.push_back({.view = std::move(view), .lastUseFrame = lastRecordedFrame});
+}
+
+void MemoryDefragmenter::requestDefragmentation()
+{
+    refreshEvacuatingBlocks();
+    std::vector<BlockUsage> blocks = allocator->getBlockUsage();
+
+    // a block can only be emptied when everything in it can be moved
+    std::map<const MemoryBlock*, uint32_t> movableCounts;
+    for (const auto& resource : resources)
+    {
+        if (resource->memory->getBlock())
+        {
+            movableCounts[resource->memory->getBlock()]++;
+        }
+    }
+
+    // emptiest first, those are the cheapest to evacuate
+    std::ranges::sort(blocks, {}, &BlockUsage::usedBytes);
+    std::vector<const MemoryBlock*> picked;
+    for (const BlockUsage& candidate : blocks)
+    {
+        if (candidate.evacuating || candidate.strategy != AllocationStrategy::eFreeList || candidate.allocationCount == 0 ||
+            static_cast<double>(candidate.usedBytes) >= static_cast<double>(candidate.size) * SparseBlockThreshold ||
+            movableCounts[candidate.block] != candidate.allocationCount)
+        {
+            continue;
+        }
+
+        // the resources have to fit into the other blocks of the same type, otherwise moving just allocates a new block
+        vk::DeviceSize freeBytes = 0;
+        for (const BlockUsage& other : blocks)
+        {
+            if (other.block != candidate.block && !other.evacuating && other.memoryTypeIndex == candidate.memoryTypeIndex &&
+                other.kind == candidate.kind && other.strategy == candidate.strategy && std::ranges::find(picked, other.block) == picked.end())
+            {
+                freeBytes += other.size - other.usedBytes;
+            }
+        }
+        for (const BlockUsage& other : blocks)
+        {
+            // bytes already promised to these blocks by blocks picked before
+            if (std::ranges::find(picked, other.block) != picked.end() && other.memoryTypeIndex == candidate.memoryTypeIndex &&
+                other.kind == candidate.kind)
+            {
+                freeBytes -= std::min(freeBytes, other.usedBytes);
+            }
+        }
+        if (freeBytes < candidate.usedBytes)
+        {
+            continue;
+        }
+
+        allocator->setEvacuating(candidate.block, true);
+        evacuatingBlocks.push_back(candidate.block);
+        picked.push_back(candidate.block);
+        ANUBIS_LOG_INFO("Evacuating memory block: type {}, {} allocations, {:.2f} / {:.2f} MiB", candidate.memoryTypeIndex, candidate.allocationCount,
+            toMiB(candidate.usedBytes), toMiB(candidate.size));
+    }
+}
+
+bool MemoryDefragmenter::isEvacuating(const MemoryBlock* block) const
+{
+    return block && std::ranges::find(evacuatingBlocks, block) != evacuatingBlocks.end();
+}
+
+void MemoryDefragmenter::recordMoves(const vk::raii::CommandBuffer& commandBuffer, uint64_t frameNumber)
+{
+    lastRecordedFrame = frameNumber;
+    if (evacuatingBlocks.empty())
+    {
+        return;
+    }
+
+    vk::DeviceSize budget = bytesPerFrame;
+    bool recorded = false;
+    for (const auto& resource : resources)
+    {
+        if (resource->moving || !isEvacuating(resource->memory->getBlock()))
+        {
+            continue;
+        }
+        // always at least one per frame, so resources bigger than the budget still get moved
+        const vk::DeviceSize size = resource->memory->getSize();
+        if (recorded && size > budget)
+        {
+            break;
+        }
+
+        Move& move = moves.emplace_back();
+        move.resource = resource.get();
+        move.frameNumber = frameNumber;
+        if (resource->buffer)
+        {
+            recordBufferMove(commandBuffer, *resource, move);
+        }
+        else
+        {
+            recordImageMove(commandBuffer, *resource, move);
+        }
+        resource->moving = true;
+        budget -= std::min(budget, size);
+        recorded = true;
+    }
+
+    if (recorded)
+    {
+        // the new objects are read by the frames after this one
+        vk::MemoryBarrier2 barrier
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead
+        };
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    }
+}
+
+void MemoryDefragmenter::recordBufferMove(const vk::raii::CommandBuffer& commandBuffer, Resource& resource, Move& move)
+{
+    // same memory type as before, the allocator skips evacuating blocks
+    const MemoryPlacement placement{.required = allocator->getMemoryTypeFlags(resource.memory->getMemoryTypeIndex())};
+    move.buffer = vk::raii::Buffer(*device, resource.bufferInfo);
+    move.memory = allocator->allocateForBuffer(move.buffer, placement, AllocationStrategy::eFreeList, resource.memory->getCategory());
+    move.buffer.bindMemory(move.memory.getMemory(), move.memory.getOffset());
+
+    commandBuffer.copyBuffer(**resource.buffer, *move.buffer, vk::BufferCopy{.srcOffset = 0, .dstOffset = 0, .size = resource.bufferInfo.size});
+}
+
+void MemoryDefragmenter::recordImageMove(const vk::raii::CommandBuffer& commandBuffer, Resource& resource, Move& move)
+{
+    const MemoryPlacement placement{.required = allocator->getMemoryTypeFlags(resource.memory->getMemoryTypeIndex())};
+    move.image = vk::raii::Image(*device, resource.imageInfo);
+    move.memory = allocator->allocateForImage(move.image, placement, AllocationStrategy::eFreeList, resource.memory->getCategory());
+    move.image.bindMemory(move.memory.getMemory(), move.memory.getOffset());
+
+    const uint32_t mipLevels = resource.imageInfo.mipLevels;
+    // earlier frames may still be sampling the old image, wait for them before changing its layout
+    recordImageBarrier(commandBuffer, **resource.image, mipLevels, resource.layout, vk::ImageLayout::eTransferSrcOptimal,
+        vk::PipelineStageFlagBits2::eAllCommands, {}, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferRead);
+    recordImageBarrier(commandBuffer, *move.image, mipLevels, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+        vk::PipelineStageFlagBits2::eNone, {}, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite);
+
+    std::vector<vk::ImageCopy> regions;
+    for (uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        const vk::Extent3D extent
+        {
+            std::max(resource.imageInfo.extent.width >> mip, 1u),
+            std::max(resource.imageInfo.extent.height >> mip, 1u),
+            1
+        };
+        regions.push_back(
+        {
+            .srcSubresource = {vk::ImageAspectFlagBits::eColor, mip, 0, 1},
+            .dstSubresource = {vk::ImageAspectFlagBits::eColor, mip, 0, 1},
+            .extent = extent
+        });
+    }
+    commandBuffer.copyImage(**resource.image, vk::ImageLayout::eTransferSrcOptimal, *move.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+    // the rest of this frame still renders from the old image
+    recordImageBarrier(commandBuffer, **resource.image, mipLevels, vk::ImageLayout::eTransferSrcOptimal, resource.layout,
+        vk::PipelineStageFlagBits2::eTransfer, {}, vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryRead);
+    recordImageBarrier(commandBuffer, *move.image, mipLevels, vk::ImageLayout::eTransferDstOptimal, resource.layout,
+        vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite, vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryRead);
+}
+
+void MemoryDefragmenter::completeMoves(uint64_t completedFrameNumber)
+{
+    while (!moves.empty() && moves.front().frameNumber <= completedFrameNumber)
+    {
+        Move& move = moves.front();
+        Resource& resource = *move.resource;
+
+        // frames recorded since the copy still reference the old objects
+        Retired& old = retired.emplace_back();
+        old.lastUseFrame = lastRecordedFrame;
+        old.memory = std::move(*resource.memory);
+        *resource.memory = std::move(move.memory);
+        if (resource.buffer)
+        {
+            old.buffer = std::move(*resource.buffer);
+            *resource.buffer = std::move(move.buffer);
+        }
+        else
+        {
+            old.image = std::move(*resource.image);
+            *resource.image = std::move(move.image);
+        }
+        resource.moving = false;
+        movedCount++;
+        movedBytes += resource.memory->getSize();
+        moves.pop_front();
+
+        if (resource.onMoved)
+        {
+            resource.onMoved();
+        }
+    }
+
+    while (!retired.empty() && retired.front().lastUseFrame <= completedFrameNumber)
+    {
+        retired.pop_front();
+    }
+
+    if (!evacuatingBlocks.empty())
+    {
+        refreshEvacuatingBlocks();
+    }
+}
+
+void MemoryDefragmenter::refreshEvacuatingBlocks()
+{
+    const std::vector<BlockUsage> blocks = allocator->getBlockUsage();
+    std::erase_if(evacuatingBlocks, [this, &blocks](const MemoryBlock* block)
+    {
+        // released, or still around as the empty spare (the allocator drops the flag once the block is empty)
+        const bool stillEvacuating = std::ranges::any_of(blocks, [block](const BlockUsage& usage)
+        {
+            return usage.block == block && usage.evacuating;
+        });
+        if (!stillEvacuating)
+        {
+            evacuatedBlockCount++;
+            Logger::printToConsole("Memory block evacuated", level::info);
+        }
+        return !stillEvacuating;
+    });
+}
+
+void MemoryDefragmenter::logStatistics() const
+{
+    Logger::printToConsole("***** Memory Defragmenter Statistics *****");
+    ANUBIS_LOG_INFO("Registered Resources: {}", resources.size());
+    ANUBIS_LOG_INFO("Moved: {} resources, {:.2f} MiB", movedCount, toMiB(movedBytes));
+    ANUBIS_LOG_INFO("Blocks Evacuated: {}", evacuatedBlockCount);
+    Logger::printToConsole("*************************");
+}
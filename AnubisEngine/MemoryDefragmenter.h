@@ -0,0 +1,116 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// incremental defragmentation of the MemoryAllocator's shared blocks.
+// load/unload cycles leave blocks that are mostly empty but still hold their whole size of the heap.
+// such a sparse block is marked evacuating (nothing new lands in it) and its registered resources are moved out a few per frame:
+//  1) a new buffer/image is created and allocated somewhere else
+//  2) the copy is recorded into the frame's command buffer, ahead of the rendering (recordMoves)
+//  3) once that frame's fence signaled, the owner's objects are swapped for the new ones and the owner is told (completeMoves)
+//  4) the old objects (+ views the owner retires) live on until no frame in flight can still reference them
+// when the last allocation leaves, the allocator releases the block (or keeps it as its one spare).
+// only registered resources move - anything else in a block keeps it from being picked.
+// contents must not change while a move is in flight (static geometry, textures).
+class MemoryDefragmenter
+{
+public:
+    // bytes copied per frame, keeps the extra GPU work per frame small
+    static constexpr vk::DeviceSize DefaultBytesPerFrame = 8ull * 1024 * 1024;
+    // blocks below this fill level are evacuated
+    static constexpr double SparseBlockThreshold = 0.5;
+
+    // called after the owner's objects were swapped, views/descriptors pointing at the old ones have to be rebuilt.
+    // the old views go to retire, frames in flight still read them
+    using MovedCallback = std::function<void()>;
+
+    void init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator, vk::DeviceSize bytesPerFrame = DefaultBytesPerFrame);
+    // the device has to be idle
+    void clear();
+
+    // the buffer/image and allocation stay owned by the caller, they are replaced in place when moved.
+    // buffers need TRANSFER_SRC usage (TRANSFER_DST is added to the copy)
+    void registerBuffer(vk::raii::Buffer& buffer, MemoryAllocation& memory, vk::DeviceSize size, vk::BufferUsageFlags usage,
+        MovedCallback onMoved = {});
+    // 2D, single layer, single sample images that sit in layout between frames (sampled textures). needs TRANSFER_SRC usage
+    void registerImage(vk::raii::Image& image, MemoryAllocation& memory, vk::Format format, vk::Extent2D extent, uint32_t mipLevels,
+        vk::ImageUsageFlags usage, vk::ImageLayout layout, MovedCallback onMoved = {});
+    // call before freeing a registered resource
+    void unregister(const MemoryAllocation& memory);
+    // destroyed once every frame recorded so far has finished, together with the objects it views
+    void retire(vk::raii::ImageView view);
+
+    // picks the sparse blocks to evacuate. cheap, call on memory pressure
+    void requestDefragmentation();
+    [[nodiscard]] bool isActive() const { return !evacuatingBlocks.empty() || !moves.empty(); }
+
+    // records this frame's copies. frameNumber counts up by one per submitted frame
+    void recordMoves(const vk::raii::CommandBuffer& commandBuffer, uint64_t frameNumber);
+    // every frame up to and including completedFrameNumber has finished on the GPU
+    void completeMoves(uint64_t completedFrameNumber);
+
+    void logStatistics() const;
+
+private:
+    struct Resource
+    {
+        vk::raii::Buffer* buffer = nullptr;
+        vk::raii::Image* image = nullptr;
+        MemoryAllocation* memory = nullptr;
+        vk::BufferCreateInfo bufferInfo;
+        vk::ImageCreateInfo imageInfo;
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        MovedCallback onMoved;
+        bool moving = false;
+    };
+
+    // memory first, members are destroyed in reverse - the objects go before the range they are bound to
+    struct Move
+    {
+        MemoryAllocation memory = nullptr;
+        vk::raii::Buffer buffer = nullptr;
+        vk::raii::Image image = nullptr;
+        Resource* resource = nullptr;
+        uint64_t frameNumber = 0;
+    };
+
+    // old objects waiting for the frames that may still use them
+    struct Retired
+    {
+        MemoryAllocation memory = nullptr;
+        vk::raii::Buffer buffer = nullptr;
+        vk::raii::Image image = nullptr;
+        vk::raii::ImageView view = nullptr;
+        uint64_t lastUseFrame = 0;
+    };
+
+    [[nodiscard]] bool isEvacuating(const MemoryBlock* block) const;
+    void recordBufferMove(const vk::raii::CommandBuffer& commandBuffer, Resource& resource, Move& move);
+    void recordImageMove(const vk::raii::CommandBuffer& commandBuffer, Resource& resource, Move& move);
+    // drops blocks the allocator released or finished evacuating
+    void refreshEvacuatingBlocks();
+
+    const vk::raii::Device* device = nullptr;
+    MemoryAllocator* allocator = nullptr;
+    vk::DeviceSize bytesPerFrame = DefaultBytesPerFrame;
+
+    // stable addresses, moves point at their resource
+    std::vector<std::unique_ptr<Resource>> resources;
+    std::vector<const MemoryBlock*> evacuatingBlocks;
+    std::deque<Move> moves;
+    std::deque<Retired> retired;
+    uint64_t lastRecordedFrame = 0;
+
+    // statistics
+    uint32_t movedCount = 0;
+    vk::DeviceSize movedBytes = 0;
+    uint32_t evacuatedBlockCount = 0;
+};
@@ -0,0 +1,218 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Logger.h"
+
+namespace
+{
+    // "APCH"
+    constexpr uint32_t FileMagic = 0x48435041;
+    // bump when FileHeader changes
+    constexpr uint32_t FileVersion = 1;
+
+    // FNV-1a, only has to catch truncated and damaged files
+    uint64_t hashData(const std::vector<char>& data)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char byte : data)
+        {
+            hash = (hash ^ static_cast<uint8_t>(byte)) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+void PipelineCache::init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, const std::string& cachePath,
+    bool cold)
+{
+    Logger::printToConsole("***** Creating Pipeline Cache *****");
+    device = &logicalDevice;
+    path = cachePath;
+    properties = physicalDevice.getProperties();
+    pipelineCount = 0;
+    compileMs = 0.0;
+
+    const std::vector<char> data = cold ? std::vector<char>() : load();
+    warm = !data.empty();
+    cache = vk::raii::PipelineCache(logicalDevice, vk::PipelineCacheCreateInfo{
+        .initialDataSize = data.size(),
+        .pInitialData = data.data()
+    });
+
+    ANUBIS_LOG_INFO("Path: {}", path);
+    if (warm)
+    {
+        ANUBIS_LOG_INFO("Warm: {} bytes loaded", data.size());
+    }
+    else
+    {
+        ANUBIS_LOG_INFO("Cold: {}", cold ? "file ignored (--cold-pipeline-cache)" : "no usable file");
+    }
+    Logger::printToConsole("*************************");
+}
+
+void PipelineCache::clear()
+{
+    if (*cache)
+    {
+        save();
+    }
+    cache.clear();
+    cache = nullptr;
+    device = nullptr;
+}
+
+vk::raii::Pipeline PipelineCache::createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    vk::raii::Pipeline pipeline(*device, cache, createInfo);
+    addCompile(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return pipeline;
+}
+
+vk::raii::Pipeline PipelineCache::createComputePipeline(const vk::ComputePipelineCreateInfo& createInfo)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    vk::raii::Pipeline pipeline(*device, cache, createInfo);
+    addCompile(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return pipeline;
+}
+
+uint32_t PipelineCache::getPipelineCount() const
+{
+    std::lock_guard lock(statsMutex);
+    return pipelineCount;
+}
+
+double PipelineCache::getCompileMs() const
+{
+    std::lock_guard lock(statsMutex);
+    return compileMs;
+}
+
+void PipelineCache::logStatistics() const
+{
+    std::lock_guard lock(statsMutex);
+    ANUBIS_LOG_INFO("Pipeline compile: {:.3f} ms for {} pipeline(s), {} cache", compileMs, pipelineCount, warm ? "warm" : "cold");
+}
+
+std::vector<char> PipelineCache::load() const
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return {};
+    }
+
+    auto reject = [this](const std::string& reason)
+    {
+        ANUBIS_LOG_WARN("Pipeline cache {} not used: {}", path, reason);
+        return std::vector<char>();
+    };
+    FileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return reject("truncated header");
+    }
+    const FileHeader expected = makeHeader(header.dataSize, header.dataHash);
+    if (header.magic != expected.magic || header.version != expected.version)
+    {
+        return reject("not a pipeline cache file of this version");
+    }
+    if (header.vendorId != expected.vendorId || header.deviceId != expected.deviceId
+        || memcmp(header.cacheUuid, expected.cacheUuid, VK_UUID_SIZE) != 0)
+    {
+        return reject("written for another device");
+    }
+    if (header.driverVersion != expected.driverVersion)
+    {
+        return reject("written by another driver version");
+    }
+
+    // checked against the file before trusting it with an allocation
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) != sizeof(header) + header.dataSize || error)
+    {
+        return reject("truncated data");
+    }
+    std::vector<char> data(header.dataSize);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+    {
+        return reject("truncated data");
+    }
+    if (hashData(data) != header.dataHash)
+    {
+        return reject("damaged data");
+    }
+
+    // the driver's own header at the front of the data has to agree as well
+    vk::PipelineCacheHeaderVersionOne driverHeader;
+    if (data.size() < sizeof(driverHeader))
+    {
+        return reject("no driver header");
+    }
+    memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    if (driverHeader.headerVersion != vk::PipelineCacheHeaderVersion::eOne || driverHeader.vendorID != properties.vendorID
+        || driverHeader.deviceID != properties.deviceID
+        || memcmp(driverHeader.pipelineCacheUUID.data(), properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+    {
+        return reject("driver header doesn't match the device");
+    }
+    return data;
+}
+
+void PipelineCache::save() const
+{
+    const std::vector<uint8_t> cacheData = cache.getData();
+    const std::vector<char> data(cacheData.begin(), cacheData.end());
+    const FileHeader header = makeHeader(data.size(), hashData(data));
+
+    // next to the old file, swapped in once complete
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good())
+        {
+            ANUBIS_LOG_WARN("Failed to write pipeline cache: {}", tempPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        ANUBIS_LOG_WARN("Failed to replace pipeline cache {}: {}", path, error.message());
+        return;
+    }
+    ANUBIS_LOG_INFO("Pipeline cache saved: {} bytes to {}", data.size(), path);
+}
+
+void PipelineCache::addCompile(double ms)
+{
+    std::lock_guard lock(statsMutex);
+    compileMs += ms;
+    pipelineCount++;
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader(uint64_t dataSize, uint64_t dataHash) const
+{
+    FileHeader header
+    {
+        .magic = FileMagic,
+        .version = FileVersion,
+        .vendorId = properties.vendorID,
+        .deviceId = properties.deviceID,
+        .driverVersion = properties.driverVersion,
+        .cacheUuid = {},
+        .dataSize = dataSize,
+        .dataHash = dataHash
+    };
+    memcpy(header.cacheUuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return header;
+}
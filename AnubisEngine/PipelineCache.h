@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// one VkPipelineCache for every pipeline the engine creates, kept on disk between runs.
+// the file is the driver's cache data behind a header of our own: the device (vendor, device id, pipelineCacheUUID)
+// and the driver version it was written with + the size and a hash of the data. a file from another GPU, another
+// driver or a broken write is thrown away and the cache starts cold - drivers aren't required to survive bad data.
+// written back on clear, through a temporary file so a crash mid write leaves the old one
+//
+//  [ FileHeader | vkGetPipelineCacheData ]
+class PipelineCache
+{
+public:
+    static constexpr const char* DefaultPath = "pipeline_cache.bin";
+
+    // cold: ignore what is on disk (still written back)
+    void init(const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, const std::string& path = DefaultPath,
+        bool cold = false);
+    // saves, then destroys the cache
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return device != nullptr; }
+
+    // every pipeline goes through here, compile times are added up. any thread, VkPipelineCache is internally synchronized
+    [[nodiscard]] vk::raii::Pipeline createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo);
+    [[nodiscard]] vk::raii::Pipeline createComputePipeline(const vk::ComputePipelineCreateInfo& createInfo);
+
+    [[nodiscard]] const vk::raii::PipelineCache& getCache() const { return cache; }
+    // the file on disk was valid and loaded
+    [[nodiscard]] bool isWarm() const { return warm; }
+    [[nodiscard]] uint32_t getPipelineCount() const;
+    [[nodiscard]] double getCompileMs() const;
+    void logStatistics() const;
+
+private:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorId;
+        uint32_t deviceId;
+        uint32_t driverVersion;
+        uint8_t cacheUuid[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    // the cache data, empty when there is no valid file
+    [[nodiscard]] std::vector<char> load() const;
+    void save() const;
+    [[nodiscard]] FileHeader makeHeader(uint64_t dataSize, uint64_t dataHash) const;
+    void addCompile(double ms);
+
+    const vk::raii::Device* device = nullptr;
+    vk::raii::PipelineCache cache = nullptr;
+    std::string path;
+    vk::PhysicalDeviceProperties properties;
+    bool warm = false;
+
+    // compile threads add to these too
+    mutable std::mutex statsMutex;
+    uint32_t pipelineCount = 0;
+    double compileMs = 0.0;
+};
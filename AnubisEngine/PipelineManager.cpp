@@ -0,0 +1,453 @@
+#include "PipelineManager.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Logger.h"
+
+namespace
+{
+    // FNV-1a, folded over every field of a key
+    constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+    uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    uint64_t hashValue(uint64_t hash, const T& value)
+    {
+        return hashBytes(hash, &value, sizeof(T));
+    }
+
+    vk::PipelineColorBlendAttachmentState getBlendState(BlendMode blend)
+    {
+        vk::PipelineColorBlendAttachmentState state
+        {
+            .blendEnable = blend != BlendMode::eOpaque,
+            .colorBlendOp = vk::BlendOp::eAdd,
+            .alphaBlendOp = vk::BlendOp::eAdd,
+            .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+        };
+        switch (blend)
+        {
+        case BlendMode::eOpaque:
+            break;
+        case BlendMode::eAlpha:
+            // finalColor.rgb = newAlpha * newColor + (1 - newAlpha) * oldColor
+            state.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+            state.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+            state.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+            state.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+            break;
+        case BlendMode::eAdditive:
+            state.srcColorBlendFactor = vk::BlendFactor::eOne;
+            state.dstColorBlendFactor = vk::BlendFactor::eOne;
+            state.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+            state.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+            break;
+        }
+        return state;
+    }
+}
+
+void PipelineManager::init(const vk::raii::Device& logicalDevice, PipelineCache& cache, vk::PipelineLayout layout, const std::string& path,
+    uint32_t compileThreads)
+{
+    device = &logicalDevice;
+    pipelineCache = &cache;
+    pipelineLayout = layout;
+    listPath = path;
+    stopping = false;
+    for (uint32_t i = 0; i < compileThreads; i++)
+    {
+        threads.emplace_back(&PipelineManager::compileMain, this);
+    }
+    ANUBIS_LOG_INFO("Compile Threads: {}", compileThreads);
+    ANUBIS_LOG_INFO("Permutation List: {}", listPath);
+}
+
+PipelineManager::~PipelineManager()
+{
+    stopThreads();
+}
+
+void PipelineManager::clear()
+{
+    stopThreads();
+
+    // next session's prewarm: every permutation asked for in this one, ready or not. prewarmed permutations that were
+    // never asked for are left out, otherwise the list would only ever grow
+    const auto requested = std::ranges::count_if(entries, [](const auto& entry) { return entry.second->requested; });
+    if (requested > 0)
+    {
+        std::ofstream file(listPath, std::ios::trunc);
+        for (const auto& [key, entry] : entries)
+        {
+            if (!entry->requested)
+            {
+                continue;
+            }
+            const PipelineDesc& desc = entry->desc;
+            file << desc.shader << ' ' << desc.vertexLayout << ' ' << static_cast<uint32_t>(desc.colorFormat) << ' '
+                << static_cast<uint32_t>(desc.depthFormat) << ' ' << static_cast<uint32_t>(desc.samples) << ' ' << desc.minSampleShading << ' '
+                << static_cast<uint32_t>(desc.blend) << ' ' << desc.depthTest << ' ' << desc.depthWrite << ' '
+                << static_cast<uint32_t>(desc.depthCompare) << ' ' << static_cast<uint32_t>(desc.cullMode) << ' '
+                << static_cast<uint32_t>(desc.frontFace) << '\n';
+        }
+        ANUBIS_LOG_INFO("Pipeline permutations saved: {} of {} to {}", requested, entries.size(), listPath);
+    }
+
+    fallbacks.clear();
+    entries.clear();
+    vertexLayouts.clear();
+    shaders.clear();
+    pipelineCache = nullptr;
+    device = nullptr;
+}
+
+void PipelineManager::registerShader(const std::string& name, const std::vector<char>& spirv, const std::string& vertexEntry,
+    const std::string& fragmentEntry)
+{
+    Shader& shader = shaders[name];
+    shader.module = vk::raii::ShaderModule(*device, vk::ShaderModuleCreateInfo{
+        .codeSize = spirv.size() * sizeof(char),
+        .pCode = reinterpret_cast<const uint32_t*>(spirv.data())
+    });
+    shader.vertexEntry = vertexEntry;
+    shader.fragmentEntry = fragmentEntry;
+    // the key follows the SPIR-V, a rebuilt shader never matches a pipeline of the old one
+    shader.hash = hashBytes(hashBytes(hashBytes(HashSeed, spirv.data(), spirv.size()), vertexEntry.data(), vertexEntry.size()),
+        fragmentEntry.data(), fragmentEntry.size());
+}
+
+void PipelineManager::registerVertexLayout(const std::string& name, const vk::VertexInputBindingDescription& binding,
+    const std::vector<vk::VertexInputAttributeDescription>& attributes)
+{
+    VertexLayout& layout = vertexLayouts[name];
+    layout.binding = binding;
+    layout.attributes = attributes;
+    layout.hash = hashBytes(hashValue(HashSeed, binding), attributes.data(), attributes.size() * sizeof(vk::VertexInputAttributeDescription));
+}
+
+vk::Pipeline PipelineManager::setFallback(const PipelineDesc& desc)
+{
+    Entry& entry = findOrQueue(desc);
+    entry.requested = true;
+    wait(entry);
+    if (entry.state != EntryState::eReady)
+    {
+        ANUBIS_LOG_ERROR("Failed to create fallback pipeline for shader: {}", desc.shader);
+        throw std::runtime_error("Failed to create fallback pipeline!");
+    }
+    fallbacks[getPassKey(desc)] = &entry;
+    return *entry.pipeline;
+}
+
+vk::Pipeline PipelineManager::request(const PipelineDesc& desc)
+{
+    Entry& entry = findOrQueue(desc);
+    entry.requested = true;
+    if (entry.state.load(std::memory_order_acquire) == EntryState::eReady)
+    {
+        return *entry.pipeline;
+    }
+
+    const auto fallback = fallbacks.find(getPassKey(desc));
+    if (fallback != fallbacks.end())
+    {
+        // compiling, or failed to (logged by the compile)
+        fallbacksHandedOut++;
+        return *fallback->second->pipeline;
+    }
+    // nothing to stand in for it, this is a hitch
+    blockingCompiles++;
+    wait(entry);
+    if (entry.state != EntryState::eReady)
+    {
+        ANUBIS_LOG_ERROR("Failed to create pipeline for shader: {}", desc.shader);
+        throw std::runtime_error("Failed to create pipeline!");
+    }
+    return *entry.pipeline;
+}
+
+void PipelineManager::prewarm()
+{
+    std::ifstream file(listPath);
+    if (!file.is_open())
+    {
+        ANUBIS_LOG_INFO("No pipeline permutation list at {}, nothing to prewarm", listPath);
+        return;
+    }
+
+    uint32_t queued = 0;
+    uint32_t skipped = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        PipelineDesc desc;
+        uint32_t colorFormat, depthFormat, samples, blend, depthCompare, cullMode, frontFace;
+        if (!(fields >> desc.shader >> desc.vertexLayout >> colorFormat >> depthFormat >> samples >> desc.minSampleShading >> blend
+            >> desc.depthTest >> desc.depthWrite >> depthCompare >> cullMode >> frontFace))
+        {
+            skipped++;
+            continue;
+        }
+        desc.colorFormat = static_cast<vk::Format>(colorFormat);
+        desc.depthFormat = static_cast<vk::Format>(depthFormat);
+        desc.samples = static_cast<vk::SampleCountFlagBits>(samples);
+        desc.blend = static_cast<BlendMode>(blend);
+        desc.depthCompare = static_cast<vk::CompareOp>(depthCompare);
+        desc.cullMode = static_cast<vk::CullModeFlags>(cullMode);
+        desc.frontFace = static_cast<vk::FrontFace>(frontFace);
+        // shaders and layouts that went away since
+        if (!shaders.contains(desc.shader) || !vertexLayouts.contains(desc.vertexLayout))
+        {
+            skipped++;
+            continue;
+        }
+        const size_t before = entries.size();
+        findOrQueue(desc);
+        queued += entries.size() > before ? 1 : 0;
+    }
+    ANUBIS_LOG_INFO("Prewarming {} pipeline permutation(s) from {}, {} skipped", queued, listPath, skipped);
+}
+
+uint64_t PipelineManager::getKey(const PipelineDesc& desc) const
+{
+    const auto shader = shaders.find(desc.shader);
+    const auto layout = vertexLayouts.find(desc.vertexLayout);
+    if (shader == shaders.end() || layout == vertexLayouts.end())
+    {
+        ANUBIS_LOG_ERROR("Pipeline with unregistered shader or vertex layout: {} / {}", desc.shader, desc.vertexLayout);
+        throw std::runtime_error("Pipeline with unregistered shader or vertex layout!");
+    }
+    uint64_t hash = hashValue(HashSeed, shader->second.hash);
+    hash = hashValue(hash, layout->second.hash);
+    hash = hashValue(hash, getPassKey(desc));
+    hash = hashValue(hash, desc.minSampleShading);
+    hash = hashValue(hash, desc.blend);
+    hash = hashValue(hash, desc.depthTest);
+    hash = hashValue(hash, desc.depthWrite);
+    hash = hashValue(hash, desc.depthCompare);
+    hash = hashValue(hash, static_cast<uint32_t>(desc.cullMode));
+    return hashValue(hash, desc.frontFace);
+}
+
+void PipelineManager::logStatistics() const
+{
+    ANUBIS_LOG_INFO("Pipeline permutations: {}, {} compiled in the background, {} blocking, fallback bound {} time(s)", entries.size(),
+        asyncCompiles, blockingCompiles, fallbacksHandedOut);
+}
+
+PipelineManager::Entry& PipelineManager::findOrQueue(const PipelineDesc& desc)
+{
+    const uint64_t key = getKey(desc);
+    const auto found = entries.find(key);
+    if (found != entries.end())
+    {
+        if (found->second->desc != desc)
+        {
+            ANUBIS_LOG_ERROR("Pipeline key collision for shader: {}", desc.shader);
+            throw std::runtime_error("Pipeline key collision!");
+        }
+        return *found->second;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->desc = desc;
+    Entry& queued = *entry;
+    entries.emplace(key, std::move(entry));
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back(&queued);
+    }
+    wake.notify_one();
+    asyncCompiles++;
+    return queued;
+}
+
+void PipelineManager::wait(const Entry& entry)
+{
+    std::unique_lock lock(mutex);
+    // not picked up yet: compiled here instead of waiting for a thread to get to it
+    const auto queued = std::ranges::find(queue, &entry);
+    if (queued != queue.end())
+    {
+        Entry* claimed = *queued;
+        queue.erase(queued);
+        asyncCompiles--;
+        lock.unlock();
+        compile(*claimed);
+        return;
+    }
+    compiled.wait(lock, [&entry] { return entry.state.load(std::memory_order_acquire) != EntryState::eQueued; });
+}
+
+void PipelineManager::compile(Entry& entry)
+{
+    const PipelineDesc& desc = entry.desc;
+    const Shader& shader = shaders.at(desc.shader);
+    const VertexLayout& layout = vertexLayouts.at(desc.vertexLayout);
+
+    const std::array shaderStages = {
+        vk::PipelineShaderStageCreateInfo{
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = shader.module,
+            .pName = shader.vertexEntry.c_str()
+        },
+        vk::PipelineShaderStageCreateInfo{
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = shader.module,
+            .pName = shader.fragmentEntry.c_str()
+        }
+    };
+    const vk::PipelineVertexInputStateCreateInfo vertexInputInfo
+    {
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &layout.binding,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(layout.attributes.size()),
+        .pVertexAttributeDescriptions = layout.attributes.data()
+    };
+    const vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo
+    {
+        .topology = vk::PrimitiveTopology::eTriangleList,
+        .primitiveRestartEnable = false
+    };
+    // the actual viewport and scissor are set at draw time
+    const vk::PipelineViewportStateCreateInfo viewportStateInfo
+    {
+        .viewportCount = 1,
+        .scissorCount = 1
+    };
+    const vk::PipelineRasterizationStateCreateInfo rasterizerInfo
+    {
+        .depthClampEnable = false,
+        .rasterizerDiscardEnable = false,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = desc.cullMode,
+        .frontFace = desc.frontFace,
+        .depthBiasEnable = false,
+        .depthBiasSlopeFactor = 1.0f,
+        .lineWidth = 1.0f
+    };
+    const vk::PipelineMultisampleStateCreateInfo multisamplingInfo
+    {
+        .rasterizationSamples = desc.samples,
+        .sampleShadingEnable = desc.minSampleShading > 0.0f,
+        .minSampleShading = desc.minSampleShading
+    };
+    const vk::PipelineDepthStencilStateCreateInfo depthStencilInfo
+    {
+        .depthTestEnable = desc.depthTest,
+        .depthWriteEnable = desc.depthWrite,
+        .depthCompareOp = desc.depthCompare,
+        .depthBoundsTestEnable = vk::False,
+        .stencilTestEnable = vk::False
+    };
+    const vk::PipelineColorBlendAttachmentState colorBlendAttachment = getBlendState(desc.blend);
+    const vk::PipelineColorBlendStateCreateInfo colorBlendInfo
+    {
+        .logicOpEnable = false,
+        .logicOp = vk::LogicOp::eCopy,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    const std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    const vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo
+    {
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+    // dynamic rendering, no render pass
+    const vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo
+    {
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &desc.colorFormat,
+        .depthAttachmentFormat = desc.depthFormat
+    };
+
+    EntryState state = EntryState::eReady;
+    try
+    {
+        entry.pipeline = pipelineCache->createGraphicsPipeline(vk::GraphicsPipelineCreateInfo{
+            .pNext = &pipelineRenderingCreateInfo,
+            .stageCount = static_cast<uint32_t>(shaderStages.size()),
+            .pStages = shaderStages.data(),
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssemblyInfo,
+            .pViewportState = &viewportStateInfo,
+            .pRasterizationState = &rasterizerInfo,
+            .pMultisampleState = &multisamplingInfo,
+            .pDepthStencilState = &depthStencilInfo,
+            .pColorBlendState = &colorBlendInfo,
+            .pDynamicState = &dynamicStateCreateInfo,
+            .layout = pipelineLayout,
+            .basePipelineIndex = -1
+        });
+    }
+    catch (const vk::SystemError& error)
+    {
+        // the fallback stays in its place
+        ANUBIS_LOG_ERROR("Failed to compile pipeline for shader {}: {}", desc.shader, error.what());
+        state = EntryState::eFailed;
+    }
+
+    // under the lock, wait can't miss it
+    {
+        std::lock_guard lock(mutex);
+        entry.state.store(state, std::memory_order_release);
+    }
+    compiled.notify_all();
+}
+
+void PipelineManager::compileMain()
+{
+    while (true)
+    {
+        Entry* entry = nullptr;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            entry = queue.front();
+            queue.pop_front();
+        }
+        compile(*entry);
+    }
+}
+
+void PipelineManager::stopThreads()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+uint64_t PipelineManager::getPassKey(const PipelineDesc& desc)
+{
+    uint64_t hash = hashValue(HashSeed, desc.colorFormat);
+    hash = hashValue(hash, desc.depthFormat);
+    return hashValue(hash, desc.samples);
+}
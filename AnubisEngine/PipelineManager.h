@@ -0,0 +1,155 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineCache.h"
+
+enum class BlendMode : uint32_t
+{
+    eOpaque,
+    // src alpha over what's there
+    eAlpha,
+    eAdditive
+};
+
+// everything a graphics pipeline permutation is built from. shader and vertexLayout name what was registered with the
+// manager, the rest is fixed function state. viewport and scissor are dynamic, they aren't part of it
+struct PipelineDesc
+{
+    std::string shader;
+    std::string vertexLayout;
+    // has to match the rendering it's bound in
+    vk::Format colorFormat = vk::Format::eUndefined;
+    vk::Format depthFormat = vk::Format::eUndefined;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    // 0 = no sample shading
+    float minSampleShading = 0.0f;
+    BlendMode blend = BlendMode::eOpaque;
+    bool depthTest = true;
+    bool depthWrite = true;
+    vk::CompareOp depthCompare = vk::CompareOp::eLess;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+
+    bool operator==(const PipelineDesc&) const = default;
+};
+
+// graphics pipelines by a hash of their PipelineDesc (+ the shader's SPIR-V and the vertex layout), compiled on demand.
+// request never blocks: a permutation that isn't there yet is queued for the compile threads and the fallback of its
+// pass (same attachment formats and samples, so it can be bound in the same rendering) is handed out until it's done.
+// every permutation requested in a session is written to a list on clear, the next start up queues the whole list
+// right away (prewarm) - with the PipelineCache warm as well, a permutation is usually ready before it's first needed.
+// all pipelines share one layout (the engine's)
+//
+//  setFallback(desc)    compiled now, stands in for everything of its pass
+//  request(desc)        the pipeline, or the fallback while it compiles
+class PipelineManager
+{
+public:
+    static constexpr uint32_t DefaultCompileThreads = 2;
+    static constexpr const char* DefaultListPath = "pipeline_list.txt";
+
+    PipelineManager() = default;
+    // the compile threads stop even without clear
+    ~PipelineManager();
+    PipelineManager(const PipelineManager&) = delete;
+    PipelineManager& operator=(const PipelineManager&) = delete;
+
+    void init(const vk::raii::Device& logicalDevice, PipelineCache& cache, vk::PipelineLayout layout,
+        const std::string& listPath = DefaultListPath, uint32_t compileThreads = DefaultCompileThreads);
+    // waits for the compiles in progress, saves the list of requested permutations (prewarmed ones nobody asked for are
+    // dropped from it), destroys every pipeline.
+    // nothing may still use them
+    void clear();
+    [[nodiscard]] bool isInitialized() const { return device != nullptr; }
+
+    // before the first request, the compile threads read these without a lock.
+    // entry points of the vertex and fragment stage in one module
+    void registerShader(const std::string& name, const std::vector<char>& spirv, const std::string& vertexEntry, const std::string& fragmentEntry);
+    void registerVertexLayout(const std::string& name, const vk::VertexInputBindingDescription& binding,
+        const std::vector<vk::VertexInputAttributeDescription>& attributes);
+
+    // compiled on the calling thread if it isn't ready yet, then the fallback for every permutation with the same pass
+    vk::Pipeline setFallback(const PipelineDesc& desc);
+    // main thread. without a fallback for the pass the permutation is compiled right here
+    [[nodiscard]] vk::Pipeline request(const PipelineDesc& desc);
+    // queues every permutation of the saved list whose shader and vertex layout are registered
+    void prewarm();
+
+    [[nodiscard]] uint64_t getKey(const PipelineDesc& desc) const;
+    void logStatistics() const;
+
+private:
+    enum class EntryState : uint32_t
+    {
+        eQueued,
+        eReady,
+        eFailed
+    };
+    // address stable, the compile threads hold on to it
+    struct Entry
+    {
+        PipelineDesc desc;
+        std::atomic<EntryState> state = EntryState::eQueued;
+        vk::raii::Pipeline pipeline = nullptr;
+        // went through request or setFallback this session, only these are saved to the list
+        bool requested = false;
+    };
+    struct Shader
+    {
+        vk::raii::ShaderModule module = nullptr;
+        std::string vertexEntry;
+        std::string fragmentEntry;
+        uint64_t hash = 0;
+    };
+    struct VertexLayout
+    {
+        vk::VertexInputBindingDescription binding;
+        std::vector<vk::VertexInputAttributeDescription> attributes;
+        uint64_t hash = 0;
+    };
+
+    // the entry of desc, queued when new
+    Entry& findOrQueue(const PipelineDesc& desc);
+    // compiled here if no thread picked it up yet, otherwise blocks until that thread is done
+    void wait(const Entry& entry);
+    void compile(Entry& entry);
+    void compileMain();
+    // drops the queue, the compiles in progress finish
+    void stopThreads();
+    // formats + samples
+    [[nodiscard]] static uint64_t getPassKey(const PipelineDesc& desc);
+
+    const vk::raii::Device* device = nullptr;
+    PipelineCache* pipelineCache = nullptr;
+    vk::PipelineLayout pipelineLayout;
+    std::string listPath;
+
+    std::unordered_map<std::string, Shader> shaders;
+    std::unordered_map<std::string, VertexLayout> vertexLayouts;
+    // only touched by the main thread
+    std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+    std::unordered_map<uint64_t, Entry*> fallbacks;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable compiled;
+    std::deque<Entry*> queue;
+    bool stopping = false;
+
+    uint32_t asyncCompiles = 0;
+    uint32_t blockingCompiles = 0;
+    uint64_t fallbacksHandedOut = 0;
+};
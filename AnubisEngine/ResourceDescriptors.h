@@ -7,12 +7,43 @@
 // nested struct must be aligned by the base alignment of its members (rounded to multiple of 16)
 // float4x4 - 16 bytes
 
-// UniformBufferObject - defines: model, view, and project matrices
+// UniformBufferObject - defines: view and project matrices, once per frame
+//  sceneRotation: every object's spin this frame, per object draws apply it in the shader (their transform is pushed)
 struct UniformBufferObject
 {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::mat4 sceneRotation;
+};
+
+// InstanceData - one drawn copy of a mesh, read by the vertex shader from a storage buffer (std430) by instance index
+//  model used to live in the UBO, one dynamic slice + descriptor bind per object
+struct InstanceData
+{
+    alignas(16) glm::mat4 model;
+    uint32_t materialIndex;
+    uint32_t padding[3];
+};
+
+// MaterialData - one material, read by the fragment shader out of the bindless material table by material index
+//  the indices are bindless slots (see BindlessDescriptors.h)
+struct MaterialData
+{
+    uint32_t textureIndex;
+    uint32_t samplerIndex;
+    uint32_t padding[2];
+};
+// the material table is the first storage buffer of the bindless set, the shaders expect it there
+constexpr uint32_t MaterialTableSlot = 0;
+
+// DrawConstants - push constants, set per draw with vkCmdPushConstants (in the command buffer, no buffer or descriptor)
+//  per object draws: the object's transform + material, instanced/gpu driven draws: instanced = 1 and the model
+//  comes from the instance array instead. 72 bytes used, well under the guaranteed 128
+struct DrawConstants
+{
+    alignas(16) glm::mat4 model;
+    uint32_t materialIndex;
+    uint32_t instanced;
 };
 
 // tut covered combined image samplers
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// something in the scene that gets drawn every frame
+struct RenderObject
+{
+    uint32_t meshId = 0;            // id in the geometry pool's mesh table
+    glm::mat4 transform{1.0f};      // placement in the world
+    uint32_t materialIndex = 0;     // handed to the shader with the transform
+};
+
+// a run of render objects sharing a mesh, drawn with one instanced drawIndexed.
+// the objects are sorted by mesh, so the frame's visible objects (in order) are runs of the same mesh too
+struct InstanceBatch
+{
+    uint32_t meshId = 0;
+    uint32_t firstInstance = 0;
+    uint32_t instanceCount = 0;
+};
+
+// the six frustum planes (xyz normal pointing inside, w distance) of a view-projection matrix with [0, 1] depth,
+// normalized so a point's signed distance is dot(plane.xyz, p) + plane.w. order: left, right, bottom, top, near, far
+inline std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4& viewProjection)
+{
+    // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const auto row = [&viewProjection](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+    std::array<glm::vec4, 6> planes{
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2)
+    };
+    for (glm::vec4& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
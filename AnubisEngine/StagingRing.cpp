@@ -0,0 +1,506 @@
+#include "StagingRing.h"
+
+#include <cstring>
+#include <numeric>
+
+#include "helpers.h"
+#include "Logger.h"
+
+namespace
+{
+    vk::raii::Semaphore createTimeline(const vk::raii::Device& logicalDevice)
+    {
+        vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> semaphoreChain
+        {
+            {},
+            {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}
+        };
+        return vk::raii::Semaphore(logicalDevice, semaphoreChain.get<vk::SemaphoreCreateInfo>());
+    }
+
+    vk::raii::CommandPool createPool(const vk::raii::Device& logicalDevice, uint32_t queueFamilyIndex)
+    {
+        vk::CommandPoolCreateInfo commandPoolCreateInfo
+        {
+            // short lived, reset every time a submission is recycled
+            .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = queueFamilyIndex
+        };
+        return vk::raii::CommandPool(logicalDevice, commandPoolCreateInfo);
+    }
+
+    vk::raii::CommandBuffer allocateCommandBuffer(const vk::raii::Device& logicalDevice, const vk::raii::CommandPool& pool)
+    {
+        vk::CommandBufferAllocateInfo allocInfo
+        {
+            .commandPool = pool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        return std::move(logicalDevice.allocateCommandBuffers(allocInfo).front());
+    }
+
+    // make the writes visible to whatever is submitted to the queue afterwards
+    // (geometry reads, layout transitions, mip blits)
+    void recordVisibilityBarrier(const vk::raii::CommandBuffer& commandBuffer)
+    {
+        vk::MemoryBarrier2 barrier
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite
+        };
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    }
+}
+
+void StagingRing::init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator,
+    uint32_t copyQueueFamilyIndex, const vk::raii::Queue& copyQueueRef,
+    uint32_t ownerQueueFamilyIndex, const vk::raii::Queue& ownerQueueRef,
+    vk::DeviceSize ringCapacity)
+{
+    Logger::printToConsole("***** Creating Staging Ring *****");
+    device = &logicalDevice;
+    copyQueue = &copyQueueRef;
+    ownerQueue = &ownerQueueRef;
+    copyFamily = copyQueueFamilyIndex;
+    ownerFamily = ownerQueueFamilyIndex;
+    capacity = ringCapacity;
+    chunkSize = capacity / 4;
+
+    // only ever written by the CPU and read once by a copy
+    helpers::createBuffer(capacity, vk::BufferUsageFlagBits::eTransferSrc,
+        MemoryPlacements::Upload,
+        buffer, bufferMemory,
+        logicalDevice, allocator, AllocationStrategy::eFreeList, MemoryCategory::eStaging);
+
+    commandPool = createPool(logicalDevice, copyFamily);
+    copyTimeline = createTimeline(logicalDevice);
+    if (usesSeparateQueue())
+    {
+        ownerCommandPool = createPool(logicalDevice, ownerFamily);
+        ownerTimeline = createTimeline(logicalDevice);
+    }
+
+    head = 0;
+    tail = 0;
+    submittedSerial = 0;
+    completedSerial = 0;
+    uploadedBytes = 0;
+    submissionCount = 0;
+    busyMs = 0.0;
+
+    ANUBIS_LOG_INFO("Capacity: {} bytes", capacity);
+    ANUBIS_LOG_INFO("Chunk Size: {} bytes", chunkSize);
+    ANUBIS_LOG_INFO("Copy Queue Family: {} ({})", copyFamily, usesSeparateQueue() ? "dedicated transfer" : "shared with graphics");
+    ANUBIS_LOG_INFO("Memory Type: {} {}", bufferMemory.getMemoryTypeIndex(),
+        vk::to_string(allocator.getMemoryTypeFlags(bufferMemory.getMemoryTypeIndex())));
+    Logger::printToConsole("*************************");
+}
+
+void StagingRing::clear()
+{
+    if (device && !isIdle())
+    {
+        finish();
+    }
+
+    // command buffers go back to their pools before the pools go
+    current.reset();
+    inFlight.clear();
+    freeSubmissions.clear();
+    commandPool.clear();
+    commandPool = nullptr;
+    ownerCommandPool.clear();
+    ownerCommandPool = nullptr;
+    copyTimeline.clear();
+    copyTimeline = nullptr;
+    ownerTimeline.clear();
+    ownerTimeline = nullptr;
+
+    buffer.clear();
+    buffer = nullptr;
+    bufferMemory.clear();
+    bufferMemory = nullptr;
+    device = nullptr;
+    copyQueue = nullptr;
+    ownerQueue = nullptr;
+}
+
+void StagingRing::uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset)
+{
+    const auto* src = static_cast<const char*>(data);
+    for (vk::DeviceSize done = 0; done < size;)
+    {
+        const vk::DeviceSize bytes = std::min(size - done, chunkSize);
+        // allocate first, it may submit the current command buffer to make room
+        const vk::DeviceSize offset = allocate(bytes, 16);
+        memcpy(static_cast<char*>(bufferMemory.getMappedData()) + offset, src + done, bytes);
+
+        recording().copyBuffer(*buffer, dstBuffer, {vk::BufferCopy{.srcOffset = offset, .dstOffset = dstOffset + done, .size = bytes}});
+        uploadedBytes += bytes;
+        done += bytes;
+    }
+    // pieces flushed earlier are ordered before this one on the copy queue, only the last submission hands it over
+    releaseBuffer(dstBuffer, dstOffset, size);
+}
+
+void StagingRing::uploadImage(const void* data, vk::Image dstImage, uint32_t width, uint32_t height, uint32_t texelSize, uint32_t mipLevel)
+{
+    const auto* src = static_cast<const char*>(data);
+    const vk::DeviceSize rowBytes = static_cast<vk::DeviceSize>(width) * texelSize;
+    const auto rowsPerChunk = static_cast<uint32_t>(std::max<vk::DeviceSize>(chunkSize / rowBytes, 1));
+    // bufferOffset has to be a multiple of the texel size and of 4
+    const vk::DeviceSize alignment = std::lcm<vk::DeviceSize>(texelSize, 4);
+
+    for (uint32_t row = 0; row < height;)
+    {
+        const uint32_t rows = std::min(rowsPerChunk, height - row);
+        const vk::DeviceSize bytes = rows * rowBytes;
+        const vk::DeviceSize offset = allocate(bytes, alignment);
+        memcpy(static_cast<char*>(bufferMemory.getMappedData()) + offset, src + row * rowBytes, bytes);
+
+        vk::BufferImageCopy region
+        {
+            .bufferOffset = offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1},
+            .imageOffset = {0, static_cast<int32_t>(row), 0},
+            .imageExtent = {width, rows, 1}
+        };
+        recording().copyBufferToImage(*buffer, dstImage, vk::ImageLayout::eTransferDstOptimal, {region});
+        uploadedBytes += bytes;
+        row += rows;
+    }
+    releaseImage(dstImage, mipLevel);
+}
+
+void StagingRing::releaseBuffer(vk::Buffer dstBuffer, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    if (!usesSeparateQueue())
+    {
+        return;
+    }
+
+    // release on the copy queue, acquire on the owner queue. both halves have to match
+    vk::BufferMemoryBarrier2 release
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .srcQueueFamilyIndex = copyFamily,
+        .dstQueueFamilyIndex = ownerFamily,
+        .buffer = dstBuffer,
+        .offset = offset,
+        .size = size
+    };
+    recording();
+    current->bufferReleases.push_back(release);
+
+    vk::BufferMemoryBarrier2 acquire = release;
+    acquire.srcStageMask = vk::PipelineStageFlagBits2::eNone;
+    acquire.srcAccessMask = {};
+    acquire.dstStageMask = vk::PipelineStageFlagBits2::eAllCommands;
+    acquire.dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite;
+    recordingOwner().pipelineBarrier2(vk::DependencyInfo{.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &acquire});
+}
+
+void StagingRing::releaseImage(vk::Image dstImage, uint32_t mipLevel)
+{
+    if (!usesSeparateQueue())
+    {
+        return;
+    }
+
+    // the layout stays TRANSFER_DST_OPTIMAL, the owner side transitions it when it's done with it.
+    // only the written level changes hands - levels the copy queue never wrote hold nothing worth keeping
+    vk::ImageMemoryBarrier2 release
+    {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = copyFamily,
+        .dstQueueFamilyIndex = ownerFamily,
+        .image = dstImage,
+        .subresourceRange = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, mipLevel, 1, 0, 1}
+    };
+    recording();
+    current->imageReleases.push_back(release);
+
+    vk::ImageMemoryBarrier2 acquire = release;
+    acquire.srcStageMask = vk::PipelineStageFlagBits2::eNone;
+    acquire.srcAccessMask = {};
+    acquire.dstStageMask = vk::PipelineStageFlagBits2::eAllCommands;
+    acquire.dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite;
+    recordingOwner().pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &acquire});
+}
+
+uint64_t StagingRing::flush()
+{
+    if (!current)
+    {
+        return submittedSerial;
+    }
+
+    current->serial = ++submittedSerial;
+    current->end = head;
+
+    if (!current->bufferReleases.empty() || !current->imageReleases.empty())
+    {
+        vk::DependencyInfo releaseInfo
+        {
+            .bufferMemoryBarrierCount = static_cast<uint32_t>(current->bufferReleases.size()),
+            .pBufferMemoryBarriers = current->bufferReleases.data(),
+            .imageMemoryBarrierCount = static_cast<uint32_t>(current->imageReleases.size()),
+            .pImageMemoryBarriers = current->imageReleases.data()
+        };
+        current->commandBuffer.pipelineBarrier2(releaseInfo);
+    }
+    recordVisibilityBarrier(current->commandBuffer);
+    current->commandBuffer.end();
+
+    vk::CommandBufferSubmitInfo commandBufferInfo{.commandBuffer = current->commandBuffer};
+    vk::SemaphoreSubmitInfo signalInfo
+    {
+        .semaphore = copyTimeline,
+        .value = current->serial,
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+    };
+    copyQueue->submit2(vk::SubmitInfo2
+    {
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &commandBufferInfo,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signalInfo
+    });
+
+    if (current->ownerRecording)
+    {
+        recordVisibilityBarrier(current->ownerCommandBuffer);
+        current->ownerCommandBuffer.end();
+    }
+    // with a single family the copy's signal already completes the submission
+    current->ownerSubmitted = !usesSeparateQueue();
+
+    inFlight.push_back(std::move(*current));
+    current.reset();
+    submissionCount++;
+    return submittedSerial;
+}
+
+void StagingRing::finish()
+{
+    flush();
+    while (!inFlight.empty())
+    {
+        waitOldest();
+    }
+}
+
+void StagingRing::retire()
+{
+    submitOwnerWork(0);
+    while (!inFlight.empty() && completionTimeline().getCounterValue() >= inFlight.front().serial)
+    {
+        waitOldest();
+    }
+}
+
+bool StagingRing::isComplete(uint64_t serial)
+{
+    retire();
+    return completedSerial >= serial;
+}
+
+void StagingRing::wait(uint64_t serial)
+{
+    if (serial > submittedSerial)
+    {
+        flush();
+    }
+    while (completedSerial < serial && !inFlight.empty())
+    {
+        waitOldest();
+    }
+}
+
+void StagingRing::submitOwnerWork(uint64_t forceSerial)
+{
+    if (!usesSeparateQueue())
+    {
+        return;
+    }
+
+    const uint64_t copiedSerial = copyTimeline.getCounterValue();
+    for (Submission& submission : inFlight)
+    {
+        if (submission.ownerSubmitted)
+        {
+            continue;
+        }
+        // owner submissions have to go out in order, stop at the first one that isn't ready yet
+        if (submission.serial > copiedSerial && submission.serial > forceSerial)
+        {
+            break;
+        }
+
+        // the wait is already satisfied unless forced, the graphics queue doesn't stall on the copy
+        vk::SemaphoreSubmitInfo waitInfo
+        {
+            .semaphore = copyTimeline,
+            .value = submission.serial,
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        };
+        vk::SemaphoreSubmitInfo signalInfo
+        {
+            .semaphore = ownerTimeline,
+            .value = submission.serial,
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        };
+        vk::CommandBufferSubmitInfo commandBufferInfo{.commandBuffer = submission.ownerCommandBuffer};
+        ownerQueue->submit2(vk::SubmitInfo2
+        {
+            .waitSemaphoreInfoCount = 1,
+            .pWaitSemaphoreInfos = &waitInfo,
+            // nothing was uploaded that needs acquiring: just keep the owner timeline in step
+            .commandBufferInfoCount = submission.ownerRecording ? 1u : 0u,
+            .pCommandBufferInfos = submission.ownerRecording ? &commandBufferInfo : nullptr,
+            .signalSemaphoreInfoCount = 1,
+            .pSignalSemaphoreInfos = &signalInfo
+        });
+        submission.ownerSubmitted = true;
+    }
+}
+
+vk::DeviceSize StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    if (size > capacity)
+    {
+        ANUBIS_LOG_ERROR("Staging ring upload piece is larger than the ring! requested: {} capacity: {}", size, capacity);
+        throw std::runtime_error("Staging ring upload piece is larger than the ring!");
+    }
+
+    for (;;)
+    {
+        // never split a piece across the end of the buffer, skip to the start instead
+        const vk::DeviceSize physical = head % capacity;
+        vk::DeviceSize aligned = (physical + alignment - 1) / alignment * alignment;
+        uint64_t start = head - physical + aligned;
+        if (aligned + size > capacity)
+        {
+            aligned = 0;
+            start = head - physical + capacity;
+        }
+
+        if (start + size - tail <= capacity)
+        {
+            head = start + size;
+            return aligned;
+        }
+
+        // full: free the oldest submission, or submit what is recorded so there is something to wait on
+        if (!inFlight.empty())
+        {
+            waitOldest();
+        }
+        else if (current)
+        {
+            flush();
+        }
+        else
+        {
+            // nothing is using the ring, start over at the beginning of the buffer
+            head = (head + capacity - 1) / capacity * capacity;
+            tail = head;
+        }
+    }
+}
+
+vk::raii::CommandBuffer& StagingRing::recording()
+{
+    if (!current)
+    {
+        if (isIdle())
+        {
+            busyStart = std::chrono::high_resolution_clock::now();
+        }
+
+        if (!freeSubmissions.empty())
+        {
+            current.emplace(std::move(freeSubmissions.back()));
+            freeSubmissions.pop_back();
+        }
+        else
+        {
+            current.emplace(Submission{.commandBuffer = allocateCommandBuffer(*device, commandPool)});
+        }
+
+        current->ownerRecording = false;
+        current->ownerSubmitted = false;
+        current->bufferReleases.clear();
+        current->imageReleases.clear();
+        current->commandBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    }
+    return current->commandBuffer;
+}
+
+vk::raii::CommandBuffer& StagingRing::recordingOwner()
+{
+    if (!usesSeparateQueue())
+    {
+        return recording();
+    }
+
+    recording();
+    if (!current->ownerRecording)
+    {
+        if (!*current->ownerCommandBuffer)
+        {
+            current->ownerCommandBuffer = allocateCommandBuffer(*device, ownerCommandPool);
+        }
+        current->ownerCommandBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        current->ownerRecording = true;
+    }
+    return current->ownerCommandBuffer;
+}
+
+void StagingRing::waitOldest()
+{
+    Submission& oldest = inFlight.front();
+    // the owner half may not have gone out yet
+    submitOwnerWork(oldest.serial);
+
+    const vk::Semaphore timeline = *completionTimeline();
+    vk::SemaphoreWaitInfo waitInfo
+    {
+        .semaphoreCount = 1,
+        .pSemaphores = &timeline,
+        .pValues = &oldest.serial
+    };
+    while (vk::Result::eTimeout == device->waitSemaphores(waitInfo, UINT64_MAX));
+
+    // everything up to this submission's head can be written again
+    tail = oldest.end;
+    completedSerial = oldest.serial;
+    freeSubmissions.push_back(std::move(oldest));
+    inFlight.pop_front();
+
+    if (isIdle())
+    {
+        busyMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - busyStart).count();
+    }
+}
+
+void StagingRing::logStatistics() const
+{
+    Logger::printToConsole("***** Staging Ring Statistics *****");
+    ANUBIS_LOG_INFO("Uploaded: {} bytes in {} submissions", uploadedBytes, submissionCount);
+    if (busyMs > 0.0)
+    {
+        const double megabytes = static_cast<double>(uploadedBytes) / (1024.0 * 1024.0);
+        ANUBIS_LOG_INFO("Busy: {:.3f} ms, {:.1f} MB/s", busyMs, megabytes / (busyMs / 1000.0));
+    }
+    Logger::printToConsole("*************************");
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// one persistently mapped upload buffer used as a ring for every host -> device copy.
+// uploads are memcpy'd in at the head and the copies recorded into a reused command buffer,
+// flush() submits them and signals a timeline semaphore. space is only handed back once that value is reached (retirement),
+// so the ring never reallocates - cold start and streaming stop churning staging allocations.
+// anything bigger than a chunk is streamed through in pieces, waiting on the oldest submission when the ring is full.
+//
+//  [ retired | in flight | recorded, not submitted | free ]
+//            ^tail                                 ^head
+//
+// copy queue != owner queue (a dedicated transfer family):
+//  the copies run on the transfer queue and end with a queue family release of everything written.
+//  the matching acquire (plus graphics only work like mip blits) is recorded into an owner command buffer
+//  that is submitted to the graphics queue once the copy's timeline value is reached - rendering never waits on a copy.
+//  with a single family both command buffers are the same one and no ownership changes hands.
+class StagingRing
+{
+public:
+    static constexpr vk::DeviceSize DefaultCapacity = 32ull * 1024 * 1024;
+
+    // copyQueue runs the copies, ownerQueue is where the uploaded resources get used. may be the same family/queue
+    void init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator,
+        uint32_t copyQueueFamilyIndex, const vk::raii::Queue& copyQueue,
+        uint32_t ownerQueueFamilyIndex, const vk::raii::Queue& ownerQueue,
+        vk::DeviceSize capacity = DefaultCapacity);
+    void clear();
+
+    // copies are recorded, not executed. flush() (or running out of space) submits them
+    void uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset);
+    // the image has to be in TRANSFER_DST_OPTIMAL when the copies execute (and stays in it). streamed in bands of whole rows
+    void uploadImage(const void* data, vk::Image dstImage, uint32_t width, uint32_t height, uint32_t texelSize, uint32_t mipLevel = 0);
+
+    // the command buffer copies are currently recorded into, for barriers the copy queue can run (see UploadBatch)
+    vk::raii::CommandBuffer& recording();
+    // the command buffer that runs on the owner queue after this submission's uploads were acquired,
+    // for graphics only work on uploaded data (mip blits). same as recording() with a single queue family
+    vk::raii::CommandBuffer& recordingOwner();
+
+    // submit everything recorded so far. later submissions on the owner queue see the writes once the serial is complete.
+    // returns the submission's serial, uploads are complete once isComplete(serial)
+    uint64_t flush();
+    // flush and wait until every upload has landed
+    void finish();
+    // submits the owner work of copies that have finished and hands back the space of completed submissions, never blocks
+    void retire();
+    // submissions complete in order, so a serial also covers everything submitted before it
+    [[nodiscard]] bool isComplete(uint64_t serial);
+    void wait(uint64_t serial);
+
+    [[nodiscard]] vk::DeviceSize getCapacity() const { return capacity; }
+    [[nodiscard]] uint64_t getUploadedBytes() const { return uploadedBytes; }
+    [[nodiscard]] bool usesSeparateQueue() const { return copyFamily != ownerFamily; }
+    // upload throughput over the time the ring had work in it
+    void logStatistics() const;
+
+private:
+    struct Submission
+    {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        // owner queue side, only allocated with a separate copy queue
+        vk::raii::CommandBuffer ownerCommandBuffer = nullptr;
+        bool ownerRecording = false;
+        bool ownerSubmitted = false;
+        // queue family releases recorded at the end of the copy command buffer
+        std::vector<vk::BufferMemoryBarrier2> bufferReleases;
+        std::vector<vk::ImageMemoryBarrier2> imageReleases;
+        // ring head when this submission was made, its space is free once the serial is complete
+        uint64_t end = 0;
+        uint64_t serial = 0;
+    };
+
+    // reserves size bytes at the head, blocking on retirement when the ring is full
+    vk::DeviceSize allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+    // hands a written range over to the owner queue family (no-op with a single family)
+    void releaseBuffer(vk::Buffer dstBuffer, vk::DeviceSize offset, vk::DeviceSize size);
+    void releaseImage(vk::Image dstImage, uint32_t mipLevel);
+    // submits pending owner work in order, forcing it up to (and including) forceSerial
+    void submitOwnerWork(uint64_t forceSerial);
+    void waitOldest();
+    [[nodiscard]] const vk::raii::Semaphore& completionTimeline() const { return usesSeparateQueue() ? ownerTimeline : copyTimeline; }
+    [[nodiscard]] bool isIdle() const { return inFlight.empty() && !current; }
+
+    const vk::raii::Device* device = nullptr;
+    const vk::raii::Queue* copyQueue = nullptr;
+    const vk::raii::Queue* ownerQueue = nullptr;
+    uint32_t copyFamily = 0;
+    uint32_t ownerFamily = 0;
+
+    vk::raii::Buffer buffer = nullptr;
+    MemoryAllocation bufferMemory = nullptr;
+    vk::DeviceSize capacity = 0;
+    // largest piece a single copy is split into, keeps a couple of chunks in flight while the next is written
+    vk::DeviceSize chunkSize = 0;
+
+    // monotonic byte positions, the physical offset is position % capacity
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+    // signaled with each submission's serial. copy side by the copy queue, owner side after the acquire ran
+    vk::raii::Semaphore copyTimeline = nullptr;
+    vk::raii::Semaphore ownerTimeline = nullptr;
+    uint64_t submittedSerial = 0;
+    uint64_t completedSerial = 0;
+
+    vk::raii::CommandPool commandPool = nullptr;
+    vk::raii::CommandPool ownerCommandPool = nullptr;
+    // finished submissions are recycled, their command buffers reused
+    std::vector<Submission> freeSubmissions;
+    std::deque<Submission> inFlight;
+    std::optional<Submission> current;
+
+    // statistics
+    uint64_t uploadedBytes = 0;
+    uint32_t submissionCount = 0;
+    double busyMs = 0.0;
+    std::chrono::high_resolution_clock::time_point busyStart;
+};
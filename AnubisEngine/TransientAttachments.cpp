@@ -0,0 +1,162 @@
+#include "TransientAttachments.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace
+{
+    // for "{:.2f} MiB"
+    double toMiB(vk::DeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+void TransientAttachmentPool::init(const vk::raii::Device& logicalDevice, MemoryAllocator& memoryAllocator)
+{
+    device = &logicalDevice;
+    allocator = &memoryAllocator;
+}
+
+void TransientAttachmentPool::clear()
+{
+    entries.clear();
+    for (auto& slot : slots)
+    {
+        slot.clear();
+        slot = nullptr;
+    }
+    slots.clear();
+    plan = {};
+}
+
+vk::ImageCreateInfo TransientAttachmentPool::makeCreateInfo(vk::Extent2D extent, vk::SampleCountFlagBits samples, const TransientAttachmentDesc& desc)
+{
+    return vk::ImageCreateInfo
+    {
+        .imageType = vk::ImageType::e2D,
+        .format = desc.format,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = samples,
+        .tiling = vk::ImageTiling::eOptimal,
+        // contents never leave the pass, lets the driver keep them on chip
+        .usage = desc.usage | vk::ImageUsageFlagBits::eTransientAttachment,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = 0,
+    };
+}
+
+void TransientAttachmentPool::add(vk::raii::Image& image, vk::Extent2D extent, vk::SampleCountFlagBits samples, const TransientAttachmentDesc& desc)
+{
+    image = vk::raii::Image(*device, makeCreateInfo(extent, samples, desc));
+    entries.push_back(Entry{.image = &image, .desc = desc, .requirements = image.getMemoryRequirements()});
+}
+
+TransientAttachmentPlan TransientAttachmentPool::assignSlots(std::vector<Entry>& entries)
+{
+    struct Slot
+    {
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        std::vector<const Entry*> members;
+    };
+    std::vector<Slot> slots;
+    TransientAttachmentPlan result;
+
+    for (Entry& entry : entries)
+    {
+        result.requestedBytes += entry.requirements.size;
+
+        auto fits = [&](const Slot& slot)
+        {
+            if (!(slot.memoryTypeBits & entry.requirements.memoryTypeBits))
+            {
+                return false;
+            }
+            return std::ranges::none_of(slot.members, [&](const Entry* member)
+            {
+                return member->desc.firstPass <= entry.desc.lastPass && entry.desc.firstPass <= member->desc.lastPass;
+            });
+        };
+        auto slot = std::ranges::find_if(slots, fits);
+        if (slot == slots.end())
+        {
+            slot = slots.emplace(slots.end());
+        }
+
+        slot->size = std::max(slot->size, entry.requirements.size);
+        slot->memoryTypeBits &= entry.requirements.memoryTypeBits;
+        slot->members.push_back(&entry);
+        entry.slot = static_cast<uint32_t>(slot - slots.begin());
+    }
+
+    for (const Slot& slot : slots)
+    {
+        result.aliasedBytes += slot.size;
+    }
+    result.slotCount = static_cast<uint32_t>(slots.size());
+    return result;
+}
+
+void TransientAttachmentPool::allocate()
+{
+    plan = assignSlots(entries);
+
+    std::vector<std::vector<vk::MemoryRequirements>> slotRequirements(plan.slotCount);
+    for (const Entry& entry : entries)
+    {
+        slotRequirements[entry.slot].push_back(entry.requirements);
+    }
+
+    slots.clear();
+    for (const auto& requirements : slotRequirements)
+    {
+        slots.push_back(allocator->allocateAliased(requirements, MemoryPlacements::Transient, MemoryCategory::eRenderTarget));
+    }
+
+    for (const Entry& entry : entries)
+    {
+        entry.image->bindMemory(slots[entry.slot].getMemory(), slots[entry.slot].getOffset());
+    }
+}
+
+bool TransientAttachmentPool::usesLazyMemory() const
+{
+    return !slots.empty() && (allocator->getMemoryTypeFlags(slots.front().getMemoryTypeIndex()) & vk::MemoryPropertyFlagBits::eLazilyAllocated);
+}
+
+TransientAttachmentPlan TransientAttachmentPool::planFor(const vk::raii::Device& logicalDevice, vk::Extent2D extent, vk::SampleCountFlagBits samples,
+    const std::vector<TransientAttachmentDesc>& descs)
+{
+    std::vector<Entry> planned;
+    for (const auto& desc : descs)
+    {
+        // no image needed to ask for the requirements
+        const vk::ImageCreateInfo createInfo = makeCreateInfo(extent, samples, desc);
+        const vk::MemoryRequirements2 requirements = logicalDevice.getImageMemoryRequirements(vk::DeviceImageMemoryRequirements{.pCreateInfo = &createInfo});
+        planned.push_back(Entry{.desc = desc, .requirements = requirements.memoryRequirements});
+    }
+    return assignSlots(planned);
+}
+
+void TransientAttachmentPool::logStatistics() const
+{
+    ANUBIS_LOG_INFO("Transient Attachments: {} in {} allocations", entries.size(), plan.slotCount);
+    ANUBIS_LOG_INFO("Requested: {:.2f} MiB, after aliasing: {:.2f} MiB", toMiB(plan.requestedBytes), toMiB(plan.aliasedBytes));
+    if (usesLazyMemory())
+    {
+        vk::DeviceSize committed = 0;
+        for (const auto& slot : slots)
+        {
+            committed += allocator->getCommitment(slot);
+        }
+        ANUBIS_LOG_INFO("Lazily allocated, committed right now: {:.2f} MiB", toMiB(committed));
+    }
+    else
+    {
+        Logger::printToConsole("No LAZILY_ALLOCATED memory type, attachments are fully backed", level::info);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// a render target that only lives inside render passes (resolved or thrown away at the end)
+struct TransientAttachmentDesc
+{
+    std::string name;
+    vk::Format format = vk::Format::eUndefined;
+    vk::ImageUsageFlags usage;
+    // passes the attachment holds live contents in. attachments whose ranges don't overlap share memory
+    uint32_t firstPass = 0;
+    uint32_t lastPass = 0;
+};
+
+// what a set of transient attachments costs, with and without aliasing
+struct TransientAttachmentPlan
+{
+    vk::DeviceSize requestedBytes = 0;  // every attachment with its own memory
+    vk::DeviceSize aliasedBytes = 0;    // after attachments with disjoint lifetimes share
+    uint32_t slotCount = 0;             // allocations after aliasing
+};
+
+// owns the memory behind the transient attachments (MSAA color, depth, ...).
+//  - TRANSIENT_ATTACHMENT usage + LAZILY_ALLOCATED memory when the device has it
+//  - attachments that are never live at the same time are bound to the same allocation (aliasing)
+// the images themselves stay with their owner, the pool only creates and binds them.
+class TransientAttachmentPool
+{
+public:
+    void init(const vk::raii::Device& logicalDevice, MemoryAllocator& allocator);
+    // frees the memory. call before (re)creating the attachments
+    void clear();
+
+    // creates the (still unbound) image into image
+    void add(vk::raii::Image& image, vk::Extent2D extent, vk::SampleCountFlagBits samples, const TransientAttachmentDesc& desc);
+    // assigns the alias slots, allocates them and binds every added image
+    void allocate();
+
+    [[nodiscard]] const TransientAttachmentPlan& getPlan() const { return plan; }
+    [[nodiscard]] bool usesLazyMemory() const;
+    // requested / aliased / committed bytes of the live attachments
+    void logStatistics() const;
+
+    // what the attachments would cost at another size/sample count, without creating anything
+    static TransientAttachmentPlan planFor(const vk::raii::Device& logicalDevice, vk::Extent2D extent, vk::SampleCountFlagBits samples,
+        const std::vector<TransientAttachmentDesc>& descs);
+
+private:
+    struct Entry
+    {
+        vk::raii::Image* image = nullptr;
+        TransientAttachmentDesc desc;
+        vk::MemoryRequirements requirements;
+        uint32_t slot = 0;
+    };
+
+    static vk::ImageCreateInfo makeCreateInfo(vk::Extent2D extent, vk::SampleCountFlagBits samples, const TransientAttachmentDesc& desc);
+    // greedy interval colouring: each entry goes into the first slot it doesn't overlap (and can share a memory type with)
+    static TransientAttachmentPlan assignSlots(std::vector<Entry>& entries);
+
+    const vk::raii::Device* device = nullptr;
+    MemoryAllocator* allocator = nullptr;
+
+    std::vector<Entry> entries;
+    std::vector<MemoryAllocation> slots;
+    TransientAttachmentPlan plan;
+};
@@ -0,0 +1,37 @@
+#include "UploadBatch.h"
+
+#include "helpers.h"
+
+void UploadBatch::uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset)
+{
+    ring.uploadBuffer(data, size, dstBuffer, dstOffset);
+    operationCount++;
+}
+
+void UploadBatch::uploadImage(const void* data, vk::Image dstImage, uint32_t width, uint32_t height, uint32_t texelSize, uint32_t mipLevel)
+{
+    ring.uploadImage(data, dstImage, width, height, texelSize, mipLevel);
+    operationCount++;
+}
+
+void UploadBatch::transitionImage(vk::Image image, vk::Format format, uint32_t mipLevels, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+{
+    helpers::recordTransitionImageLayoutTexture(ring.recording(), image, format, mipLevels, oldLayout, newLayout);
+    operationCount++;
+}
+
+void UploadBatch::generateMipmaps(vk::Image image, vk::Format format, uint32_t mipLevels, int32_t width, int32_t height,
+    const vk::raii::PhysicalDevice& physicalDevice)
+{
+    helpers::checkLinearBlitSupport(format, physicalDevice);
+    // blits need a graphics queue, so this runs on the owner side after the upload was acquired
+    helpers::recordGenerateMipmaps(ring.recordingOwner(), image, mipLevels, width, height);
+    operationCount++;
+}
+
+UploadTicket UploadBatch::submit()
+{
+    const uint64_t serial = ring.flush();
+    operationCount = 0;
+    return {ring, serial};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "StagingRing.h"
+
+// returned by UploadBatch::submit. poll it or block on it, the batch's resources are usable once it's ready
+class UploadTicket
+{
+public:
+    UploadTicket() = default;
+    UploadTicket(StagingRing& ring, uint64_t serial) : ring(&ring), serial(serial) {}
+
+    [[nodiscard]] bool isReady() const { return !ring || ring->isComplete(serial); }
+    void wait() const { if (ring) ring->wait(serial); }
+
+private:
+    StagingRing* ring = nullptr;
+    uint64_t serial = 0;
+};
+
+// records a group of uploads - copies, layout transitions, mip generation - into the staging ring's
+// reused command buffer and submits them all at once. the submission signals the ring's timeline semaphore,
+// submit hands back a ticket holding that value: isReady polls it (no blocking, e.g. once a frame),
+// wait blocks on the semaphore until it's reached. later graphics work on the owner queue sees the uploads either way.
+// (a batch bigger than the ring is split into several submissions along the way, still in order - the ticket's value
+// is the last one, which covers all of them)
+//
+//  UploadBatch batch(stagingRing);
+//  batch.transitionImage(...); batch.uploadImage(...); batch.generateMipmaps(...);
+//  UploadTicket ticket = batch.submit();
+class UploadBatch
+{
+public:
+    explicit UploadBatch(StagingRing& stagingRing) : ring(stagingRing) {}
+
+    void uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset);
+    void uploadImage(const void* data, vk::Image dstImage, uint32_t width, uint32_t height, uint32_t texelSize, uint32_t mipLevel = 0);
+    // recorded on the copy queue, meant for getting images ready for the copies
+    void transitionImage(vk::Image image, vk::Format format, uint32_t mipLevels, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+    // blits the mip chain down from level 0 and leaves every level in SHADER_READ_ONLY_OPTIMAL.
+    // recorded on the owner (graphics) queue after the uploads are acquired
+    void generateMipmaps(vk::Image image, vk::Format format, uint32_t mipLevels, int32_t width, int32_t height,
+        const vk::raii::PhysicalDevice& physicalDevice);
+
+    [[nodiscard]] uint32_t getOperationCount() const { return operationCount; }
+
+    // flushes the ring, doesn't wait. the ticket is ready once the ring's timeline semaphore reaches this submission
+    UploadTicket submit();
+
+private:
+    StagingRing& ring;
+    uint32_t operationCount = 0;
+};
@@ -0,0 +1,105 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "CpuProfiler.h"
+
+WorkerPool::WorkerPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    }
+    threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(&WorkerPool::workerMain, this, i + 1);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t, uint32_t)>& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunks = (count + chunkSize - 1) / chunkSize;
+    // nothing to split, don't wake anyone
+    if (chunks == 1 || threads.empty())
+    {
+        for (size_t begin = 0; begin < count; begin += chunkSize)
+        {
+            function(begin, std::min(begin + chunkSize, count), 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        job = &function;
+        jobCount = count;
+        jobChunkSize = chunkSize;
+        jobChunks = chunks;
+        nextChunk.store(0, std::memory_order_relaxed);
+        finishedThreads = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    // every chunk ran once every thread is out of the job
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return finishedThreads == threads.size(); });
+    job = nullptr;
+}
+
+void WorkerPool::runChunks(uint32_t worker)
+{
+    for (size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < jobChunks; chunk = nextChunk.fetch_add(1, std::memory_order_relaxed))
+    {
+        const size_t begin = chunk * jobChunkSize;
+        (*job)(begin, std::min(begin + jobChunkSize, jobCount), worker);
+    }
+}
+
+void WorkerPool::workerMain(uint32_t worker)
+{
+    ANUBIS_PROFILE_THREAD("Worker " + std::to_string(worker));
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runChunks(worker);
+
+        {
+            std::lock_guard lock(mutex);
+            finishedThreads++;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of threads that split loops with the calling thread.
+// parallelFor cuts [0, count) into chunks that every thread (caller included) pulls from a shared counter
+// until none are left, then returns - no allocation and no thread creation per call.
+// worker indices are stable: 0 is the caller, 1..n the pool's threads, so per worker scratch can be indexed by them.
+// one parallelFor at a time, from one thread
+class WorkerPool
+{
+public:
+    // 0 = one thread per hardware thread besides the caller
+    explicit WorkerPool(uint32_t threadCount = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // threads working a parallelFor, caller included
+    [[nodiscard]] uint32_t getWorkerCount() const { return static_cast<uint32_t>(threads.size()) + 1; }
+
+    // fn(begin, end, worker) for every chunk of at most chunkSize, blocks until all of them ran.
+    // chunk boundaries are multiples of chunkSize, fn sees each index exactly once
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t, uint32_t)>& function);
+
+private:
+    void workerMain(uint32_t worker);
+    // pulls chunks until the job runs dry
+    void runChunks(uint32_t worker);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping = false;
+    // bumped for every job, a thread works a job once
+    uint64_t generation = 0;
+
+    const std::function<void(size_t, size_t, uint32_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunkSize = 1;
+    size_t jobChunks = 0;
+    std::atomic<size_t> nextChunk = 0;
+    // threads done with the current job. every thread checks in once per job, so its state is never
+    // reused while a late waking thread could still read it
+    uint32_t finishedThreads = 0;
+};
@@ -3,6 +3,7 @@
 #include <queue>
 
 #include "Logger.h"
+#include "MemoryAllocator.h"
 
 namespace helpers
 {
@@ -27,30 +28,12 @@ namespace helpers
         return buffer;
     }
 
-    static uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, const vk::raii::PhysicalDevice& physicalDevice)
-    {
-        // get the memory properties of the physical device
-        vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
-
-        // iterate through the memory types
-        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
-        {
-            // if the type matches the filter and the properties match
-            if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                return i;
-            }
-        }
-
-        Logger::printToConsole("failed to find suitable memory type!", level::err);
-        throw std::runtime_error("failed to find suitable memory type!");
-    }
-
-    // TODO: need to update to handle a large number of objects at the same time
-    //  create a custom allocator that splits up a single allocation among many different objects by using the offset parameters
-    //  see: VulkanMemoryAllocator library
-    static void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::raii::Buffer& buffer, vk::raii::DeviceMemory& bufferMemory, const
-                             vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice)
+    // every buffer is carved out of a shared block by the MemoryAllocator (see MemoryAllocator.h)
+    //  staging and other short lived buffers should pass AllocationStrategy::eLinear
+    //  the placement picks the memory type (see MemoryPlacements)
+    static void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, const MemoryPlacement& placement, vk::raii::Buffer& buffer, MemoryAllocation& bufferMemory, const
+                             vk::raii::Device& logicalDevice, MemoryAllocator& allocator, AllocationStrategy strategy = AllocationStrategy::eFreeList,
+                             MemoryCategory category = MemoryCategory::eOther)
     {
         // create the buffer
         vk::BufferCreateInfo bufferInfo
@@ -61,23 +44,16 @@ namespace helpers
         };
         buffer = vk::raii::Buffer(logicalDevice, bufferInfo);
 
-        vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-        vk::MemoryAllocateInfo allocInfo
-    {
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits,vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, physicalDevice)
-    };
-
-        bufferMemory = vk::raii::DeviceMemory(logicalDevice, allocInfo);
+        bufferMemory = allocator.allocateForBuffer(buffer, placement, strategy, category);
 
         // associate the memory to the buffer
-        // if offset is non-zero, then it is required to be divisible by memRequirements.alignment
-        buffer.bindMemory(*bufferMemory, 0);
+        // the allocator already aligned the offset to memRequirements.alignment
+        buffer.bindMemory(bufferMemory.getMemory(), bufferMemory.getOffset());
     }
 
-    static void createImage(uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels, vk::SampleCountFlagBits numSamples, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::
-                            MemoryPropertyFlags properties, vk::raii::Image& image, vk::raii::DeviceMemory& imageMemory, const vk::raii::Device& logicalDevice, const
-                            vk::raii::PhysicalDevice& physicalDevice)
+    static void createImage(uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels, vk::SampleCountFlagBits numSamples, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage,
+                            const MemoryPlacement& placement, vk::raii::Image& image, MemoryAllocation& imageMemory, const vk::raii::Device& logicalDevice,
+                            MemoryAllocator& allocator, MemoryCategory category = MemoryCategory::eOther)
     {
         vk::Extent3D extent{static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1};
         vk::ImageCreateInfo imageCreateInfo
@@ -96,60 +72,9 @@ namespace helpers
 
         image = vk::raii::Image(logicalDevice, imageCreateInfo);
 
-        vk::MemoryRequirements memRequirements = image.getMemoryRequirements();
-        vk::MemoryAllocateInfo allocInfo
-        {
-            .allocationSize = memRequirements.size,
-            .memoryTypeIndex = helpers::findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice)
-        };
-        imageMemory = vk::raii::DeviceMemory(logicalDevice, allocInfo);
-        image.bindMemory(imageMemory, 0);
-    }
-
-    static vk::raii::CommandBuffer beginSingleTimeCommands(const vk::raii::CommandPool& commandPool, const vk::raii::Device& logicalDevice)
-    {
-        vk::CommandBufferAllocateInfo allocInfo
-        {
-            .commandPool = commandPool,
-            .level = vk::CommandBufferLevel::ePrimary,
-            .commandBufferCount = 1
-        };
-        vk::raii::CommandBuffer commandBuffer = std::move(logicalDevice.allocateCommandBuffers(allocInfo).front());
-
-        vk::CommandBufferBeginInfo beginInfo
-        {
-            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
-        };
-        commandBuffer.begin(beginInfo);
-
-        return commandBuffer;
-    }
-
-    static void endSingleTimeCommands(vk::raii::CommandBuffer& commandBuffer, const vk::raii::Queue& queue)
-    {
-        commandBuffer.end();
-
-        vk::SubmitInfo submitInfo
-        {
-            .commandBufferCount = 1,
-            .pCommandBuffers = &*commandBuffer
-        };
-        // run the command
-        queue.submit(submitInfo, nullptr);
-        // note: can also leverage waitForFences
-        //  a fence could allow for the ability to schedule multiple transfers.
-        //  which in turn might give the driver more opportunity to optimize.
-        queue.waitIdle();
-    }
-
-    static void copyBuffer(const vk::raii::Buffer& srcBuffer, const vk::raii::Buffer& dstBuffer, vk::DeviceSize size, const vk::raii::CommandPool& commandPool, const vk::raii::Device& logicalDevice, const vk::raii::Queue& queue)
-    {
-        vk::raii::CommandBuffer commandCopyBuffer = helpers::beginSingleTimeCommands(commandPool, logicalDevice);
-
-        // transfer src to dst
-        commandCopyBuffer.copyBuffer(srcBuffer, dstBuffer, {vk::BufferCopy{0, 0, size}});
-
-        helpers::endSingleTimeCommands(commandCopyBuffer, queue);
+        // large images (render targets, big textures) come back as dedicated allocations
+        imageMemory = allocator.allocateForImage(image, placement, AllocationStrategy::eFreeList, category);
+        image.bindMemory(imageMemory.getMemory(), imageMemory.getOffset());
     }
 
     static bool hasStencilComponent(vk::Format format)
@@ -157,11 +82,10 @@ namespace helpers
         return format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eD24UnormS8Uint;
     }
 
-    static void transitionImageLayoutTexture(const vk::raii::Image& image, vk::Format format, uint32_t mipLevels, vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
-        const vk::raii::CommandPool& commandPool, const vk::raii::Device& logicalDevice, const vk::raii::Queue& queue)
+    // records the transition into an already recording command buffer (see UploadBatch)
+    static void recordTransitionImageLayoutTexture(const vk::raii::CommandBuffer& commandBuffer, vk::Image image, vk::Format format, uint32_t mipLevels,
+        vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
     {
-        auto commandBuffer = beginSingleTimeCommands(commandPool, logicalDevice);
-
         vk::ImageMemoryBarrier barrier
         {
             .oldLayout = oldLayout,
@@ -223,27 +147,6 @@ namespace helpers
         // specify which types of operations that involve the resource must happen before the barrier,
         // and which operations that involve the resource must wait on the barrier
         commandBuffer.pipelineBarrier(srcStage, dstStage, {}, {}, nullptr, {barrier});
-        endSingleTimeCommands(commandBuffer, queue);
-    }
-
-    static void copyBufferToImage(const vk::raii::Buffer& buffer, const vk::raii::Image& image, int width, int height, const vk::raii::CommandPool& commandPool, const vk::raii::Device& logicalDevice, const vk::raii::Queue& queue)
-    {
-        // create a command buffer
-        auto commandBuffer = beginSingleTimeCommands(commandPool, logicalDevice);
-
-        vk::BufferImageCopy region
-        {
-            .bufferOffset = 0,
-            .bufferRowLength = 0,
-            .bufferImageHeight = 0,
-            .imageSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1},
-            .imageOffset = {0, 0, 0},
-            .imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1}
-        };
-
-        commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, {region});
-        
-        endSingleTimeCommands(commandBuffer, queue);
     }
 
     static vk::raii::ImageView createImageView(const vk::raii::Image& image, vk::Format format, uint32_t mipLevels, vk::ImageAspectFlags aspectFlags, const vk::raii::Device& logicalDevice)
@@ -295,9 +198,7 @@ namespace helpers
         );
     }
 
-    static void generateMipmaps(vk::raii::Image& image, vk::Format imageFormat, uint32_t mipLevels,
-        int32_t texWidth, int32_t texHeight,
-        const vk::raii::CommandPool& commandPool, const vk::raii::Device& logicalDevice, const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Queue& queue)
+    static void checkLinearBlitSupport(vk::Format imageFormat, const vk::raii::PhysicalDevice& physicalDevice)
     {
         //does the texture support blit
         vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(imageFormat);
@@ -306,9 +207,12 @@ namespace helpers
             Logger::printToConsole("texture does not support blit!", level::err);
             throw std::runtime_error("texture does not support blit!");
         }
-        
-        vk::raii::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, logicalDevice);
+    }
 
+    // records the mip chain blits into an already recording command buffer (see UploadBatch)
+    //  every level is left in SHADER_READ_ONLY_OPTIMAL
+    static void recordGenerateMipmaps(const vk::raii::CommandBuffer& commandBuffer, vk::Image image, uint32_t mipLevels, int32_t texWidth, int32_t texHeight)
+    {
         vk::ImageMemoryBarrier barrier
         {
             .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
@@ -371,8 +275,6 @@ namespace helpers
         barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
         commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, nullptr, {barrier});
-        
-        endSingleTimeCommands(commandBuffer, queue);
     }
 
     static vk::SampleCountFlagBits getMaxUsableSampleCount(const vk::raii::PhysicalDevice& physicalDevice)
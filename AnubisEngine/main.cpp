@@ -5,14 +5,33 @@
 #include <cstdlib>
 
 int main(int argc, char* argv[]) {
-    AnubisEngine engine;
-
+    int exitCode = EXIT_SUCCESS;
     try {
-        engine.run();
+        const EngineOptions options = EngineOptions::parse(argc, argv);
+        if (options.compareReports)
+        {
+            // regression check for CI, no Vulkan involved
+            Logger::init();
+            exitCode = FrameBenchmark::compareReports(options.benchmarkBaselinePath, options.benchmarkReportPath, options.benchmarkThreshold) == 0
+                ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else if (options.benchmarkCulling)
+        {
+            // CPU only as well
+            Logger::init();
+            FrustumCuller::runBenchmark();
+        }
+        else
+        {
+            AnubisEngine engine(options);
+            exitCode = engine.run();
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
-        return EXIT_FAILURE;
+        exitCode = EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
+    // the logger is asynchronous, write out whatever is still queued
+    Logger::shutdown();
+    return exitCode;
 }
\ No newline at end of file